@@ -0,0 +1,41 @@
+#!/usr/bin/env bash
+# Per-function code size of the benchmarked variants, read from the symbol table.
+#
+# usage: code_size.sh BINARY [PATTERN]
+#
+# Prints a JSON array with one entry per function: the bytes of its main body
+# ("hot", including .part/.constprop/coroutine clones) and of its [clone .cold]
+# parts, which GCC and Clang split out for unlikely paths.
+set -euo pipefail
+
+binary=$1
+pattern=${2:-'^(do_fib_|parse_coordinate_|ten_steps_)'}
+
+nm -C -S --size-sort "$binary" |
+  awk -v pattern="$pattern" '
+    function hex(s,   v, i) {
+      v = 0
+      for (i = 1; i <= length(s); ++i)
+        v = v * 16 + index("0123456789abcdef", substr(tolower(s), i, 1)) - 1
+      return v
+    }
+    NF >= 4 && $3 ~ /^[tTwW]$/ {
+      size = hex($2)
+      name = $0
+      sub(/^[^ ]+ [^ ]+ [^ ]+ /, "", name)
+      cold = name ~ /\[clone \.cold[^]]*\]/
+      sub(/ \[clone .*$/, "", name)
+      if (name !~ pattern) next
+      if (!(name in hot)) { hot[name] = 0; order[++n] = name }
+      if (cold) coldsz[name] += size; else hot[name] += size
+    }
+    END {
+      for (i = 1; i <= n; ++i) {
+        name = order[i]
+        gsub(/\\/, "\\\\", name); gsub(/"/, "\\\"", name)
+        printf "{\"function\": \"%s\", \"hot_bytes\": %d, \"cold_bytes\": %d, \"total_bytes\": %d}\n",
+               name, hot[order[i]], coldsz[order[i]], hot[order[i]] + coldsz[order[i]]
+      }
+    }' |
+  LC_ALL=C sort |
+  awk 'BEGIN { print "[" } NR > 1 { print prev "," } { prev = "  " $0 } END { if (NR) print prev; print "]" }'
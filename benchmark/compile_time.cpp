@@ -0,0 +1,58 @@
+// Compile-time benchmark: CPPMATCH_CT_ERRORS error types, CPPMATCH_CT_SITES
+// call sites. Each site widens a three-type Error into the full set with
+// expect and matches the result, which is what a large error-handling TU does.
+// Build it with -fsyntax-only (or -c) and time the compiler, not the binary.
+#include "match.hpp"
+
+#include <utility>
+
+#ifndef CPPMATCH_CT_ERRORS
+#define CPPMATCH_CT_ERRORS 24
+#endif
+#ifndef CPPMATCH_CT_SITES
+#define CPPMATCH_CT_SITES 64
+#endif
+
+using namespace cppmatch;
+
+constexpr int error_count = CPPMATCH_CT_ERRORS;
+constexpr int site_count = CPPMATCH_CT_SITES;
+static_assert(error_count >= 3, "each site uses three distinct error types");
+
+template <int I> struct ct_error {
+    int code = I;
+};
+
+template <typename Is> struct ct_error_set;
+template <int... I> struct ct_error_set<std::integer_sequence<int, I...>> {
+    using type = Error<ct_error<I>...>;
+};
+
+using all_errors = ct_error_set<std::make_integer_sequence<int, error_count>>::type;
+
+template <int S>
+using site_errors = Error<ct_error<S % error_count>, ct_error<(S + 1) % error_count>,
+                          ct_error<(S + 2) % error_count>>;
+
+template <int S> Result<int, site_errors<S>> leaf_call(int x) {
+    if (x == S) return ct_error<S % error_count>{};
+    if (x == -S) return ct_error<(S + 2) % error_count>{};
+    return x;
+}
+
+template <int S> Result<int, all_errors> site(int x) {
+    int v = expect(leaf_call<S>(x));
+    return v + 1;
+}
+
+template <int S> int handle(int x) {
+    return match(site<S>(x),
+        [](int v) { return v; },
+        [](const auto& e) { return -e.code; });
+}
+
+int main(int argc, char**) {
+    return [&]<int... S>(std::integer_sequence<int, S...>) {
+        return (handle<S>(argc) + ...);
+    }(std::make_integer_sequence<int, site_count>{}) == 0;
+}
@@ -2,8 +2,21 @@
 #include <benchmark/benchmark.h>
 
 #include "match.hpp"
+#include "match_parallel.hpp"
+#include "match_vector.hpp"
+#include "match_lazy_error.hpp"
+#include "match_coro.hpp"
+#include "match_async.hpp"
+#include "match_lines.hpp"
+#include "match_arena.hpp"
 
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
 #include <expected>
+#include <filesystem>
+#include <format>
 #include <string>
 #include <sstream>
 #include <vector>
@@ -11,6 +24,8 @@
 #include <charconv>
 #include <cassert>
 #include <iostream>
+#include <map>
+#include <string_view>
 
 
 using namespace cppmatch;
@@ -39,64 +54,123 @@ Result<unsigned, invalid_value> do_fib_cppmatch(unsigned n, unsigned max_depth)
    return expect(do_fib_cppmatch(n - 2, max_depth - 1)) + expect(do_fib_cppmatch(n - 1, max_depth - 1));
 }
 
+Result<unsigned, invalid_value> do_fib_cppmatch_cold(unsigned n, unsigned max_depth) {
+   if (!max_depth) return invalid_value{std::to_string(n) + " exceeds max_depth"};
+   if (n <= 2) return 1U;
+   return expect_cold(do_fib_cppmatch_cold(n - 2, max_depth - 1)) + expect_cold(do_fib_cppmatch_cold(n - 1, max_depth - 1));
+}
+
+// Same recursion with co_await instead of expect: no statement expressions, no exceptions.
+Result<unsigned, invalid_value> do_fib_cppmatch_coro(unsigned n, unsigned max_depth) {
+   if (!max_depth) co_return invalid_value{std::to_string(n) + " exceeds max_depth"};
+   if (n <= 2) co_return 1U;
+   // Separate statements: inside one expression both calls may run before either is awaited.
+   unsigned n2 = co_await do_fib_cppmatch_coro(n - 2, max_depth - 1);
+   co_return n2 + co_await do_fib_cppmatch_coro(n - 1, max_depth - 1);
+}
+
 Result<unsigned, invalid_value> do_fib_cppmatch_with_exceptions(unsigned n, unsigned max_depth) {
     if (!max_depth) return invalid_value{std::to_string(n) + " exceeds max_depth"};
     if (n <= 2) return 1U;
     return expect_e(do_fib_cppmatch_with_exceptions(n - 2, max_depth - 1)) + expect_e(do_fib_cppmatch_with_exceptions(n - 1, max_depth - 1));
  }
 
- 
+// Same recursion with an error that keeps n and formats only if read.
+using depth_exceeded = lazy_error<"{} exceeds max_depth", unsigned>;
+
+Result<unsigned, depth_exceeded> do_fib_cppmatch_lazy(unsigned n, unsigned max_depth) {
+   if (!max_depth) return depth_exceeded{n};
+   if (n <= 2) return 1U;
+   return expect(do_fib_cppmatch_lazy(n - 2, max_depth - 1)) + expect(do_fib_cppmatch_lazy(n - 1, max_depth - 1));
+}
+
+// Arguments of every recursive_fib_* family: fib(n) with at most max_depth nested calls.
+// A max_depth below n makes the deepest calls fail, so the sweep covers the error path too.
+static void fib_args(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"n", "max_depth"})->ArgsProduct({{10, 15, 20}, {8, 20}});
+}
+
 static void recursive_fib_std_expected(benchmark::State& state) {
   for (auto _ : state) {
-    auto res = do_fib_expected(15, 20);
+    auto res = do_fib_expected(state.range(0), state.range(1));
     benchmark::DoNotOptimize(res);
   }
+  state.SetItemsProcessed(state.iterations());
 }
-BENCHMARK(recursive_fib_std_expected);
+BENCHMARK(recursive_fib_std_expected)->Apply(fib_args);
 
 static void recursive_fib_cppmatch(benchmark::State& state) {
   for (auto _ : state) {
-    auto res = do_fib_cppmatch(15, 20);
+    auto res = do_fib_cppmatch(state.range(0), state.range(1));
     benchmark::DoNotOptimize(res);
   }
+  state.SetItemsProcessed(state.iterations());
 }
-BENCHMARK(recursive_fib_cppmatch);
+BENCHMARK(recursive_fib_cppmatch)->Apply(fib_args);
 
-static void recursive_fib_cppmatch_with_exceptions(benchmark::State& state) {
-    for (auto _ : state) {
-      auto res = match_e(do_fib_cppmatch_with_exceptions(15, 20), [](auto&&){return "";});
-      benchmark::DoNotOptimize(res);
-    }
+static void recursive_fib_cppmatch_cold(benchmark::State& state) {
+  for (auto _ : state) {
+    auto res = do_fib_cppmatch_cold(state.range(0), state.range(1));
+    benchmark::DoNotOptimize(res);
   }
-  BENCHMARK(recursive_fib_cppmatch_with_exceptions);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(recursive_fib_cppmatch_cold)->Apply(fib_args);
 
-  
+static void recursive_fib_cppmatch_coro(benchmark::State& state) {
+  for (auto _ : state) {
+    auto res = do_fib_cppmatch_coro(state.range(0), state.range(1));
+    benchmark::DoNotOptimize(res);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(recursive_fib_cppmatch_coro)->Apply(fib_args);
 
-static void recursive_fib_throws(benchmark::State& state) {
+static void recursive_fib_cppmatch_lazy_error(benchmark::State& state) {
   for (auto _ : state) {
-    auto res = do_fib_throws(15, 20);
+    auto res = do_fib_cppmatch_lazy(state.range(0), state.range(1));
     benchmark::DoNotOptimize(res);
   }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(recursive_fib_cppmatch_lazy_error)->Apply(fib_args);
+
+static void recursive_fib_cppmatch_with_exceptions(benchmark::State& state) {
+  for (auto _ : state) {
+    auto res = match_e(do_fib_cppmatch_with_exceptions(state.range(0), state.range(1)), [](auto&&){return "";});
+    benchmark::DoNotOptimize(res);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(recursive_fib_cppmatch_with_exceptions)->Apply(fib_args);
+
+static void recursive_fib_throws(benchmark::State& state) {
+  for (auto _ : state) {
+    try {
+      auto res = do_fib_throws(state.range(0), state.range(1));
+      benchmark::DoNotOptimize(res);
+    } catch (const invalid_value& e) {
+      benchmark::DoNotOptimize(e);
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
 }
-BENCHMARK(recursive_fib_throws);
+BENCHMARK(recursive_fib_throws)->Apply(fib_args);
 
 
 //=== Coordinate Parsing Benchmarks ===
 
-std::string generate_random_coordinate_string() {
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    
+std::string generate_random_coordinate_string(std::mt19937& gen, double error_rate) {
     std::uniform_real_distribution<> prob_dist(0.0, 1.0);
     double probability = prob_dist(gen);
     
-    if (probability < 0.9) { // 90% chance of valid coordinates
+    if (probability >= error_rate) { // valid coordinates
         std::uniform_real_distribution<> lat_dist(-90.0, 90.0);
         std::uniform_real_distribution<> lon_dist(-180.0, 180.0);
         double lat = lat_dist(gen);
         double lon = lon_dist(gen);
         return std::to_string(lat) + "," + std::to_string(lon);
-    } else { // 10% chance of invalid coordinates
+    } else { // invalid coordinates
         std::uniform_int_distribution<> error_dist(0, 2);
         int error_type = error_dist(gen);
         
@@ -114,11 +188,36 @@ std::string generate_random_coordinate_string() {
     }
 }
 
+// Inputs are generated once per error rate from a fixed seed and shared by every
+// coord_* family, so the timed loops only measure parsing and error handling and
+// runs are reproducible.
+const std::vector<std::string>& coordinate_corpus(std::int64_t error_pct) {
+    static std::map<std::int64_t, std::vector<std::string>> corpora;
+    auto [it, inserted] = corpora.try_emplace(error_pct);
+    if (inserted) {
+        std::mt19937 gen(42);
+        it->second.reserve(4096);
+        for (int i = 0; i < 4096; ++i)
+            it->second.push_back(generate_random_coordinate_string(gen, error_pct / 100.0));
+    }
+    return it->second;
+}
+
 struct Coordinate {
     double latitude;
     double longitude;
 };
 
+// Splits "latitude,longitude" without allocating; false if either side is missing.
+bool split_coordinate(std::string_view input, std::string_view& lat, std::string_view& lon) {
+    const auto comma = input.find(',');
+    if (comma == std::string_view::npos || comma + 1 == input.size())
+        return false;
+    lat = input.substr(0, comma);
+    lon = input.substr(comma + 1);
+    return true;
+}
+
 struct InvalidDoubleConversion { std::string_view message; };
 struct InvalidCoordinate       { std::string_view message; };
 struct InvalidCoordinateFormat { std::string_view message; };
@@ -207,6 +306,26 @@ parse_coordinate_cppmatch(const std::string& input) {
 }
 
 
+Result<Coordinate, Error<InvalidDoubleConversion, InvalidCoordinate, InvalidCoordinateFormat>>
+parse_coordinate_cppmatch_cold(const std::string& input) {
+    std::istringstream ss(input);
+    std::string lat_str, lon_str;
+    
+    if (!std::getline(ss, lat_str, ',') || !std::getline(ss, lon_str))
+        return InvalidCoordinateFormat{"Invalid format (expected 'latitude,longitude')"};
+    
+    double latitude  = expect_cold(safe_str_to_double_cppmatch(lat_str));
+    double longitude = expect_cold(safe_str_to_double_cppmatch(lon_str));
+    
+    if (latitude < -90 || latitude > 90)
+        return InvalidCoordinate{"Latitude out of range (-90 to 90)"};
+    if (longitude < -180 || longitude > 180)
+        return InvalidCoordinate{"Longitude out of range (-180 to 180)"};
+    
+    return Coordinate{latitude, longitude};
+}
+
+
 Result<Coordinate, Error<InvalidDoubleConversion, InvalidCoordinate, InvalidCoordinateFormat>>
 parse_coordinate_cppmatch_with_exceptions(const std::string& input) {
     std::istringstream ss(input);
@@ -267,41 +386,216 @@ Coordinate parse_coordinate_throws(const std::string& input) {
 }
 
 
+//=== Zero-allocation variants: the same parsers on string_view splitting ===
+
+std::expected<Coordinate, std::variant<InvalidDoubleConversion, InvalidCoordinate, InvalidCoordinateFormat>>
+parse_coordinate_sv_expected(std::string_view input) {
+    std::string_view lat_str, lon_str;
+    if (!split_coordinate(input, lat_str, lon_str)) {
+        return std::unexpected{InvalidCoordinateFormat{"Invalid format (expected 'latitude,longitude')"}};
+    }
+
+    auto lat_result = safe_str_to_double_expected(lat_str);
+    if (!lat_result.has_value()) {
+        return std::unexpected{lat_result.error()};
+    }
+
+    auto lon_result = safe_str_to_double_expected(lon_str);
+    if (!lon_result.has_value()) {
+        return std::unexpected{lon_result.error()};
+    }
+
+    double latitude = lat_result.value();
+    double longitude = lon_result.value();
+
+    if (latitude < -90 || latitude > 90) {
+        return std::unexpected{InvalidCoordinate{"Latitude out of range (-90 to 90)"}};
+    }
+    if (longitude < -180 || longitude > 180) {
+        return std::unexpected{InvalidCoordinate{"Longitude out of range (-180 to 180)"}};
+    }
+
+    return Coordinate{latitude, longitude};
+}
+
+Result<Coordinate, Error<InvalidDoubleConversion, InvalidCoordinate, InvalidCoordinateFormat>>
+parse_coordinate_sv_cppmatch(std::string_view input) {
+    std::string_view lat_str, lon_str;
+    if (!split_coordinate(input, lat_str, lon_str))
+        return InvalidCoordinateFormat{"Invalid format (expected 'latitude,longitude')"};
+    
+    double latitude  = expect(safe_str_to_double_cppmatch(lat_str));
+    double longitude = expect(safe_str_to_double_cppmatch(lon_str));
+    
+    if (latitude < -90 || latitude > 90)
+        return InvalidCoordinate{"Latitude out of range (-90 to 90)"};
+    if (longitude < -180 || longitude > 180)
+        return InvalidCoordinate{"Longitude out of range (-180 to 180)"};
+    
+    return Coordinate{latitude, longitude};
+}
+
+Result<Coordinate, Error<InvalidDoubleConversion, InvalidCoordinate, InvalidCoordinateFormat>>
+parse_coordinate_sv_cppmatch_cold(std::string_view input) {
+    std::string_view lat_str, lon_str;
+    if (!split_coordinate(input, lat_str, lon_str))
+        return InvalidCoordinateFormat{"Invalid format (expected 'latitude,longitude')"};
+    
+    double latitude  = expect_cold(safe_str_to_double_cppmatch(lat_str));
+    double longitude = expect_cold(safe_str_to_double_cppmatch(lon_str));
+    
+    if (latitude < -90 || latitude > 90)
+        return InvalidCoordinate{"Latitude out of range (-90 to 90)"};
+    if (longitude < -180 || longitude > 180)
+        return InvalidCoordinate{"Longitude out of range (-180 to 180)"};
+    
+    return Coordinate{latitude, longitude};
+}
+
+Result<Coordinate, Error<InvalidDoubleConversion, InvalidCoordinate, InvalidCoordinateFormat>>
+parse_coordinate_sv_cppmatch_with_exceptions(std::string_view input) {
+    std::string_view lat_str, lon_str;
+    if (!split_coordinate(input, lat_str, lon_str))
+        return InvalidCoordinateFormat{"Invalid format (expected 'latitude,longitude')"};
+    
+    double latitude  = expect_e(safe_str_to_double_cppmatch(lat_str));
+    double longitude = expect_e(safe_str_to_double_cppmatch(lon_str));
+    
+    if (latitude < -90 || latitude > 90)
+        return InvalidCoordinate{"Latitude out of range (-90 to 90)"};
+    if (longitude < -180 || longitude > 180)
+        return InvalidCoordinate{"Longitude out of range (-180 to 180)"};
+    
+    return Coordinate{latitude, longitude};
+}
+
+Coordinate parse_coordinate_sv_throws(std::string_view input) {
+    std::string_view lat_str, lon_str;
+    if (!split_coordinate(input, lat_str, lon_str)) {
+        throw InvalidCoordinateFormat{"Invalid format (expected 'latitude,longitude')"};
+    }
+
+    double latitude = safe_str_to_double_throws(lat_str);
+    double longitude = safe_str_to_double_throws(lon_str);
+
+    if (latitude < -90 || latitude > 90) {
+        throw InvalidCoordinate{"Latitude out of range (-90 to 90)"};
+    }
+    if (longitude < -180 || longitude > 180) {
+        throw InvalidCoordinate{"Longitude out of range (-180 to 180)"};
+    }
+
+    return Coordinate{latitude, longitude};
+}
+
+// Context attached to the two number parses. The eager variant formats the
+// context before every parse, as code without deferred context has to; the
+// lazy one only formats it once a parse has failed.
+using ContextualCoordinateError =
+    Contextual<Error<InvalidDoubleConversion, InvalidCoordinate, InvalidCoordinateFormat>>;
+
+Result<Coordinate, ContextualCoordinateError>
+parse_coordinate_sv_context_eager(std::string_view input) {
+    std::string_view lat_str, lon_str;
+    if (!split_coordinate(input, lat_str, lon_str))
+        return InvalidCoordinateFormat{"Invalid format (expected 'latitude,longitude')"};
+
+    std::string lat_context = std::format("latitude '{}'", lat_str);
+    double latitude  = expect_ctx(safe_str_to_double_cppmatch(lat_str), lat_context);
+    std::string lon_context = std::format("longitude '{}'", lon_str);
+    double longitude = expect_ctx(safe_str_to_double_cppmatch(lon_str), lon_context);
+
+    if (latitude < -90 || latitude > 90)
+        return InvalidCoordinate{"Latitude out of range (-90 to 90)"};
+    if (longitude < -180 || longitude > 180)
+        return InvalidCoordinate{"Longitude out of range (-180 to 180)"};
+
+    return Coordinate{latitude, longitude};
+}
+
+Result<Coordinate, ContextualCoordinateError>
+parse_coordinate_sv_context_lazy(std::string_view input) {
+    std::string_view lat_str, lon_str;
+    if (!split_coordinate(input, lat_str, lon_str))
+        return InvalidCoordinateFormat{"Invalid format (expected 'latitude,longitude')"};
+
+    double latitude  = expect_ctx(safe_str_to_double_cppmatch(lat_str),
+                                  [&] { return std::format("latitude '{}'", lat_str); });
+    double longitude = expect_ctx(safe_str_to_double_cppmatch(lon_str),
+                                  [&] { return std::format("longitude '{}'", lon_str); });
+
+    if (latitude < -90 || latitude > 90)
+        return InvalidCoordinate{"Latitude out of range (-90 to 90)"};
+    if (longitude < -180 || longitude > 180)
+        return InvalidCoordinate{"Longitude out of range (-180 to 180)"};
+
+    return Coordinate{latitude, longitude};
+}
+
+
+// Arguments of every coord_* family: the percentage of invalid inputs.
+static void coord_args(benchmark::internal::Benchmark* b) {
+    b->ArgName("error_pct")->Arg(0)->Arg(10)->Arg(50)->Arg(100);
+}
+
 static void coord_expected(benchmark::State& state) {
+    const auto& corpus = coordinate_corpus(state.range(0));
+    std::size_t i = 0;
     for (auto _ : state) {
-        std::string input = generate_random_coordinate_string();
+        const std::string& input = corpus[i++ % corpus.size()];
         auto result = parse_coordinate_expected(input);       
         benchmark::DoNotOptimize(result);
     }
+    state.SetItemsProcessed(state.iterations());
 }
-BENCHMARK(coord_expected);
+BENCHMARK(coord_expected)->Apply(coord_args);
 
 
 static void coord_cppmatch(benchmark::State& state) {
+    const auto& corpus = coordinate_corpus(state.range(0));
+    std::size_t i = 0;
     for (auto _ : state) {
-        std::string input = generate_random_coordinate_string();
+        const std::string& input = corpus[i++ % corpus.size()];
         auto result = parse_coordinate_cppmatch(input);
         benchmark::DoNotOptimize(result);
     }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(coord_cppmatch)->Apply(coord_args);
+
+static void coord_cppmatch_cold(benchmark::State& state) {
+    const auto& corpus = coordinate_corpus(state.range(0));
+    std::size_t i = 0;
+    for (auto _ : state) {
+        const std::string& input = corpus[i++ % corpus.size()];
+        auto result = parse_coordinate_cppmatch_cold(input);
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetItemsProcessed(state.iterations());
 }
-BENCHMARK(coord_cppmatch);
+BENCHMARK(coord_cppmatch_cold)->Apply(coord_args);
 
 static void coord_cppmatch_with_exceptions(benchmark::State& state) {
+    const auto& corpus = coordinate_corpus(state.range(0));
+    std::size_t i = 0;
     for (auto _ : state) {
-        std::string input = generate_random_coordinate_string();
+        const std::string& input = corpus[i++ % corpus.size()];
         auto result = match_e(
             parse_coordinate_cppmatch_with_exceptions(input), [](auto){return "";});
         benchmark::DoNotOptimize(result);
     }
+    state.SetItemsProcessed(state.iterations());
 }
-BENCHMARK(coord_cppmatch_with_exceptions);
+BENCHMARK(coord_cppmatch_with_exceptions)->Apply(coord_args);
 
 
 
 
 static void coord_throws(benchmark::State& state) {
+    const auto& corpus = coordinate_corpus(state.range(0));
+    std::size_t i = 0;
     for (auto _ : state) {
-        std::string input = generate_random_coordinate_string();
+        const std::string& input = corpus[i++ % corpus.size()];
         try {
             auto result = parse_coordinate_throws(input);
             benchmark::DoNotOptimize(result);
@@ -313,8 +607,1124 @@ static void coord_throws(benchmark::State& state) {
             benchmark::DoNotOptimize(e);
         }
     }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(coord_throws)->Apply(coord_args);
+
+
+static void coord_sv_expected(benchmark::State& state) {
+    const auto& corpus = coordinate_corpus(state.range(0));
+    std::size_t i = 0;
+    for (auto _ : state) {
+        auto result = parse_coordinate_sv_expected(corpus[i++ % corpus.size()]);
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(coord_sv_expected)->Apply(coord_args);
+
+static void coord_sv_cppmatch(benchmark::State& state) {
+    const auto& corpus = coordinate_corpus(state.range(0));
+    std::size_t i = 0;
+    for (auto _ : state) {
+        auto result = parse_coordinate_sv_cppmatch(corpus[i++ % corpus.size()]);
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(coord_sv_cppmatch)->Apply(coord_args);
+
+static void coord_sv_cppmatch_cold(benchmark::State& state) {
+    const auto& corpus = coordinate_corpus(state.range(0));
+    std::size_t i = 0;
+    for (auto _ : state) {
+        auto result = parse_coordinate_sv_cppmatch_cold(corpus[i++ % corpus.size()]);
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetItemsProcessed(state.iterations());
 }
-BENCHMARK(coord_throws);
+BENCHMARK(coord_sv_cppmatch_cold)->Apply(coord_args);
 
+static void coord_sv_cppmatch_with_exceptions(benchmark::State& state) {
+    const auto& corpus = coordinate_corpus(state.range(0));
+    std::size_t i = 0;
+    for (auto _ : state) {
+        const std::string& input = corpus[i++ % corpus.size()];
+        auto result = match_e(
+            parse_coordinate_sv_cppmatch_with_exceptions(input), [](auto){return "";});
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(coord_sv_cppmatch_with_exceptions)->Apply(coord_args);
+
+static void coord_sv_throws(benchmark::State& state) {
+    const auto& corpus = coordinate_corpus(state.range(0));
+    std::size_t i = 0;
+    for (auto _ : state) {
+        try {
+            auto result = parse_coordinate_sv_throws(corpus[i++ % corpus.size()]);
+            benchmark::DoNotOptimize(result);
+        } catch (const InvalidDoubleConversion& e) {
+            benchmark::DoNotOptimize(e);
+        } catch (const InvalidCoordinate& e) {
+            benchmark::DoNotOptimize(e);
+        } catch (const InvalidCoordinateFormat& e) {
+            benchmark::DoNotOptimize(e);
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(coord_sv_throws)->Apply(coord_args);
+
+static void coord_sv_context_eager(benchmark::State& state) {
+    const auto& corpus = coordinate_corpus(state.range(0));
+    std::size_t i = 0;
+    for (auto _ : state) {
+        auto result = parse_coordinate_sv_context_eager(corpus[i++ % corpus.size()]);
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(coord_sv_context_eager)->Apply(coord_args);
+
+static void coord_sv_context_lazy(benchmark::State& state) {
+    const auto& corpus = coordinate_corpus(state.range(0));
+    std::size_t i = 0;
+    for (auto _ : state) {
+        auto result = parse_coordinate_sv_context_lazy(corpus[i++ % corpus.size()]);
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(coord_sv_context_lazy)->Apply(coord_args);
+
+// ---------------------------------------------------------------------------
+// A newline-delimited coordinate file, memory-mapped and parsed line by line:
+// lazily with try_transform, or by first building a vector of Results.
+
+#if defined(CPPMATCH_HAS_MMAP)
+// About 24 MB of coordinates with 10% invalid lines, written once per run.
+// Writing or mapping it can fail, a read-only temporary directory say; the
+// benchmarks using it are then skipped.
+static const Result<mapped_file, std::error_code>& coordinate_file() {
+    static const auto file = []() -> Result<mapped_file, std::error_code> {
+        std::error_code ec;
+        const auto path = std::filesystem::temp_directory_path(ec) / "cppmatch_coordinates.txt";
+        if (ec)
+            return ec;
+        std::mt19937 gen(7);
+        std::string text;
+        while (text.size() < (24u << 20)) {
+            text += generate_random_coordinate_string(gen, 0.1);
+            text += '\n';
+        }
+        auto* out = std::fopen(path.c_str(), "wb");
+        if (!out)
+            return std::error_code(errno, std::generic_category());
+        const bool written = std::fwrite(text.data(), 1, text.size(), out) == text.size();
+        if (std::fclose(out) != 0 || !written) {
+            std::filesystem::remove(path, ec);
+            return std::make_error_code(std::errc::io_error);
+        }
+        auto mapped = mapped_file::open(path.c_str());
+        std::filesystem::remove(path, ec);
+        return mapped;
+    }();
+    return file;
+}
+
+// The mapped coordinate file, or null after skipping the benchmark.
+static const mapped_file* coordinate_file_or_skip(benchmark::State& state) {
+    const auto& file = coordinate_file();
+    if (is_err(file)) {
+        state.SkipWithError(("coordinate file: " + file.error_unchecked().message()).c_str());
+        return nullptr;
+    }
+    return &file.value_unchecked();
+}
+
+static void lines_try_transform(benchmark::State& state) {
+    const mapped_file* mapped = coordinate_file_or_skip(state);
+    if (!mapped)
+        return;
+    const mapped_file& file = *mapped;
+    for (auto _ : state) {
+        std::size_t invalid = 0;
+        double sum = 0;
+        for (const Coordinate& c : file.lines() | try_transform(parse_coordinate_sv_cppmatch, invalid))
+            sum += c.latitude;
+        benchmark::DoNotOptimize(sum);
+        benchmark::DoNotOptimize(invalid);
+    }
+    state.SetBytesProcessed(state.iterations() * file.text().size());
+}
+BENCHMARK(lines_try_transform)->Unit(benchmark::kMillisecond);
+
+static void lines_vector_then_successes(benchmark::State& state) {
+    const mapped_file* mapped = coordinate_file_or_skip(state);
+    if (!mapped)
+        return;
+    const mapped_file& file = *mapped;
+    for (auto _ : state) {
+        std::vector<decltype(parse_coordinate_sv_cppmatch(""))> parsed;
+        for (std::string_view line : file.lines())
+            parsed.push_back(parse_coordinate_sv_cppmatch(line));
+        double sum = 0;
+        for (const Coordinate& c : parsed | successes)
+            sum += c.latitude;
+        benchmark::DoNotOptimize(sum);
+        benchmark::DoNotOptimize(count_errors(parsed));
+    }
+    state.SetBytesProcessed(state.iterations() * file.text().size());
+}
+BENCHMARK(lines_vector_then_successes)->Unit(benchmark::kMillisecond);
+#endif
+
+
+//=== Many expects in one hot function ===
+// The size of ten_steps_cppmatch and ten_steps_cppmatch_cold is what expect_cold
+// is meant to shrink; see code_size.txt next to the benchmark binary.
+
+[[gnu::noinline]] Result<unsigned, invalid_value> checked_step(unsigned x) {
+    if (x > 1'000'000) return invalid_value{std::to_string(x) + " overflows"};
+    return x * 3 + 1;
+}
+
+Result<unsigned, invalid_value> ten_steps_cppmatch(unsigned x) {
+    x = expect(checked_step(x)); x = expect(checked_step(x));
+    x = expect(checked_step(x)); x = expect(checked_step(x));
+    x = expect(checked_step(x)); x = expect(checked_step(x));
+    x = expect(checked_step(x)); x = expect(checked_step(x));
+    x = expect(checked_step(x)); x = expect(checked_step(x));
+    return x;
+}
+
+Result<unsigned, invalid_value> ten_steps_cppmatch_cold(unsigned x) {
+    x = expect_cold(checked_step(x)); x = expect_cold(checked_step(x));
+    x = expect_cold(checked_step(x)); x = expect_cold(checked_step(x));
+    x = expect_cold(checked_step(x)); x = expect_cold(checked_step(x));
+    x = expect_cold(checked_step(x)); x = expect_cold(checked_step(x));
+    x = expect_cold(checked_step(x)); x = expect_cold(checked_step(x));
+    return x;
+}
+
+static void ten_expects_cppmatch(benchmark::State& state) {
+    unsigned seed = 0;
+    for (auto _ : state) {
+        auto res = ten_steps_cppmatch(seed++ & 7);
+        benchmark::DoNotOptimize(res);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(ten_expects_cppmatch);
+
+static void ten_expects_cppmatch_cold(benchmark::State& state) {
+    unsigned seed = 0;
+    for (auto _ : state) {
+        auto res = ten_steps_cppmatch_cold(seed++ & 7);
+        benchmark::DoNotOptimize(res);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(ten_expects_cppmatch_cold);
+
+// The same chain with an error code and a packed Result, returned in one register.
+enum class step_errc : std::uint8_t { overflow = 1 };
+template <> struct cppmatch::packed_result_traits<unsigned, step_errc>
+    : cppmatch::word_packing<unsigned, step_errc> {};
+
+[[gnu::noinline]] Result<unsigned, step_errc> checked_step_packed(unsigned x) {
+    if (x > 1'000'000) return step_errc::overflow;
+    return x * 3 + 1;
+}
+
+Result<unsigned, step_errc> ten_steps_packed(unsigned x) {
+    x = expect(checked_step_packed(x)); x = expect(checked_step_packed(x));
+    x = expect(checked_step_packed(x)); x = expect(checked_step_packed(x));
+    x = expect(checked_step_packed(x)); x = expect(checked_step_packed(x));
+    x = expect(checked_step_packed(x)); x = expect(checked_step_packed(x));
+    x = expect(checked_step_packed(x)); x = expect(checked_step_packed(x));
+    return x;
+}
+
+static void ten_expects_packed(benchmark::State& state) {
+    unsigned seed = 0;
+    for (auto _ : state) {
+        auto res = ten_steps_packed(seed++ & 7);
+        benchmark::DoNotOptimize(res);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(ten_expects_packed);
+
+
+//=== Parameterized sweeps ===
+// A call chain of `depth` frames where the innermost call fails for `error_pct`
+// percent of the iterations. The failing alternative is the last of K in the
+// Error, and its payload type is swept separately.
+
+struct empty_payload {
+    static empty_payload make() { return {}; }
+};
+struct view_payload {
+    std::string_view message;
+    static view_payload make() { return {"string_view payload"}; }
+};
+struct string_payload {
+    std::string message;
+    static string_payload make() { return {"std::string payload, longer than the small string buffer"}; }
+};
+struct big_payload {
+    std::array<char, 256> bytes;
+    static big_payload make() { return {}; }
+};
+
+// Every payload above comes from its make(). Boxed<big_payload>, which keeps
+// the 256 bytes out of line so the Result stays pointer-sized, boxes one.
+template <typename Payload> Payload make_payload() {
+    if constexpr (cppmatch::cppmatch_detail::is_boxed_v<Payload>)
+        return Payload(Payload::element_type::make());
+    else
+        return Payload::make();
+}
+
+template <std::size_t I> struct other_error {};
+
+template <typename Payload, typename Seq> struct error_set;
+template <typename Payload, std::size_t... I>
+struct error_set<Payload, std::index_sequence<I...>> {
+    using cppmatch_error = Error<other_error<I>..., Payload>;
+    using variant_error = std::variant<other_error<I>..., Payload>;
+};
+
+// Seeded, so every approach and every run sees the same sequence of failures.
+std::vector<char> make_failure_pattern(std::int64_t error_pct) {
+    std::mt19937 gen(42);
+    std::bernoulli_distribution fails(error_pct / 100.0);
+    std::vector<char> pattern(4096);
+    for (auto& f : pattern) f = fails(gen);
+    return pattern;
+}
+
+template <typename Payload, std::size_t K>
+struct sweep {
+    using errors = error_set<Payload, std::make_index_sequence<K - 1>>;
+    using cppmatch_result = Result<unsigned, typename errors::cppmatch_error>;
+    using expected_result = std::expected<unsigned, typename errors::variant_error>;
+
+    static expected_result chain_expected(unsigned depth, bool fail) {
+        if (depth == 0) {
+            if (fail) return std::unexpected(typename errors::variant_error{make_payload<Payload>()});
+            return 1U;
+        }
+        auto r = chain_expected(depth - 1, fail);
+        if (!r) return std::unexpected(std::move(r.error()));
+        return *r + 1;
+    }
+
+    static cppmatch_result chain_cppmatch(unsigned depth, bool fail) {
+        if (depth == 0) {
+            if (fail) return make_payload<Payload>();
+            return 1U;
+        }
+        return expect(chain_cppmatch(depth - 1, fail)) + 1;
+    }
+
+    static cppmatch_result chain_cppmatch_with_exceptions(unsigned depth, bool fail) {
+        if (depth == 0) {
+            if (fail) return make_payload<Payload>();
+            return 1U;
+        }
+        return expect_e(chain_cppmatch_with_exceptions(depth - 1, fail)) + 1;
+    }
+
+    static unsigned chain_throws(unsigned depth, bool fail) {
+        if (depth == 0) {
+            if (fail) throw make_payload<Payload>();
+            return 1U;
+        }
+        return chain_throws(depth - 1, fail) + 1;
+    }
+};
+
+static void sweep_args(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"error_pct", "depth"})->ArgsProduct({{0, 1, 10, 50, 100}, {1, 4, 16}});
+}
+
+template <typename Payload, std::size_t K>
+static void sweep_expected(benchmark::State& state) {
+    const auto failures = make_failure_pattern(state.range(0));
+    const unsigned depth = state.range(1);
+    std::size_t i = 0;
+    for (auto _ : state) {
+        auto res = sweep<Payload, K>::chain_expected(depth, failures[i++ % failures.size()]);
+        benchmark::DoNotOptimize(res);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+template <typename Payload, std::size_t K>
+static void sweep_cppmatch(benchmark::State& state) {
+    const auto failures = make_failure_pattern(state.range(0));
+    const unsigned depth = state.range(1);
+    std::size_t i = 0;
+    for (auto _ : state) {
+        auto res = sweep<Payload, K>::chain_cppmatch(depth, failures[i++ % failures.size()]);
+        benchmark::DoNotOptimize(res);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+template <typename Payload, std::size_t K>
+static void sweep_cppmatch_with_exceptions(benchmark::State& state) {
+    const auto failures = make_failure_pattern(state.range(0));
+    const unsigned depth = state.range(1);
+    std::size_t i = 0;
+    for (auto _ : state) {
+        using chain = sweep<Payload, K>;
+        const bool fail = failures[i++ % failures.size()];
+        auto res = match_e(chain::chain_cppmatch_with_exceptions(depth, fail),
+                           [](unsigned v) { return v; },
+                           [](const auto&) { return 0U; });
+        benchmark::DoNotOptimize(res);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+template <typename Payload, std::size_t K>
+static void sweep_throws(benchmark::State& state) {
+    const auto failures = make_failure_pattern(state.range(0));
+    const unsigned depth = state.range(1);
+    std::size_t i = 0;
+    for (auto _ : state) {
+        try {
+            auto res = sweep<Payload, K>::chain_throws(depth, failures[i++ % failures.size()]);
+            benchmark::DoNotOptimize(res);
+        } catch (const Payload& e) {
+            benchmark::DoNotOptimize(e);
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+#define SWEEP_APPROACHES(PAYLOAD, K)                                            \
+    BENCHMARK_TEMPLATE(sweep_expected, PAYLOAD, K)->Apply(sweep_args);          \
+    BENCHMARK_TEMPLATE(sweep_cppmatch, PAYLOAD, K)->Apply(sweep_args);          \
+    BENCHMARK_TEMPLATE(sweep_cppmatch_with_exceptions, PAYLOAD, K)->Apply(sweep_args); \
+    BENCHMARK_TEMPLATE(sweep_throws, PAYLOAD, K)->Apply(sweep_args)
+
+// Error payload type, with 3 alternatives in the Error.
+SWEEP_APPROACHES(empty_payload, 3);
+SWEEP_APPROACHES(view_payload, 3);
+SWEEP_APPROACHES(string_payload, 3);
+SWEEP_APPROACHES(big_payload, 3);
+SWEEP_APPROACHES(Boxed<big_payload>, 3);
+
+// Number of alternatives in the Error, with a string_view payload.
+SWEEP_APPROACHES(view_payload, 1);
+SWEEP_APPROACHES(view_payload, 6);
+SWEEP_APPROACHES(view_payload, 12);
+
+
+//=== Batch extraction ===
+// A batch of Results with std::string payloads on both sides, 10% errors.
+
+using batch_result = Result<std::string, Error<std::string>>;
+
+std::vector<batch_result> make_batch(std::int64_t size) {
+    std::vector<batch_result> batch;
+    batch.reserve(size);
+    for (std::int64_t i = 0; i < size; ++i) {
+        std::string text = "record number " + std::to_string(i) + " with a heap payload";
+        if (i % 10 == 0) batch.emplace_back(Error<std::string>{std::move(text)});
+        else batch.emplace_back(std::move(text));
+    }
+    return batch;
+}
+
+static void batch_successes_by_reference(benchmark::State& state) {
+    const auto batch = make_batch(state.range(0));
+    for (auto _ : state) {
+        std::size_t total = 0;
+        for (const std::string& s : batch | cppmatch::successes)
+            total += s.size();
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(batch_successes_by_reference)->Arg(1 << 16);
+
+static void batch_successes_moved(benchmark::State& state) {
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto batch = make_batch(state.range(0));
+        state.ResumeTiming();
+        std::vector<std::string> oks;
+        oks.reserve(batch.size());
+        for (auto s : std::move(batch) | cppmatch::successes)
+            oks.push_back(std::move(s));
+        benchmark::DoNotOptimize(oks);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(batch_successes_moved)->Arg(1 << 16);
+
+static void batch_partition_results(benchmark::State& state) {
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto batch = make_batch(state.range(0));
+        state.ResumeTiming();
+        const std::size_t expected_errors = batch.size() / 10;
+        std::vector<std::string> oks;
+        std::vector<Error<std::string>> errs;
+        cppmatch::partition_results(std::move(batch), oks, errs, expected_errors);
+        benchmark::DoNotOptimize(oks);
+        benchmark::DoNotOptimize(errs);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(batch_partition_results)->Arg(1 << 16);
+
+
+// All values or the first error: one pass with collect_results against the two-pass
+// workaround (look for an error, then gather successes). The batch has no errors.
+std::vector<Result<int, Error<std::string>>> make_ok_batch(std::int64_t size) {
+    std::vector<Result<int, Error<std::string>>> batch;
+    batch.reserve(size);
+    for (std::int64_t i = 0; i < size; ++i)
+        batch.emplace_back(static_cast<int>(i));
+    return batch;
+}
+
+static void batch_collect(benchmark::State& state) {
+    const auto batch = make_ok_batch(state.range(0));
+    for (auto _ : state) {
+        auto all = batch | cppmatch::collect_results;
+        benchmark::DoNotOptimize(all);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(batch_collect)->Arg(1 << 16);
+
+static void batch_successes_then_check(benchmark::State& state) {
+    const auto batch = make_ok_batch(state.range(0));
+    for (auto _ : state) {
+        Result<std::vector<int>, Error<std::string>> all = std::vector<int>{};
+        auto failed = std::ranges::find_if(batch, [](const auto& r) { return is_err(r); });
+        if (failed != batch.end()) {
+            all = get<1>(*failed);
+        } else {
+            std::vector<int> values;
+            for (int v : batch | cppmatch::successes)
+                values.push_back(v);
+            all = std::move(values);
+        }
+        benchmark::DoNotOptimize(all);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(batch_successes_then_check)->Arg(1 << 16);
+
+
+// Row validation with the only error near the end of the batch, serial and parallel.
+static void batch_parallel_collect(benchmark::State& state) {
+    std::vector<int> rows(state.range(0));
+    for (std::size_t i = 0; i < rows.size(); ++i) rows[i] = static_cast<int>(i);
+    const int bad_row = static_cast<int>(rows.size() * 9 / 10);
+    auto validate = [bad_row](int x) -> Result<int, std::string> {
+        if (x == bad_row) return std::string("invalid row");
+        return x * 2;
+    };
+    for (auto _ : state) {
+        auto res = state.range(1) ? cppmatch::parallel_collect(std::execution::par, rows, validate)
+                                  : cppmatch::parallel_collect(std::execution::seq, rows, validate);
+        benchmark::DoNotOptimize(res);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(batch_parallel_collect)->ArgNames({"rows", "parallel"})->ArgsProduct({{1 << 20}, {0, 1}});
+
+
+// Summing the success values of a batch with 1% errors: a vector of Results
+// against a ResultVector.
+static void batch_sum_vector_of_results(benchmark::State& state) {
+    std::vector<Result<double, Error<std::string>>> batch;
+    for (std::int64_t i = 0; i < state.range(0); ++i) {
+        if (i % 100 == 0) batch.emplace_back(Error<std::string>{std::string("bad")});
+        else batch.emplace_back(static_cast<double>(i));
+    }
+    for (auto _ : state) {
+        double sum = 0;
+        for (double v : batch | cppmatch::successes)
+            sum += v;
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(batch_sum_vector_of_results)->Arg(1 << 16);
+
+static void batch_sum_result_vector(benchmark::State& state) {
+    ResultVector<double, Error<std::string>> batch;
+    for (std::int64_t i = 0; i < state.range(0); ++i) {
+        if (i % 100 == 0) batch.emplace_error(std::string("bad"));
+        else batch.emplace_value(static_cast<double>(i));
+    }
+    for (auto _ : state) {
+        double sum = 0;
+        for (double v : batch | cppmatch::successes)
+            sum += v;
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(batch_sum_result_vector)->Arg(1 << 16);
+
+
+// Health-check scans over a batch with 1% errors.
+static void batch_count_errors(benchmark::State& state) {
+    std::vector<Result<double, Error<std::string>>> batch;
+    for (std::int64_t i = 0; i < state.range(0); ++i) {
+        if (i % 100 == 99) batch.emplace_back(Error<std::string>{std::string("bad")});
+        else batch.emplace_back(static_cast<double>(i));
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(cppmatch::count_errors(batch));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(batch_count_errors)->Arg(1 << 16);
+
+static void batch_count_errors_scalar_loop(benchmark::State& state) {
+    std::vector<Result<double, Error<std::string>>> batch;
+    for (std::int64_t i = 0; i < state.range(0); ++i) {
+        if (i % 100 == 99) batch.emplace_back(Error<std::string>{std::string("bad")});
+        else batch.emplace_back(static_cast<double>(i));
+    }
+    for (auto _ : state) {
+        std::size_t count = 0;
+        for (const auto& r : batch)
+            count += is_err(r);
+        benchmark::DoNotOptimize(count);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(batch_count_errors_scalar_loop)->Arg(1 << 16);
+
+
+// ---------------------------------------------------------------------------
+// A request handler as a chain of combinators: the same three steps over the
+// same requests, fused with | or run eagerly one Result at a time.
+
+struct bad_request { std::string reason; };
+struct forbidden {};
+using request_result = Result<std::string, Error<bad_request>>;
+using reply_result = Result<std::string, Error<bad_request, forbidden>>;
+
+static request_result read_request(const std::string& raw) {
+    if (raw.empty()) return bad_request{"empty request"};
+    return raw;
+}
+
+static std::string strip_prefix(std::string&& s) {
+    s.erase(0, s.find('/') + 1);
+    return std::move(s);
+}
+
+static reply_result authorize(std::string&& path) {
+    if (path.starts_with("admin")) return forbidden{};
+    return std::move(path);
+}
+
+static std::string render(std::string&& path) {
+    path.append(" 200 OK");
+    return std::move(path);
+}
+
+static const std::vector<std::string>& request_corpus() {
+    static const std::vector<std::string> corpus = [] {
+        std::vector<std::string> out;
+        for (int i = 0; i < 1024; ++i)
+            out.push_back(i % 50 == 0 ? std::string() : i % 50 == 1 ? "GET /admin/panel/settings" : "GET /static/assets/item-" + std::to_string(i));
+        return out;
+    }();
+    return corpus;
+}
+
+static void combinators_fused(benchmark::State& state) {
+    const auto& corpus = request_corpus();
+    for (auto _ : state) {
+        for (const auto& raw : corpus) {
+            reply_result reply = read_request(raw) | transform(strip_prefix) | and_then(authorize) | transform(render);
+            benchmark::DoNotOptimize(reply);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * corpus.size());
+}
+BENCHMARK(combinators_fused);
+
+static void combinators_eager(benchmark::State& state) {
+    const auto& corpus = request_corpus();
+    for (auto _ : state) {
+        for (const auto& raw : corpus) {
+            auto stripped = transform(read_request(raw), strip_prefix);
+            auto authorized = and_then(std::move(stripped), authorize);
+            reply_result reply = transform(std::move(authorized), render);
+            benchmark::DoNotOptimize(reply);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * corpus.size());
+}
+BENCHMARK(combinators_eager);
+
+// ---------------------------------------------------------------------------
+// Correlating an event stream with lookup results: nested matches branch
+// twice per pair, match(std::tie(...)) jumps once on the combined index.
+
+namespace {
+struct session_missing {};
+struct ev_open { int id; };
+struct ev_data { int id; int bytes; };
+struct ev_close { int id; };
+using stream_event = std::variant<ev_open, ev_data, ev_close>;
+using session_lookup = Result<int, Error<session_missing, invalid_value>>;
+
+const std::vector<std::pair<stream_event, session_lookup>>& event_corpus() {
+    static const auto corpus = [] {
+        std::vector<std::pair<stream_event, session_lookup>> out;
+        std::mt19937 rng(7);
+        for (int i = 0; i < 4096; ++i) {
+            stream_event e;
+            switch (rng() % 3) {
+                case 0: e = ev_open{i}; break;
+                case 1: e = ev_data{i, int(rng() % 1500)}; break;
+                default: e = ev_close{i}; break;
+            }
+            session_lookup s = 0;
+            switch (rng() % 4) {
+                case 0: s = session_missing{}; break;
+                case 1: s = invalid_value{"stale"}; break;
+                default: s = int(rng() % 64); break;
+            }
+            out.emplace_back(std::move(e), std::move(s));
+        }
+        return out;
+    }();
+    return corpus;
+}
+} // namespace
+
+static void correlate_nested_match(benchmark::State& state) {
+    const auto& corpus = event_corpus();
+    for (auto _ : state) {
+        long acc = 0;
+        for (const auto& [event, session] : corpus) {
+            acc += match(event,
+                [&](const ev_open& o) { return match(session,
+                    [&](int s) { return long(o.id + s); },
+                    [](const session_missing&) { return 1L; },
+                    [](const invalid_value&) { return 2L; }); },
+                [&](const ev_data& d) { return match(session,
+                    [&](int s) { return long(d.bytes * s); },
+                    [](const session_missing&) { return 3L; },
+                    [](const invalid_value&) { return 4L; }); },
+                [&](const ev_close& c) { return match(session,
+                    [&](int s) { return long(c.id - s); },
+                    [](const session_missing&) { return 5L; },
+                    [](const invalid_value&) { return 6L; }); });
+        }
+        benchmark::DoNotOptimize(acc);
+    }
+    state.SetItemsProcessed(state.iterations() * corpus.size());
+}
+BENCHMARK(correlate_nested_match);
+
+static void correlate_tied_match(benchmark::State& state) {
+    const auto& corpus = event_corpus();
+    for (auto _ : state) {
+        long acc = 0;
+        for (const auto& [event, session] : corpus) {
+            acc += match(std::tie(event, session),
+                [](const ev_open& o, int s) { return long(o.id + s); },
+                [](const ev_data& d, int s) { return long(d.bytes * s); },
+                [](const ev_close& c, int s) { return long(c.id - s); },
+                [](const ev_open&, const session_missing&) { return 1L; },
+                [](const ev_open&, const invalid_value&) { return 2L; },
+                [](const ev_data&, const session_missing&) { return 3L; },
+                [](const ev_data&, const invalid_value&) { return 4L; },
+                [](const ev_close&, const session_missing&) { return 5L; },
+                [](const ev_close&, const invalid_value&) { return 6L; });
+        }
+        benchmark::DoNotOptimize(acc);
+    }
+    state.SetItemsProcessed(state.iterations() * corpus.size());
+}
+BENCHMARK(correlate_tied_match);
+
+// ---------------------------------------------------------------------------
+// An input-event router with several value arms per alternative: if-chains
+// inside type-only handlers, against pattern arms compiled into a decision tree.
+
+namespace {
+struct in_key { char c; };
+struct in_click { std::uint32_t x, y; };
+struct in_scroll { int delta; };
+using input_event = std::variant<in_key, in_click, in_scroll>;
+
+const std::vector<input_event>& input_corpus() {
+    static const auto corpus = [] {
+        std::vector<input_event> out;
+        std::mt19937 rng(11);
+        for (int i = 0; i < 4096; ++i) {
+            switch (rng() % 3) {
+                case 0: out.push_back(in_key{char(rng() % 128)}); break;
+                case 1: out.push_back(in_click{std::uint32_t(rng() % 400), std::uint32_t(rng() % 400)}); break;
+                default: out.push_back(in_scroll{int(rng() % 41) - 20}); break;
+            }
+        }
+        return out;
+    }();
+    return corpus;
+}
+} // namespace
+
+static void router_if_chains(benchmark::State& state) {
+    const auto& corpus = input_corpus();
+    for (auto _ : state) {
+        long acc = 0;
+        for (const auto& event : corpus) {
+            acc += match(event,
+                [](const in_key& k) {
+                    if (k.c == 'q') return 1;
+                    if (k.c >= '0' && k.c <= '9') return 2;
+                    if (k.c >= 'a' && k.c <= 'z') return 3;
+                    if (k.c >= 'A' && k.c <= 'Z') return 4;
+                    return 0;
+                },
+                [](const in_click& c) {
+                    if (c.x < 100 && c.y < 100) return 5;
+                    if (c.x < 100 && c.y < 200) return 6;
+                    if (c.x < 100) return 7;
+                    if (c.x < 200 && c.y < 100) return 8;
+                    if (c.x < 200) return 9;
+                    if (c.y < 100) return 10;
+                    return 0;
+                },
+                [](const in_scroll& s) {
+                    if (s.delta == 0) return 0;
+                    if (s.delta >= 1 && s.delta <= 20) return 11;
+                    return 12;
+                });
+        }
+        benchmark::DoNotOptimize(acc);
+    }
+    state.SetItemsProcessed(state.iterations() * corpus.size());
+}
+BENCHMARK(router_if_chains);
+
+static void router_patterns(benchmark::State& state) {
+    const auto& corpus = input_corpus();
+    constexpr auto key = field<&in_key::c>;
+    constexpr auto x = field<&in_click::x>;
+    constexpr auto y = field<&in_click::y>;
+    for (auto _ : state) {
+        long acc = 0;
+        for (const auto& event : corpus) {
+            acc += match(event,
+                on<in_key>(key(equals<'q'>)) >> [](const in_key&) { return 1; },
+                on<in_key>(key(in_range<'0', '9'>)) >> [](const in_key&) { return 2; },
+                on<in_key>(key(in_range<'a', 'z'>)) >> [](const in_key&) { return 3; },
+                on<in_key>(key(in_range<'A', 'Z'>)) >> [](const in_key&) { return 4; },
+                on<in_click>(x(in_range<0, 99>), y(in_range<0, 99>)) >> [](const in_click&) { return 5; },
+                on<in_click>(x(in_range<0, 99>), y(in_range<0, 199>)) >> [](const in_click&) { return 6; },
+                on<in_click>(x(in_range<0, 99>)) >> [](const in_click&) { return 7; },
+                on<in_click>(x(in_range<0, 199>), y(in_range<0, 99>)) >> [](const in_click&) { return 8; },
+                on<in_click>(x(in_range<0, 199>)) >> [](const in_click&) { return 9; },
+                on<in_click>(y(in_range<0, 99>)) >> [](const in_click&) { return 10; },
+                on<in_scroll>(field<&in_scroll::delta>(equals<0>)) >> [](const in_scroll&) { return 0; },
+                on<in_scroll>(field<&in_scroll::delta>(in_range<1, 20>)) >> [](const in_scroll&) { return 11; },
+                on<in_scroll>() >> [](const in_scroll&) { return 12; },
+                otherwise >> [](const auto&) { return 0; });
+        }
+        benchmark::DoNotOptimize(acc);
+    }
+    state.SetItemsProcessed(state.iterations() * corpus.size());
+}
+BENCHMARK(router_patterns);
+
+// ---------------------------------------------------------------------------
+// A mixed telemetry stream: match per element, match_each in order, and
+// match_each grouped by alternative.
+
+namespace {
+struct tm_load { std::uint32_t page; };
+struct tm_unload { std::uint32_t page; };
+struct tm_key { char c; };
+struct tm_paste { std::uint32_t bytes; };
+struct tm_click { std::uint32_t x, y; };
+using telemetry_event = std::variant<tm_load, tm_unload, tm_key, tm_paste, tm_click>;
+
+const std::vector<telemetry_event>& telemetry_corpus() {
+    static const auto corpus = [] {
+        std::vector<telemetry_event> out;
+        std::mt19937 rng(5);
+        // mt19937::result_type is wider than uint32_t on LP64.
+        auto below = [&](std::uint32_t n) { return static_cast<std::uint32_t>(rng() % n); };
+        for (int i = 0; i < (1 << 20); ++i) {
+            switch (below(5)) {
+                case 0: out.push_back(tm_load{below(1000)}); break;
+                case 1: out.push_back(tm_unload{below(1000)}); break;
+                case 2: out.push_back(tm_key{char('a' + below(26))}); break;
+                case 3: out.push_back(tm_paste{below(4096)}); break;
+                default: out.push_back(tm_click{below(1920), below(1080)}); break;
+            }
+        }
+        return out;
+    }();
+    return corpus;
+}
+
+struct telemetry_totals {
+    std::uint64_t pages = 0, keys = 0, bytes = 0, clicks = 0;
+    auto handlers() {
+        return std::tuple(
+            [this](const tm_load& e) { pages += e.page; },
+            [this](const tm_unload& e) { pages -= e.page; },
+            [this](const tm_key& e) { keys += std::uint64_t(e.c); },
+            [this](const tm_paste& e) { bytes += e.bytes; },
+            [this](const tm_click& e) { clicks += e.x ^ e.y; });
+    }
+};
+} // namespace
+
+static void telemetry_match_loop(benchmark::State& state) {
+    const auto& corpus = telemetry_corpus();
+    for (auto _ : state) {
+        telemetry_totals totals;
+        auto [load, unload, key, paste, click] = totals.handlers();
+        for (const auto& event : corpus)
+            match(event, load, unload, key, paste, click);
+        benchmark::DoNotOptimize(totals);
+    }
+    state.SetItemsProcessed(state.iterations() * corpus.size());
+}
+BENCHMARK(telemetry_match_loop);
+
+static void telemetry_match_each_in_order(benchmark::State& state) {
+    const auto& corpus = telemetry_corpus();
+    for (auto _ : state) {
+        telemetry_totals totals;
+        std::apply([&](auto... h) { match_each(in_order, corpus, h...); }, totals.handlers());
+        benchmark::DoNotOptimize(totals);
+    }
+    state.SetItemsProcessed(state.iterations() * corpus.size());
+}
+BENCHMARK(telemetry_match_each_in_order);
+
+static void telemetry_match_each_bucketed(benchmark::State& state) {
+    const auto& corpus = telemetry_corpus();
+    for (auto _ : state) {
+        telemetry_totals totals;
+        std::apply([&](auto... h) { match_each(bucketed, corpus, h...); }, totals.handlers());
+        benchmark::DoNotOptimize(totals);
+    }
+    state.SetItemsProcessed(state.iterations() * corpus.size());
+}
+BENCHMARK(telemetry_match_each_bucketed);
+
+// ---------------------------------------------------------------------------
+// Unwrapping a multi-KB payload with a default: copied out of an lvalue,
+// moved out of an rvalue, or with the default built only when needed.
+
+static Result<std::vector<double>, invalid_value> load_samples(bool ok) {
+    if (!ok) return invalid_value{"no samples"};
+    return std::vector<double>(512, 1.0);
+}
+
+static void payload_default_expect_copy(benchmark::State& state) {
+    for (auto _ : state) {
+        auto r = load_samples(true);
+        auto samples = default_expect(r, std::vector<double>(512, 0.0));
+        benchmark::DoNotOptimize(samples);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(payload_default_expect_copy);
+
+static void payload_default_expect_move(benchmark::State& state) {
+    for (auto _ : state) {
+        auto samples = default_expect(load_samples(true), std::vector<double>(512, 0.0));
+        benchmark::DoNotOptimize(samples);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(payload_default_expect_move);
+
+static void payload_default_expect_with(benchmark::State& state) {
+    for (auto _ : state) {
+        auto samples = default_expect_with(load_samples(true), [] { return std::vector<double>(512, 0.0); });
+        benchmark::DoNotOptimize(samples);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(payload_default_expect_with);
+
+// ---------------------------------------------------------------------------
+// An error storm: every request fails three calls deep with a formatted
+// message, widened through three Error types on the way up. The message is a
+// std::string (one malloc and free per error, plus a copy per widening of an
+// lvalue) or an arena_string in a per-request error_arena.
+
+namespace {
+struct storm_timeout { int ms; };
+struct storm_denied { int user; };
+
+template <typename Msg> Msg storm_message(int id);
+template <> std::string storm_message<std::string>(int id) {
+    return std::format("request {} failed: upstream shard {} unavailable", id, id % 17);
+}
+template <> arena_string storm_message<arena_string>(int id) {
+    return arena_string::format("request {} failed: upstream shard {} unavailable", id, id % 17);
+}
+
+template <typename Msg> [[gnu::noinline]] Result<int, Error<Msg>> storm_fetch(int id) {
+    if (id >= 0) return storm_message<Msg>(id);
+    return id;
+}
+template <typename Msg> [[gnu::noinline]] Result<int, Error<Msg, storm_timeout>> storm_query(int id) {
+    return expect(storm_fetch<Msg>(id)) + 1;
+}
+template <typename Msg>
+[[gnu::noinline]] Result<int, Error<Msg, storm_timeout, storm_denied>> storm_handle(int id) {
+    Result<int, Error<Msg, storm_timeout>> r = storm_query<Msg>(id);
+    return expect(r) + 1;
+}
+
+template <typename Msg> void error_storm(benchmark::State& state) {
+    int id = 0;
+    for (auto _ : state) {
+        std::size_t bytes = 0;
+        if constexpr (std::is_same_v<Msg, arena_string>) {
+            error_arena request;
+            bytes = match(storm_handle<Msg>(id++), [](int) { return std::size_t(0); },
+                          [](const Msg& m) { return m.size(); }, [](const auto&) { return std::size_t(0); });
+        } else {
+            bytes = match(storm_handle<Msg>(id++), [](int) { return std::size_t(0); },
+                          [](const Msg& m) { return m.size(); }, [](const auto&) { return std::size_t(0); });
+        }
+        benchmark::DoNotOptimize(bytes);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+} // namespace
+
+static void error_storm_std_string(benchmark::State& state) { error_storm<std::string>(state); }
+BENCHMARK(error_storm_std_string)->ThreadRange(1, 8)->UseRealTime();
+
+static void error_storm_arena_string(benchmark::State& state) { error_storm<arena_string>(state); }
+BENCHMARK(error_storm_arena_string)->ThreadRange(1, 8)->UseRealTime();
+
+// ---------------------------------------------------------------------------
+// Growing a vector of Results: the move constructor is noexcept when the
+// payloads' are, so reallocation moves; a payload whose move may throw makes
+// it copy every element instead.
+
+namespace {
+struct nothrow_note {
+    std::string text;
+};
+struct throwing_note {
+    std::string text;
+    throwing_note(std::string t) : text(std::move(t)) {}
+    throwing_note(const throwing_note&) = default;
+    throwing_note(throwing_note&& other) noexcept(false) : text(std::move(other.text)) {}
+};
+static_assert(std::is_nothrow_move_constructible_v<Result<std::string, Error<nothrow_note, int>>>);
+static_assert(!std::is_nothrow_move_constructible_v<Result<std::string, Error<throwing_note, int>>>);
+
+template <typename Note> void grow_results(benchmark::State& state) {
+    for (auto _ : state) {
+        std::vector<Result<std::string, Error<Note, int>>> results;
+        for (int i = 0; i < 4096; ++i) {
+            if (i % 4 == 0)
+                results.emplace_back(Note{std::string(48, 'e')});
+            else
+                results.emplace_back(std::string(48, 'v'));
+        }
+        benchmark::DoNotOptimize(results.data());
+    }
+    state.SetItemsProcessed(state.iterations() * 4096);
+}
+} // namespace
+
+static void vector_growth_nothrow_payload(benchmark::State& state) { grow_results<nothrow_note>(state); }
+BENCHMARK(vector_growth_nothrow_payload);
+
+static void vector_growth_throwing_payload(benchmark::State& state) { grow_results<throwing_note>(state); }
+BENCHMARK(vector_growth_throwing_payload);
+
+// ---------------------------------------------------------------------------
+// Async handlers: a chain of `depth` awaited tasks whose leaf fails in
+// error_pct percent of the requests, the error travelling as a Result or as
+// an exception rethrown at the top.
+
+Task<Result<unsigned, invalid_value>> async_chain_result(unsigned depth, bool fail) {
+    if (depth == 0) {
+        if (fail) co_return invalid_value{"backend unavailable"};
+        co_return 1U;
+    }
+    co_return co_await async_chain_result(depth - 1, fail) + 1;
+}
+
+Task<Result<unsigned, invalid_value>> async_chain_throwing(unsigned depth, bool fail) {
+    if (depth == 0) {
+        if (fail) throw invalid_value{"backend unavailable"};
+        co_return 1U;
+    }
+    co_return co_await async_chain_throwing(depth - 1, fail) + 1;
+}
+
+static void async_chain_args(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"error_pct", "depth"})->ArgsProduct({{0, 10, 100}, {4, 16}});
+}
+
+static void async_chain_result_errors(benchmark::State& state) {
+    unsigned request = 0;
+    for (auto _ : state) {
+        bool fail = request++ % 100 < static_cast<unsigned>(state.range(0));
+        auto res = sync_wait(async_chain_result(state.range(1), fail));
+        benchmark::DoNotOptimize(res);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(async_chain_result_errors)->Apply(async_chain_args);
+
+static void async_chain_exceptions(benchmark::State& state) {
+    unsigned request = 0;
+    for (auto _ : state) {
+        bool fail = request++ % 100 < static_cast<unsigned>(state.range(0));
+        try {
+            auto res = sync_wait(async_chain_throwing(state.range(1), fail));
+            benchmark::DoNotOptimize(res);
+        } catch (const invalid_value& e) {
+            benchmark::DoNotOptimize(e);
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(async_chain_exceptions)->Apply(async_chain_args);
+
+static void async_when_all_results(benchmark::State& state) {
+    work_stealing_executor executor(std::max(1u, std::thread::hardware_concurrency()));
+    for (auto _ : state) {
+        std::vector<Task<Result<unsigned, invalid_value>>> handlers;
+        for (std::int64_t i = 0; i < state.range(0); ++i)
+            handlers.push_back(async_chain_result(4, false));
+        auto res = sync_wait(executor, when_all_results(std::move(handlers)));
+        benchmark::DoNotOptimize(res);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(async_when_all_results)->Arg(64)->UseRealTime();
 
 BENCHMARK_MAIN();
\ No newline at end of file
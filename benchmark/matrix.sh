@@ -0,0 +1,56 @@
+#!/usr/bin/env bash
+# Runs the benchmark binaries of several compilers and writes one JSON file
+# to compare across commits.
+#
+# usage: matrix.sh OUT_DIR NAME=BINARY [NAME=BINARY...]
+#   e.g. matrix.sh results gcc=./cppmatch_benchmark_gcc clang=./cppmatch_benchmark
+#
+# Environment:
+#   CPPMATCH_BENCH_FILTER   benchmarks to run (default: the fib and coordinate families)
+#   CPPMATCH_PERF_COUNTERS  libpfm event names, comma separated
+#   CPPMATCH_BENCH_REPS     repetitions per benchmark (default 5)
+#   CPPMATCH_BENCH_CPU      CPU to pin to with taskset, when available (default 0)
+#   CPPMATCH_COMMIT         recorded in the output (default: git rev-parse HEAD)
+#
+# Writes OUT_DIR/NAME.json (Google Benchmark output, with the counters as
+# extra fields of each run), OUT_DIR/NAME.code_size.json and OUT_DIR/matrix.json,
+# which holds all of them keyed by NAME.
+set -euo pipefail
+
+out=$1
+shift
+here=$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)
+filter=${CPPMATCH_BENCH_FILTER:-'^(recursive_fib|coord)_'}
+counters=${CPPMATCH_PERF_COUNTERS:-INSTRUCTIONS,BRANCH-MISSES,L1I:READ:MISS}
+reps=${CPPMATCH_BENCH_REPS:-5}
+cpu=${CPPMATCH_BENCH_CPU:-0}
+commit=${CPPMATCH_COMMIT:-$(git rev-parse HEAD 2>/dev/null || echo unknown)}
+
+pin=()
+if command -v taskset > /dev/null; then
+  pin=(taskset -c "$cpu")
+fi
+
+mkdir -p "$out"
+args=(--arg commit "$commit")
+entries=()
+for spec in "$@"; do
+  name=${spec%%=*}
+  binary=${spec#*=}
+  # Interleaved repetitions spread slow drifts (frequency, other load) over
+  # all benchmarks instead of biasing whichever ran last.
+  "${pin[@]}" "$binary" \
+    --benchmark_filter="$filter" \
+    --benchmark_repetitions="$reps" \
+    --benchmark_enable_random_interleaving=true \
+    --benchmark_report_aggregates_only=true \
+    --benchmark_perf_counters="$counters" \
+    --benchmark_out="$out/$name.json" \
+    --benchmark_out_format=json > /dev/null
+  bash "$here/code_size.sh" "$binary" > "$out/$name.code_size.json"
+  args+=(--slurpfile "${name}_bench" "$out/$name.json" --slurpfile "${name}_size" "$out/$name.code_size.json")
+  entries+=("\"$name\": {context: \$${name}_bench[0].context, benchmarks: \$${name}_bench[0].benchmarks, code_size: \$${name}_size[0]}")
+done
+
+jq -n "${args[@]}" "{commit: \$commit, compilers: {$(IFS=,; echo "${entries[*]}")}}" > "$out/matrix.json"
+echo "wrote $out/matrix.json"
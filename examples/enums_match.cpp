@@ -29,7 +29,8 @@ int main()
         WebEvent::Click{32, 64},
         WebEvent::KeyPress{'z'},
         WebEvent::Paste{"Another paste"},
-        WebEvent::Click{100, 200}
+        WebEvent::Click{100, 200},
+        WebEvent::KeyPress{'q'}
     };
 
     // Process each event in the vector
@@ -52,6 +53,20 @@ int main()
             }
         );
     }
+
+    // Value patterns: the arms written for one alternative are checked as a
+    // single decision tree, after the type dispatch.
+    using KeyPress = WebEvent::KeyPress;
+    using Click = WebEvent::Click;
+    for (const auto& event : events) {
+        auto action = match(event,
+            on<KeyPress>(field<&KeyPress::c>(equals<'q'>)) >> [](const KeyPress&) { return "quit"; },
+            on<Click>(field<&Click::x>(in_range<0, 49>), field<&Click::y>(in_range<0, 99>))
+                >> [](const Click&) { return "toolbar click"; },
+            on<Click>() >> [](const Click&) { return "content click"; },
+            otherwise >> [](const auto&) { return "ignored"; });
+        std::print("{}\n", action);
+    }
     
     return 0;
 }
\ No newline at end of file
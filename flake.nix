@@ -52,13 +52,67 @@
             }
           ) exampleFiles
         );
+
+        # Perf counters come from libpfm, which Google Benchmark only supports on Linux.
+        pfmLibs = pkgs.lib.optionals pkgs.stdenv.isLinux [ pkgs.libpfm ];
+        pfmLink = pkgs.lib.optionalString pkgs.stdenv.isLinux "-lpfm";
+
+        # The benchmark suite for one compiler, with a per-function code-size report.
+        mkBenchmark =
+          { stdenv, cxx, pname }:
+          stdenv.mkDerivation {
+            inherit pname;
+            version = match_version;
+            src = ./.;
+            buildInputs = [ google-benchmark ] ++ pfmLibs;
+            configurePhase = "";
+            buildPhase = ''
+              ${cxx} -std=c++23  -g -O3 benchmark/main.cpp -Iinclude -I${google-benchmark}/include -L${google-benchmark}/lib -lbenchmark ${pfmLink} -pthread -o cppmatch_benchmark
+            '';
+            installPhase = ''
+              mkdir -p $out/bin $out/share
+              cp cppmatch_benchmark $out/bin/
+              # Code size of the benchmarked functions, hot and [clone .cold] parts.
+              nm -C -S --size-sort cppmatch_benchmark | grep -E ' (do_fib_|parse_coordinate_|ten_steps_)' > $out/share/code_size.txt
+              bash benchmark/code_size.sh cppmatch_benchmark > $out/share/code_size.json
+            '';
+          };
       in
       {
+        # Runs the GCC and Clang builds with perf counters and writes one JSON
+        # file per commit: nix run .#benchmark-matrix -- OUT_DIR
+        apps.benchmark-matrix = {
+          type = "app";
+          program = "${
+            pkgs.writeShellApplication {
+              name = "cppmatch-benchmark-matrix";
+              runtimeInputs = [
+                pkgs.jq
+                pkgs.binutils
+                pkgs.util-linux
+                pkgs.git
+              ];
+              text = ''
+                exec bash ${./benchmark}/matrix.sh "''${1:-benchmark-results}" \
+                  gcc=${self.packages.${system}.benchmark-gcc}/bin/cppmatch_benchmark \
+                  clang=${self.packages.${system}.benchmark}/bin/cppmatch_benchmark
+              '';
+            }
+          }/bin/cppmatch-benchmark-matrix";
+        };
+
         # Development shell available on all systems.
         devShells.default = pkgs.mkShell {
           buildInputs = [ pkgs.gcc14 ];
         };
 
+        # On x86-64 the tests are also built with AVX2, which compiles the
+        # gathering path of count_errors, find_first_error and error_mask.
+        avx2Tests = pkgs.lib.optionalString pkgs.stdenv.hostPlatform.isx86_64 ''
+          g++ -std=c++23 test/main.cpp -g -O3 -Iinclude -pthread -mavx2 -o cppmatch_tests_avx2
+        '';
+        avx2Bin = pkgs.lib.optionalString pkgs.stdenv.hostPlatform.isx86_64 "cppmatch_tests_avx2";
+
         # Define packages: your tests plus all the examples.
         packages = pkgs.lib.recursiveUpdate {
           tests = pkgs.stdenv.mkDerivation {
@@ -67,25 +121,56 @@
             src = ./.;
             buildInputs = [ pkgs.gcc14 ];
             configurePhase = "";
-            buildPhase = "g++ -std=c++23 test/main.cpp -g -O3 -Iinclude -o cppmatch_tests";
+            buildPhase = ''
+              g++ -std=c++23 test/main.cpp -g -O3 -Iinclude -pthread -o cppmatch_tests
+              g++ -std=c++23 test/main.cpp -g -O3 -Iinclude -pthread -DCPPMATCH_INSTRUMENT -o cppmatch_tests_instrumented
+              g++ -std=c++23 test/main.cpp -g -O3 -Iinclude -pthread -DCPPMATCH_TRACE -o cppmatch_tests_traced
+              g++ -std=c++23 test/main.cpp -g -O3 -Iinclude -pthread -DCPPMATCH_ARENA_CHECKS -o cppmatch_tests_arena_checked
+              ${avx2Tests}
+            '';
             installPhase = ''
               mkdir -p $out/bin
-              cp cppmatch_tests $out/bin/
+              cp cppmatch_tests cppmatch_tests_instrumented cppmatch_tests_traced cppmatch_tests_arena_checked ${avx2Bin} $out/bin/
             '';
           };
 
-          benchmark = pkgs.llvmPackages_20.stdenv.mkDerivation {
+          benchmark = mkBenchmark {
+            stdenv = pkgs.llvmPackages_20.stdenv;
+            cxx = "clang++";
             pname = "cppmatch_benchmark";
+          };
+
+          # The same suite built with GCC, for the compiler matrix.
+          benchmark-gcc = mkBenchmark {
+            stdenv = pkgs.gcc14Stdenv;
+            cxx = "g++";
+            pname = "cppmatch_benchmark_gcc";
+          };
+
+          # Front-end time of a TU with N error types and M expect/match sites,
+          # so regressions in the type-level machinery show up as build time.
+          compile-benchmark = pkgs.stdenv.mkDerivation {
+            pname = "cppmatch_compile_benchmark";
             version = match_version;
             src = ./.;
-            buildInputs = [  google-benchmark];
+            buildInputs = [ pkgs.gcc14 ];
             configurePhase = "";
             buildPhase = ''
-              clang++ -std=c++23  -g -O3 benchmark/main.cpp -Iinclude -I${google-benchmark}/include -L${google-benchmark}/lib -lbenchmark -pthread -o cppmatch_benchmark
+              echo "errors sites seconds" > compile_times.txt
+              for errors in 8 16 24 32; do
+                for sites in 64 256; do
+                  start=$(date +%s%N)
+                  g++ -std=c++23 -O0 -fsyntax-only -Iinclude \
+                    -DCPPMATCH_CT_ERRORS=$errors -DCPPMATCH_CT_SITES=$sites benchmark/compile_time.cpp
+                  end=$(date +%s%N)
+                  ms=$(( (end - start) / 1000000 ))
+                  printf '%s %s %d.%03d\n' $errors $sites $(( ms / 1000 )) $(( ms % 1000 )) >> compile_times.txt
+                done
+              done
             '';
             installPhase = ''
-              mkdir -p $out/bin
-              cp cppmatch_benchmark $out/bin/
+              mkdir -p $out/share
+              cp compile_times.txt $out/share/
             '';
           };
         } examplesDerivations;
@@ -2,6 +2,7 @@
 , gcc14Stdenv
 , fetchFromGitHub
 , cmake
+, libpfm
 }:
 
 gcc14Stdenv.mkDerivation rec {
@@ -16,11 +17,13 @@ gcc14Stdenv.mkDerivation rec {
   };
 
   nativeBuildInputs = [ cmake ];
-  buildInputs = [  ];
+  # libpfm enables --benchmark_perf_counters (branch-misses, instructions, ...).
+  buildInputs = lib.optionals gcc14Stdenv.isLinux [ libpfm ];
 
   cmakeFlags = [
     "-DBENCHMARK_ENABLE_GTEST_TESTS=OFF"
     "-DBENCHMARK_ENABLE_TESTING=OFF"
+    "-DBENCHMARK_ENABLE_LIBPFM=${if gcc14Stdenv.isLinux then "ON" else "OFF"}"
   ];
 
   meta = with lib; {
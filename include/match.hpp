@@ -23,295 +23,3229 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <new>
+#include <optional>
 #include <ranges>
+#include <span>
+#include <string_view>
 #include <tuple>
 #include <type_traits>
 #include <utility>
 #include <variant>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#if defined(CPPMATCH_INSTRUMENT)
+#include <atomic>
+#include <mutex>
+#include <source_location>
+#include <unordered_map>
+#endif
+
+#if defined(CPPMATCH_TRACE)
+#include <source_location>
+#endif
 
 namespace cppmatch {
 
+template <typename T, typename E> class Result;
+template <typename E> class Boxed;
+template <typename E> class Contextual;
+
 /**
- * @brief A Result type alias representing either a success value or an error.
+ * @brief Opt-in description of a packed layout for Result<T, E>.
  *
- * @tparam T Type for the success value.
- * @tparam E Type for the error.
+ * Left disabled, Result<T, E> uses the union-plus-tag layout. Specializing it
+ * with enabled = true, usually by deriving from tagged_pointer_packing,
+ * niche_packing or word_packing, makes Result<T, E> a single trivially
+ * copyable word. A specialization provides:
+ * - `storage`, the trivially copyable word type;
+ * - `pack_value(T)` and `pack_error(E)`, returning a storage;
+ * - `is_error(storage)`, `value(storage)` and `error(storage)`.
+ */
+template <typename T, typename E> struct packed_result_traits {
+  static constexpr bool enabled = false;
+};
+
+namespace cppmatch_detail {
+
+/**
+ * @brief Single element array used to reject narrowing conversions.
+ *
+ * Mirrors the rule std::variant applies to its converting constructor, so a
+ * value only selects an alternative it can be list-initialized into.
+ *
+ * @tparam Ti The candidate alternative type.
+ */
+template <typename Ti> struct alternative_array {
+  Ti value[1];
+};
+
+/**
+ * @brief One imaginary overload F(Ti) of the converting constructor.
+ *
+ * Enabled only if U converts to Ti without narrowing.
+ *
+ * @tparam I Index of the alternative.
+ * @tparam Ti The alternative type.
+ * @tparam U The type of the constructor argument.
+ */
+template <std::size_t I, typename Ti, typename U>
+struct alternative_overload {
+  static void select();
+};
+
+template <std::size_t I, typename Ti, typename U>
+  requires requires { alternative_array<Ti>{{std::declval<U>()}}; }
+struct alternative_overload<I, Ti, U> {
+  static std::integral_constant<std::size_t, I> select(Ti);
+};
+
+/**
+ * @brief Overload set used to pick the alternative a value converts to.
+ *
+ * @tparam U The type of the constructor argument.
+ * @tparam T The success type.
+ * @tparam E The error type.
  */
+template <typename U, typename T, typename E>
+struct alternative_overloads : alternative_overload<0, T, U>,
+                               alternative_overload<1, E, U> {
+  using alternative_overload<0, T, U>::select;
+  using alternative_overload<1, E, U>::select;
+};
+
+/**
+ * @brief Index of the alternative of Result<T, E> selected by a value of type U.
+ */
+template <typename U, typename T, typename E>
+using selected_alternative_t =
+    decltype(alternative_overloads<U, T, E>::select(std::declval<U>()));
+
+/**
+ * @brief Trait to detect the Result type.
+ *
+ * @tparam T The type to check.
+ */
+template <typename T> struct is_result : std::false_type {};
 template <typename T, typename E>
-using Result = std::variant<T, E>;
+struct is_result<Result<T, E>> : std::true_type {};
 
 /**
- * @brief Type trait to check if type T is the same as one of the types in Ts.
+ * @brief Variable template for is_result.
  *
  * @tparam T The type to check.
- * @tparam Ts The candidate types.
  */
-template <typename T, typename... Ts>
-struct is_one_of : std::disjunction<std::is_same<T, Ts>...> {};
+template <typename T>
+constexpr bool is_result_v = is_result<std::decay_t<T>>::value;
+
+template <typename R, typename... Steps> class result_pipeline;
+
+/// Detects a pending chain of combinators over a Result.
+template <typename T> struct is_result_pipeline : std::false_type {};
+template <typename R, typename... Steps>
+struct is_result_pipeline<result_pipeline<R, Steps...>> : std::true_type {};
+
+template <typename T>
+constexpr bool is_result_pipeline_v = is_result_pipeline<std::decay_t<T>>::value;
 
 /**
- * @brief A variadic error type encapsulating one of several possible error types.
+ * @brief Converts between variants whose alternatives are a subset of each other.
  *
- * The Error class is a thin wrapper around std::variant to represent multiple
- * error types. It supports construction from any error type included in its list.
+ * @tparam From The source std::variant.
+ * @tparam To The target std::variant.
+ */
+template <typename From, typename To> struct alternative_remap;
+
+/**
+ * @brief Layout facts about a Result used by the bulk status kernels.
+ */
+template <typename R> struct result_layout;
+
+template <typename T> struct is_in_place_index : std::false_type {};
+template <std::size_t I>
+struct is_in_place_index<std::in_place_index_t<I>> : std::true_type {};
+
+/**
+ * @brief Reports a checked access to the alternative that is not held.
+ */
+[[noreturn]] inline void throw_bad_variant_access() {
+#if defined(_CPPUNWIND) || defined(__EXCEPTIONS) || defined(__cpp_exceptions)
+  throw std::bad_variant_access{};
+#else
+  std::abort();
+#endif
+}
+
+} // namespace cppmatch_detail
+
+/**
+ * @brief A two-state type holding either a success value or an error.
  *
- * @tparam Ts List of possible error types.
+ * Result is laid out as a union with the success value first, followed by a
+ * one byte tag. When both T and E are trivially copyable, so is Result, which
+ * lets small Results be returned in registers. It keeps the std::variant
+ * vocabulary (index(), get, get_if, holds_alternative and std::in_place_index
+ * construction), with index 0 being the success value and index 1 the error.
+ * Types that opt in through packed_result_traits use a packed word instead.
+ *
+ * @tparam T Type for the success value.
+ * @tparam E Type for the error.
  */
-template <typename... Ts>
-class Error {
+template <typename T, typename E>
+class Result {
 public:
-  /// The underlying variant type holding the error value.
-  using VariantType = std::variant<Ts...>;
-  VariantType value;
+  /// The type of the success value.
+  using value_type = T;
+  /// The type of the error value.
+  using error_type = E;
 
   /**
-   * @brief Constructs an Error from an error value.
+   * @brief Default constructs the success value, as std::variant does.
+   */
+  constexpr Result() noexcept(std::is_nothrow_default_constructible_v<T>)
+    requires std::is_default_constructible_v<T>
+      : ok_(), has_error_(false) {}
+
+  /**
+   * @brief Constructs the success value in place.
    *
-   * This constructor is enabled only if the provided type is one of the error types.
+   * @param args Arguments forwarded to the constructor of T.
+   */
+  template <typename... Args>
+  constexpr explicit Result(std::in_place_index_t<0>, Args &&...args) noexcept(
+      std::is_nothrow_constructible_v<T, Args...>)
+      : ok_(std::forward<Args>(args)...), has_error_(false) {}
+
+  /**
+   * @brief Constructs the error value in place.
    *
-   * @tparam T The error type.
-   * @param t The error value.
+   * @param args Arguments forwarded to the constructor of E.
    */
-  template <typename T, typename = std::enable_if_t<
-                            is_one_of<std::decay_t<T>, Ts...>::value>>
-  Error(T &&t) : value(std::forward<T>(t)) {}
+  template <typename... Args>
+  constexpr explicit Result(std::in_place_index_t<1>, Args &&...args) noexcept(
+      std::is_nothrow_constructible_v<E, Args...>)
+      : err_(std::forward<Args>(args)...), has_error_(true) {}
 
   /**
-   * @brief Copy constructor for converting between different Error types.
+   * @brief Constructs the alternative selected by overload resolution on U.
    *
-   * This constructor is enabled if all types in the other Error are among the allowed types.
+   * Follows the std::variant rules: the value goes to whichever of T or E it
+   * converts to unambiguously and without narrowing.
    *
-   * @tparam... Us The error types from the other Error.
-   * @param other The other Error instance.
+   * @tparam U The type of the value.
+   * @param u The value.
    */
-  template <typename... Us,
-            typename = std::enable_if_t<(is_one_of<Us, Ts...>::value && ...)>>
-  Error(const Error<Us...> &other) {
-    std::visit(
-        [this](auto &&arg) {
-          value = std::variant<Ts...>(std::forward<decltype(arg)>(arg));
-        },
-        other.value);
+  template <typename U>
+    requires(!std::is_same_v<std::remove_cvref_t<U>, Result> &&
+             !cppmatch_detail::is_in_place_index<std::remove_cvref_t<U>>::value) &&
+            requires { typename cppmatch_detail::selected_alternative_t<U, T, E>; }
+  constexpr Result(U &&u) noexcept(std::is_nothrow_constructible_v<
+                                   std::conditional_t<cppmatch_detail::selected_alternative_t<U, T, E>::value == 0, T, E>,
+                                   U>)
+      : Result(std::in_place_index<cppmatch_detail::selected_alternative_t<U, T, E>::value>,
+               std::forward<U>(u)) {}
+
+  constexpr Result(const Result &)
+    requires(std::is_trivially_copy_constructible_v<T> &&
+             std::is_trivially_copy_constructible_v<E>)
+  = default;
+
+  constexpr Result(const Result &other) noexcept(
+      std::is_nothrow_copy_constructible_v<T> &&
+      std::is_nothrow_copy_constructible_v<E>)
+    requires(std::is_copy_constructible_v<T> && std::is_copy_constructible_v<E> &&
+             !(std::is_trivially_copy_constructible_v<T> &&
+               std::is_trivially_copy_constructible_v<E>))
+      : has_error_(other.has_error_) {
+    construct_from(other);
+  }
+
+  constexpr Result(Result &&)
+    requires(std::is_trivially_move_constructible_v<T> &&
+             std::is_trivially_move_constructible_v<E>)
+  = default;
+
+  constexpr Result(Result &&other) noexcept(
+      std::is_nothrow_move_constructible_v<T> &&
+      std::is_nothrow_move_constructible_v<E>)
+    requires(std::is_move_constructible_v<T> && std::is_move_constructible_v<E> &&
+             !(std::is_trivially_move_constructible_v<T> &&
+               std::is_trivially_move_constructible_v<E>))
+      : has_error_(other.has_error_) {
+    construct_from(std::move(other));
+  }
+
+  constexpr Result &operator=(const Result &)
+    requires(std::is_trivially_copy_assignable_v<T> &&
+             std::is_trivially_copy_assignable_v<E> &&
+             std::is_trivially_copy_constructible_v<T> &&
+             std::is_trivially_copy_constructible_v<E> &&
+             std::is_trivially_destructible_v<T> &&
+             std::is_trivially_destructible_v<E>)
+  = default;
+
+  constexpr Result &operator=(const Result &other)
+    requires(std::is_copy_assignable_v<T> && std::is_copy_assignable_v<E> &&
+             std::is_copy_constructible_v<T> && std::is_copy_constructible_v<E> &&
+             !(std::is_trivially_copy_assignable_v<T> &&
+               std::is_trivially_copy_assignable_v<E> &&
+               std::is_trivially_copy_constructible_v<T> &&
+               std::is_trivially_copy_constructible_v<E> &&
+               std::is_trivially_destructible_v<T> &&
+               std::is_trivially_destructible_v<E>))
+  {
+    if (has_error_ == other.has_error_) {
+      if (has_error_)
+        err_ = other.err_;
+      else
+        ok_ = other.ok_;
+    } else if (other.has_error_) {
+      switch_to<1>(other.err_);
+    } else {
+      switch_to<0>(other.ok_);
+    }
+    return *this;
+  }
+
+  constexpr Result &operator=(Result &&)
+    requires(std::is_trivially_move_assignable_v<T> &&
+             std::is_trivially_move_assignable_v<E> &&
+             std::is_trivially_move_constructible_v<T> &&
+             std::is_trivially_move_constructible_v<E> &&
+             std::is_trivially_destructible_v<T> &&
+             std::is_trivially_destructible_v<E>)
+  = default;
+
+  constexpr Result &operator=(Result &&other) noexcept(
+      std::is_nothrow_move_assignable_v<T> && std::is_nothrow_move_assignable_v<E> &&
+      std::is_nothrow_move_constructible_v<T> && std::is_nothrow_move_constructible_v<E>)
+    requires(std::is_move_assignable_v<T> && std::is_move_assignable_v<E> &&
+             std::is_move_constructible_v<T> && std::is_move_constructible_v<E> &&
+             !(std::is_trivially_move_assignable_v<T> &&
+               std::is_trivially_move_assignable_v<E> &&
+               std::is_trivially_move_constructible_v<T> &&
+               std::is_trivially_move_constructible_v<E> &&
+               std::is_trivially_destructible_v<T> &&
+               std::is_trivially_destructible_v<E>))
+  {
+    if (has_error_ == other.has_error_) {
+      if (has_error_)
+        err_ = std::move(other.err_);
+      else
+        ok_ = std::move(other.ok_);
+    } else if (other.has_error_) {
+      switch_to<1>(std::move(other.err_));
+    } else {
+      switch_to<0>(std::move(other.ok_));
+    }
+    return *this;
   }
 
   /**
-   * @brief Move constructor for converting between different Error types.
+   * @brief Replaces the held value with the alternative selected by U.
    *
-   * This constructor is enabled if all types in the other Error are among the allowed types.
+   * @tparam U The type of the value.
+   * @param u The value.
+   * @return *this
+   */
+  template <typename U>
+    requires(!std::is_same_v<std::remove_cvref_t<U>, Result>) &&
+            std::is_constructible_v<Result, U>
+  constexpr Result &operator=(U &&u) {
+    return *this = Result(std::forward<U>(u));
+  }
+
+  constexpr ~Result()
+    requires(std::is_trivially_destructible_v<T> &&
+             std::is_trivially_destructible_v<E>)
+  = default;
+
+  constexpr ~Result() { destroy(); }
+
+  /**
+   * @brief Returns the index of the held alternative: 0 for success, 1 for error.
+   */
+  constexpr std::size_t index() const noexcept { return has_error_; }
+
+  /**
+   * @brief Accesses the success value without checking the tag.
    *
-   * @tparam... Us The error types from the other Error.
-   * @param other The other Error instance (rvalue reference).
+   * The behavior is undefined if the Result holds an error.
    */
-  template <typename... Us,
-            typename = std::enable_if_t<(is_one_of<Us, Ts...>::value && ...)>>
-  Error(Error<Us...> &&other) {
-    std::visit(
-        [this](auto &&arg) {
-          value = std::variant<Ts...>(std::forward<decltype(arg)>(arg));
-        },
-        std::move(other.value));
+  constexpr T &value_unchecked() & noexcept { return ok_; }
+  constexpr const T &value_unchecked() const & noexcept { return ok_; }
+  constexpr T &&value_unchecked() && noexcept { return std::move(ok_); }
+  constexpr const T &&value_unchecked() const && noexcept { return std::move(ok_); }
+
+  /**
+   * @brief Accesses the error value without checking the tag.
+   *
+   * The behavior is undefined if the Result holds a success value.
+   */
+  constexpr E &error_unchecked() & noexcept { return err_; }
+  constexpr const E &error_unchecked() const & noexcept { return err_; }
+  constexpr E &&error_unchecked() && noexcept { return std::move(err_); }
+  constexpr const E &&error_unchecked() const && noexcept { return std::move(err_); }
+
+private:
+  template <typename> friend struct cppmatch_detail::result_layout;
+
+  template <typename Other>
+  constexpr void construct_from(Other &&other) {
+    if (has_error_)
+      std::construct_at(std::addressof(err_), std::forward<Other>(other).err_);
+    else
+      std::construct_at(std::addressof(ok_), std::forward<Other>(other).ok_);
+  }
+
+  constexpr void destroy() noexcept {
+    if (has_error_)
+      std::destroy_at(std::addressof(err_));
+    else
+      std::destroy_at(std::addressof(ok_));
+  }
+
+  /**
+   * @brief Replaces the held alternative with alternative I, built from @p src.
+   *
+   * Unlike std::variant, a Result is never left without a value. If building
+   * alternative I can throw, it is built aside and moved in, or failing a
+   * nothrow move, the held alternative is moved aside and restored when the
+   * construction throws. Either way the Result is unchanged on an exception.
+   */
+  template <std::size_t I, typename Src> constexpr void switch_to(Src &&src) {
+    using New = std::conditional_t<I == 0, T, E>;
+    using Old = std::conditional_t<I == 0, E, T>;
+    if constexpr (std::is_nothrow_constructible_v<New, Src>) {
+      destroy();
+      construct_alternative<I>(std::forward<Src>(src));
+    } else if constexpr (std::is_nothrow_move_constructible_v<New>) {
+      New aside(std::forward<Src>(src));
+      destroy();
+      construct_alternative<I>(std::move(aside));
+    } else {
+      static_assert(std::is_nothrow_move_constructible_v<Old>,
+                    "Result: switching alternatives needs a nothrow move of one of them");
+      Old &held = [this]() -> Old & {
+        if constexpr (I == 0)
+          return err_;
+        else
+          return ok_;
+      }();
+      Old saved(std::move(held));
+      destroy();
+#if defined(_CPPUNWIND) || defined(__EXCEPTIONS) || defined(__cpp_exceptions)
+      try {
+        construct_alternative<I>(std::forward<Src>(src));
+      } catch (...) {
+        construct_alternative<1 - I>(std::move(saved));
+        throw;
+      }
+#else
+      construct_alternative<I>(std::forward<Src>(src));
+#endif
+    }
+  }
+
+  /// Constructs alternative I in the storage, which holds no live object.
+  template <std::size_t I, typename... Args>
+  constexpr void construct_alternative(Args &&...args) {
+    if constexpr (I == 0)
+      std::construct_at(std::addressof(ok_), std::forward<Args>(args)...);
+    else
+      std::construct_at(std::addressof(err_), std::forward<Args>(args)...);
+    has_error_ = I == 1;
   }
+
+  union {
+    T ok_;
+    E err_;
+  };
+  bool has_error_;
 };
 
 namespace cppmatch_detail {
 
+/// The bits of an integral or enum value, zero-extended to Word.
+template <typename Word, typename V> constexpr Word to_word(V v) noexcept {
+  if constexpr (std::is_enum_v<V>)
+    return to_word<Word>(static_cast<std::underlying_type_t<V>>(v));
+  else
+    return static_cast<Word>(static_cast<std::make_unsigned_t<V>>(v));
+}
+
+/// Inverse of to_word, keeping the low bits of @p w.
+template <typename V, typename Word> constexpr V from_word(Word w) noexcept {
+  if constexpr (std::is_enum_v<V>)
+    return static_cast<V>(from_word<std::underlying_type_t<V>>(w));
+  else
+    return static_cast<V>(static_cast<std::make_unsigned_t<V>>(w));
+}
+
+template <typename V>
+concept word_codable = (std::is_integral_v<V> || std::is_enum_v<V>) &&
+                       !std::is_same_v<V, bool> && sizeof(V) <= 4;
+
+} // namespace cppmatch_detail
+
 /**
- * @brief Helper struct to allow overloaded lambda expressions.
- *
- * This struct inherits from multiple lambdas to allow a single call to
- * std::visit to use overloaded call operators.
+ * @brief Packing for Result<P*, E>: the low pointer bit is the tag.
  *
- * @tparam Ts Lambda types.
+ * Success values are the pointer itself; errors are the code shifted left by
+ * one with the low bit set. P must be at least 2-byte aligned, and E an
+ * integral or enum code narrower than a pointer.
  */
-template <class... Ts>
-struct overloaded : Ts... {
-  using Ts::operator()...;
+template <typename T, typename E> struct tagged_pointer_packing;
+
+template <typename P, typename E> struct tagged_pointer_packing<P *, E> {
+  static_assert(alignof(P) >= 2, "the low pointer bit must be free");
+  static_assert(cppmatch_detail::word_codable<E> && sizeof(E) < sizeof(std::uintptr_t),
+                "the error must be an integral or enum code narrower than a pointer");
+
+  static constexpr bool enabled = true;
+  using storage = std::uintptr_t;
+
+  static storage pack_value(P *p) noexcept { return reinterpret_cast<storage>(p); }
+  static constexpr storage pack_error(E e) noexcept {
+    return (cppmatch_detail::to_word<storage>(e) << 1) | 1u;
+  }
+  static constexpr bool is_error(storage s) noexcept { return s & 1u; }
+  static P *value(storage s) noexcept { return reinterpret_cast<P *>(s); }
+  static constexpr E error(storage s) noexcept {
+    return cppmatch_detail::from_word<E>(s >> 1);
+  }
 };
 
 /**
- * @brief Trait to check if a type is a std::variant.
+ * @brief Packing for a T with a value it never takes as a success.
  *
- * @tparam T The type to check.
+ * The Niche value of T marks the error, so the Result is exactly a T. E must be
+ * an empty type: there is no room left to store anything for it. Storing Niche
+ * as a success value would read back as the error, so it trips an assert,
+ * which also rejects it in constant expressions.
  */
-template <typename T> struct is_variant : std::false_type {};
-template <typename... Ts>
-struct is_variant<std::variant<Ts...>> : std::true_type {};
+template <typename T, typename E, T Niche> struct niche_packing {
+  static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable");
+  static_assert(std::is_empty_v<E> && std::is_default_constructible_v<E>,
+                "niche_packing only carries an empty error type");
 
-/**
- * @brief Variable template for is_variant.
- *
- * @tparam T The type to check.
- */
-template <typename T>
-constexpr bool is_variant_v = is_variant<std::decay_t<T>>::value;
+  static constexpr bool enabled = true;
+  using storage = T;
 
-/**
- * @brief Trait to detect our custom Error type.
- *
- * @tparam T The type to check.
- */
-template <typename T> struct is_error : std::false_type {};
-template <typename... Ts> struct is_error<Error<Ts...>> : std::true_type {};
+  /// @pre v != Niche.
+  static constexpr storage pack_value(T v) noexcept {
+    assert(v != Niche && "niche_packing: the success value is the niche");
+    return v;
+  }
+  static constexpr storage pack_error(E) noexcept { return Niche; }
+  static constexpr bool is_error(storage s) noexcept { return s == Niche; }
+  static constexpr T value(storage s) noexcept { return s; }
+  static constexpr E error(storage) noexcept { return E{}; }
+};
 
 /**
- * @brief Variable template for is_error.
+ * @brief Packing for small integral or enum values and codes in one 64-bit word.
  *
- * @tparam T The type to check.
+ * The low 32 bits hold either the value or the code and bit 32 is the tag, so
+ * is_err is a single bit test on a word that travels in one register.
  */
-template <typename T>
-constexpr bool is_error_v = is_error<std::decay_t<T>>::value;
+template <typename T, typename E> struct word_packing {
+  static_assert(cppmatch_detail::word_codable<T> && cppmatch_detail::word_codable<E>,
+                "word_packing needs integral or enum types of at most 32 bits");
+
+  static constexpr bool enabled = true;
+  using storage = std::uint64_t;
+
+  static constexpr storage tag = storage{1} << 32;
+
+  static constexpr storage pack_value(T v) noexcept {
+    return cppmatch_detail::to_word<storage>(v);
+  }
+  static constexpr storage pack_error(E e) noexcept {
+    return cppmatch_detail::to_word<storage>(e) | tag;
+  }
+  static constexpr bool is_error(storage s) noexcept { return s & tag; }
+  static constexpr T value(storage s) noexcept {
+    return cppmatch_detail::from_word<T>(s);
+  }
+  static constexpr E error(storage s) noexcept {
+    return cppmatch_detail::from_word<E>(s);
+  }
+};
 
 /**
- * @brief Recursively visits a nested variant until a non-variant (or non-error) value is found.
+ * @brief Result stored as one packed word, selected by packed_result_traits.
  *
- * @tparam T The type of the value.
- * @tparam Visitor The visitor type.
- * @param value The value to be visited.
- * @param vis The visitor callable.
- * @return The result of applying the visitor to the innermost value.
+ * It keeps the Result interface, except that value_unchecked(),
+ * error_unchecked() and get return the alternatives by value, since they are
+ * decoded from the word rather than stored as objects; get_if is not
+ * available.
+ *
+ * @tparam T Type for the success value.
+ * @tparam E Type for the error.
  */
-template <typename T, typename Visitor>
-constexpr auto flat_visit(T &&value, Visitor &&vis) {
-  if constexpr (is_error_v<std::decay_t<T>>) {
-    return flat_visit(std::forward<T>(value).value, std::forward<Visitor>(vis));
-  } else if constexpr (is_variant_v<std::decay_t<T>>) {
-    return std::visit(
-        [&](auto &&inner) {
-          return flat_visit(std::forward<decltype(inner)>(inner),
-                            std::forward<Visitor>(vis));
-        },
-        std::forward<T>(value));
-  } else {
-    return std::forward<Visitor>(vis)(std::forward<T>(value));
+template <typename T, typename E>
+  requires packed_result_traits<T, E>::enabled
+class Result<T, E> {
+  using packing = packed_result_traits<T, E>;
+
+public:
+  /// The type of the success value.
+  using value_type = T;
+  /// The type of the error value.
+  using error_type = E;
+  /// The packed word.
+  using storage_type = typename packing::storage;
+
+  constexpr Result() noexcept
+    requires std::is_default_constructible_v<T>
+      : bits_(packing::pack_value(T())) {}
+
+  template <typename... Args>
+  constexpr explicit Result(std::in_place_index_t<0>, Args &&...args) noexcept(
+      std::is_nothrow_constructible_v<T, Args...>)
+      : bits_(packing::pack_value(T(std::forward<Args>(args)...))) {}
+
+  template <typename... Args>
+  constexpr explicit Result(std::in_place_index_t<1>, Args &&...args) noexcept(
+      std::is_nothrow_constructible_v<E, Args...>)
+      : bits_(packing::pack_error(E(std::forward<Args>(args)...))) {}
+
+  template <typename U>
+    requires(!std::is_same_v<std::remove_cvref_t<U>, Result> &&
+             !cppmatch_detail::is_in_place_index<std::remove_cvref_t<U>>::value) &&
+            requires { typename cppmatch_detail::selected_alternative_t<U, T, E>; }
+  constexpr Result(U &&u)
+      : Result(std::in_place_index<cppmatch_detail::selected_alternative_t<U, T, E>::value>,
+               std::forward<U>(u)) {}
+
+  template <typename U>
+    requires(!std::is_same_v<std::remove_cvref_t<U>, Result>) &&
+            std::is_constructible_v<Result, U>
+  constexpr Result &operator=(U &&u) {
+    bits_ = Result(std::forward<U>(u)).bits_;
+    return *this;
   }
-}
 
-} // namespace cppmatch_detail
+  /**
+   * @brief Returns the index of the held alternative: 0 for success, 1 for error.
+   */
+  constexpr std::size_t index() const noexcept { return packing::is_error(bits_); }
+
+  /// Decodes the success value. The behavior is undefined if the Result holds an error.
+  constexpr T value_unchecked() const noexcept { return packing::value(bits_); }
+
+  /// Decodes the error. The behavior is undefined if the Result holds a success value.
+  constexpr E error_unchecked() const noexcept { return packing::error(bits_); }
+
+  /// The packed word.
+  constexpr storage_type bits() const noexcept { return bits_; }
+
+private:
+  storage_type bits_;
+};
 
 /**
- * @brief Checks if the Result holds an error.
- *
- * This function uses constant evaluation if possible for faster runtime checks.
+ * @brief Accesses the alternative at index I, checking that it is held.
  *
- * @tparam T The success type.
- * @tparam E The error type.
- * @param result The Result to check.
- * @return true if the result holds an error; false otherwise.
+ * @tparam I 0 for the success value, 1 for the error.
+ * @param r The Result to access.
+ * @return A reference to the alternative.
+ * @throws std::bad_variant_access if the alternative is not held.
  */
-template <typename T, typename E>
-constexpr bool is_err(const Result<T, E> &result) noexcept {
-  #if defined(__cpp_if_consteval)
-  if consteval  {
-    return std::holds_alternative<E>(result);
-  }
-  #else 
-  if constexpr (std::is_constant_evaluated()) {
-    return std::holds_alternative<E>(result);
-  }
-  #endif
-  return result.index(); // At runtime, checking the index is faster.
+template <std::size_t I, typename R>
+  requires cppmatch_detail::is_result_v<R>
+constexpr decltype(auto) get(R &&r) {
+  static_assert(I < 2, "Result only has two alternatives");
+  if (r.index() != I)
+    cppmatch_detail::throw_bad_variant_access();
+  if constexpr (I == 0)
+    return std::forward<R>(r).value_unchecked();
+  else
+    return std::forward<R>(r).error_unchecked();
 }
 
 /**
- * @brief Checks if the Result holds a success value.
+ * @brief Accesses the alternative of type U, checking that it is held.
  *
- * @tparam T The success type.
- * @tparam E The error type.
- * @param result The Result to check.
- * @return true if the result holds a success value; false otherwise.
+ * @tparam U The success or the error type; it must not be both.
+ * @param r The Result to access.
+ * @return A reference to the alternative.
+ * @throws std::bad_variant_access if the alternative is not held.
  */
-template <typename T, typename E>
-constexpr bool is_ok(const Result<T, E> &result) noexcept {
-  return !is_err(result);
+template <typename U, typename R>
+  requires cppmatch_detail::is_result_v<R>
+constexpr decltype(auto) get(R &&r) {
+  using T = typename std::remove_cvref_t<R>::value_type;
+  using E = typename std::remove_cvref_t<R>::error_type;
+  static_assert(std::is_same_v<U, T> != std::is_same_v<U, E>,
+                "U must be exactly one of the Result alternatives");
+  return get<std::is_same_v<U, T> ? 0 : 1>(std::forward<R>(r));
 }
 
 /**
- * @brief Matches over the alternatives in a Result or nested variant.
- *
- * This function flattens nested Error or variant types and applies the provided
- * overloaded lambdas to the innermost value.
- *
- * @tparam Variant The type of the variant.
- * @tparam Lambdas The lambda functions to handle each alternative.
- * @param v The variant value.
- * @param lambdas The lambda handlers.
- * @return The result of the matching.
+ * @brief Returns a pointer to the alternative at index I, or nullptr if it is not held.
  */
-template <typename Variant, typename... Lambdas>
-constexpr auto match(Variant &&v, Lambdas &&...lambdas) {
-  return cppmatch_detail::flat_visit(
-      std::forward<Variant>(v),
-      cppmatch_detail::overloaded{std::forward<Lambdas>(lambdas)...});
+template <std::size_t I, typename T, typename E>
+constexpr auto get_if(Result<T, E> *r) noexcept {
+  static_assert(I < 2, "Result only has two alternatives");
+  if constexpr (I == 0)
+    return r && r->index() == 0 ? std::addressof(r->value_unchecked()) : nullptr;
+  else
+    return r && r->index() == 1 ? std::addressof(r->error_unchecked()) : nullptr;
+}
+
+template <std::size_t I, typename T, typename E>
+constexpr auto get_if(const Result<T, E> *r) noexcept {
+  static_assert(I < 2, "Result only has two alternatives");
+  if constexpr (I == 0)
+    return r && r->index() == 0 ? std::addressof(r->value_unchecked()) : nullptr;
+  else
+    return r && r->index() == 1 ? std::addressof(r->error_unchecked()) : nullptr;
 }
 
 /**
- * @brief Macro to unwrap a Result or return an error.
+ * @brief Checks whether the Result currently holds the alternative of type U.
  *
- * This macro evaluates an expression that returns a Result. If the result is an error,
+ * @tparam U The success or the error type; it must not be both.
+ */
+template <typename U, typename T, typename E>
+constexpr bool holds_alternative(const Result<T, E> &r) noexcept {
+  static_assert(std::is_same_v<U, T> != std::is_same_v<U, E>,
+                "U must be exactly one of the Result alternatives");
+  return r.index() == (std::is_same_v<U, T> ? 0 : 1);
+}
+
+#if defined(__has_builtin)
+#if __has_builtin(__is_same)
+#define CPPMATCH_HAS_IS_SAME 1
+#endif
+#if __has_builtin(__type_pack_element)
+#define CPPMATCH_HAS_TYPE_PACK_ELEMENT 1
+#endif
+#endif
+
+namespace cppmatch_detail {
+
+template <typename T> struct type_key {};
+template <std::size_t I, typename T> struct type_set_entry : type_key<T> {};
+template <typename Is, typename... Ts> struct type_set_base;
+template <std::size_t... I, typename... Ts>
+struct type_set_base<std::index_sequence<I...>, Ts...> : type_set_entry<I, Ts>... {};
+
+/**
+ * @brief A set of types with constant-time membership tests.
+ *
+ * Each type is a (possibly repeated) base, so asking whether T is a member is
+ * one base-class query against a class instantiated once per list, instead of
+ * a fresh disjunction of is_same instantiations per query.
+ */
+template <typename... Ts>
+struct type_set : type_set_base<std::index_sequence_for<Ts...>, Ts...> {};
+
+template <typename T, typename Set>
+inline constexpr bool type_set_contains_v = std::is_base_of_v<type_key<T>, Set>;
+
+/**
+ * @brief Index of the first occurrence of T in Ts, or sizeof...(Ts) if absent.
+ */
+template <typename T, typename... Ts>
+constexpr std::size_t index_of() {
+#if defined(CPPMATCH_HAS_IS_SAME)
+  // The builtin compares without instantiating is_same_v for every pair.
+  constexpr bool matches[] = {__is_same(T, Ts)..., false};
+#else
+  constexpr bool matches[] = {std::is_same_v<T, Ts>..., false};
+#endif
+  std::size_t i = 0;
+  while (i < sizeof...(Ts) && !matches[i])
+    ++i;
+  return i;
+}
+
+} // namespace cppmatch_detail
+
+/**
+ * @brief Type trait to check if type T is the same as one of the types in Ts.
+ *
+ * @tparam T The type to check.
+ * @tparam Ts The candidate types.
+ */
+template <typename T, typename... Ts>
+struct is_one_of
+    : std::bool_constant<cppmatch_detail::type_set_contains_v<T, cppmatch_detail::type_set<Ts...>>> {};
+
+#if defined(CPPMATCH_TRACE)
+#if !defined(CPPMATCH_TRACE_DEPTH)
+#define CPPMATCH_TRACE_DEPTH 8
+#endif
+
+/**
+ * @brief The expect sites an Error propagated through, innermost first.
+ *
+ * Only present with CPPMATCH_TRACE. Holds the first CPPMATCH_TRACE_DEPTH
+ * frames and counts the rest in dropped(), so recording never allocates.
+ */
+class propagation_trace {
+public:
+  static constexpr std::size_t capacity = CPPMATCH_TRACE_DEPTH;
+
+  constexpr void push(std::source_location where) noexcept {
+    if (size_ < capacity)
+      frames_[size_++] = where;
+    else
+      ++dropped_;
+  }
+
+  constexpr std::size_t size() const noexcept { return size_; }
+  constexpr bool empty() const noexcept { return size_ == 0; }
+  /// Frames past the capacity that were counted but not kept.
+  constexpr std::size_t dropped() const noexcept { return dropped_; }
+  constexpr const std::source_location &operator[](std::size_t i) const noexcept {
+    return frames_[i];
+  }
+  constexpr const std::source_location *begin() const noexcept { return frames_.data(); }
+  constexpr const std::source_location *end() const noexcept {
+    return frames_.data() + size_;
+  }
+
+private:
+  std::array<std::source_location, capacity> frames_{};
+  std::uint32_t size_ = 0;
+  std::uint32_t dropped_ = 0;
+};
+#endif
+
+/**
+ * @brief A variadic error type encapsulating one of several possible error types.
+ *
+ * The Error class is a thin wrapper around std::variant to represent multiple
+ * error types. It supports construction from any error type included in its list.
+ *
+ * @tparam Ts List of possible error types.
+ */
+template <typename... Ts>
+class Error {
+public:
+  /// The underlying variant type holding the error value.
+  using VariantType = std::variant<Ts...>;
+  VariantType value;
+#if defined(CPPMATCH_TRACE)
+  /// The expect sites this error has been returned through.
+  propagation_trace trace;
+#endif
+
+  /**
+   * @brief Constructs an Error from an error value.
+   *
+   * This constructor is enabled only if the provided type is one of the error types.
+   *
+   * @tparam T The error type.
+   * @param t The error value.
+   */
+  template <typename T, typename = std::enable_if_t<
+                            is_one_of<std::decay_t<T>, Ts...>::value>>
+  constexpr Error(T &&t) noexcept(std::is_nothrow_constructible_v<std::decay_t<T>, T>)
+      : value(std::in_place_index<cppmatch_detail::index_of<std::decay_t<T>, Ts...>()>,
+              std::forward<T>(t)) {}
+
+  /**
+   * @brief Constructs an Error by boxing a payload listed as Boxed<T>.
+   *
+   * @tparam T The payload type, with Boxed<T> among the error types.
+   * @param t The payload, moved or copied into its heap slot.
+   */
+  template <typename T,
+            typename = std::enable_if_t<
+                !is_one_of<std::decay_t<T>, Ts...>::value &&
+                is_one_of<Boxed<std::decay_t<T>>, Ts...>::value>,
+            typename = void>
+  Error(T &&t) : value(Boxed<std::decay_t<T>>(std::forward<T>(t))) {}
+
+  /**
+   * @brief Copy constructor for converting between different Error types.
+   *
+   * This constructor is enabled if all types in the other Error are among the allowed types.
+   * The active alternative is constructed directly in its slot of the wider
+   * variant, located through a compile-time table of source to target indices.
+   * It is noexcept when every alternative copies without throwing; a
+   * valueless source then terminates instead of throwing bad_variant_access.
+   *
+   * @tparam... Us The error types from the other Error.
+   * @param other The other Error instance.
+   */
+  template <typename... Us,
+            typename = std::enable_if_t<(is_one_of<Us, Ts...>::value && ...)>>
+  constexpr Error(const Error<Us...> &other) noexcept(
+      (std::is_nothrow_copy_constructible_v<Us> && ...))
+      : value(cppmatch_detail::alternative_remap<std::variant<Us...>, VariantType>::convert(
+            other.value))
+#if defined(CPPMATCH_TRACE)
+        , trace(other.trace)
+#endif
+  {
+  }
+
+  /**
+   * @brief Move constructor for converting between different Error types.
+   *
+   * This constructor is enabled if all types in the other Error are among the allowed types.
+   * It is noexcept when every alternative moves without throwing.
+   *
+   * @tparam... Us The error types from the other Error.
+   * @param other The other Error instance (rvalue reference).
+   */
+  template <typename... Us,
+            typename = std::enable_if_t<(is_one_of<Us, Ts...>::value && ...)>>
+  constexpr Error(Error<Us...> &&other) noexcept(
+      (std::is_nothrow_move_constructible_v<Us> && ...))
+      : value(cppmatch_detail::alternative_remap<std::variant<Us...>, VariantType>::convert(
+            std::move(other.value)))
+#if defined(CPPMATCH_TRACE)
+        , trace(other.trace)
+#endif
+  {
+  }
+};
+
+namespace cppmatch_detail {
+
+/**
+ * @brief A per-thread free list of heap slots for Boxed<E>.
+ *
+ * Freed slots are kept for reuse, up to a small bound, so that producing the
+ * same kind of boxed error repeatedly does not go back to the allocator. A slot
+ * may be freed on a different thread than the one that allocated it.
+ */
+template <typename E> class box_pool {
+  struct node {
+    node *next;
+  };
+
+public:
+  static constexpr std::size_t slot_size = sizeof(E) > sizeof(node) ? sizeof(E) : sizeof(node);
+  static constexpr std::align_val_t slot_align{alignof(E) > alignof(node) ? alignof(E)
+                                                                          : alignof(node)};
+  /// Maximum number of free slots kept per thread.
+  static constexpr std::size_t capacity = 32;
+
+  /// The calling thread's pool. Trivially destructible, so a Boxed destroyed
+  /// during or after thread exit still finds it; the slots are released at
+  /// thread exit by a separate releaser.
+  static box_pool &local() noexcept {
+    constinit thread_local box_pool pool;
+    return pool;
+  }
+
+  void *allocate() {
+    if (head_) {
+      node *slot = head_;
+      head_ = slot->next;
+      --count_;
+      return slot;
+    }
+    return ::operator new(slot_size, slot_align);
+  }
+
+  void deallocate(void *slot) noexcept {
+    if (count_ < capacity && !released_) {
+      if (!head_)
+        register_release();
+      head_ = ::new (slot) node{head_};
+      ++count_;
+    } else {
+      ::operator delete(slot, slot_size, slot_align);
+    }
+  }
+
+private:
+  struct releaser {
+    box_pool *pool;
+    ~releaser() { pool->release(); }
+  };
+
+  // Registered when the pool first holds a slot. A Boxed destroyed after the
+  // releaser has run, later in thread exit, goes straight to the allocator.
+  void register_release() noexcept {
+    thread_local releaser at_exit{this};
+    (void)at_exit;
+  }
+
+  void release() noexcept {
+    while (head_) {
+      node *slot = head_;
+      head_ = slot->next;
+      ::operator delete(slot, slot_size, slot_align);
+    }
+    count_ = 0;
+    released_ = true;
+  }
+
+  node *head_ = nullptr;
+  std::size_t count_ = 0;
+  bool released_ = false;
+};
+
+} // namespace cppmatch_detail
+
+/**
+ * @brief Keeps a large error payload out of line, behind a pointer.
+ *
+ * A Result is as large as its largest alternative, so one big error type makes
+ * every Result that can carry it big, on the success path too. Listing
+ * Boxed<E> instead of E in an Error keeps that alternative at pointer size;
+ * the payload lives in a heap slot taken from a per-thread pool.
+ *
+ * Boxed is transparent to match and expect_e: handlers receive the E itself.
+ * An Error listing Boxed<E> can be constructed directly from an E.
+ *
+ * A moved-from Boxed holds no payload and may only be assigned or destroyed;
+ * dereferencing or matching it is a precondition violation, checked by assert.
+ *
+ * @tparam E The payload type.
+ */
+template <typename E> class Boxed {
+public:
+  using element_type = E;
+
+  /// Boxes a copy of @p e.
+  Boxed(const E &e) : ptr_(make(e)) {}
+
+  /// Boxes @p e by moving it.
+  Boxed(E &&e) : ptr_(make(std::move(e))) {}
+
+  /// Constructs the payload in its slot from @p args.
+  template <typename... Args>
+  explicit Boxed(std::in_place_t, Args &&...args)
+      : ptr_(make(std::forward<Args>(args)...)) {}
+
+  Boxed(const Boxed &other) : ptr_(make(*other)) {}
+
+  Boxed(Boxed &&other) noexcept : ptr_(std::exchange(other.ptr_, nullptr)) {}
+
+  Boxed &operator=(const Boxed &other) {
+    if (this != &other)
+      Boxed(other).swap(*this);
+    return *this;
+  }
+
+  Boxed &operator=(Boxed &&other) noexcept {
+    Boxed(std::move(other)).swap(*this);
+    return *this;
+  }
+
+  ~Boxed() {
+    if (ptr_) {
+      std::destroy_at(ptr_);
+      cppmatch_detail::box_pool<E>::local().deallocate(ptr_);
+    }
+  }
+
+  void swap(Boxed &other) noexcept { std::swap(ptr_, other.ptr_); }
+
+  E &operator*() & noexcept {
+    assert(ptr_ && "Boxed: dereferencing a moved-from box");
+    return *ptr_;
+  }
+  const E &operator*() const & noexcept {
+    assert(ptr_ && "Boxed: dereferencing a moved-from box");
+    return *ptr_;
+  }
+  E &&operator*() && noexcept {
+    assert(ptr_ && "Boxed: dereferencing a moved-from box");
+    return std::move(*ptr_);
+  }
+  const E &&operator*() const && noexcept {
+    assert(ptr_ && "Boxed: dereferencing a moved-from box");
+    return std::move(*ptr_);
+  }
+
+  E *operator->() noexcept { return ptr_; }
+  const E *operator->() const noexcept { return ptr_; }
+
+  E *get() noexcept { return ptr_; }
+  const E *get() const noexcept { return ptr_; }
+
+private:
+  template <typename... Args> static E *make(Args &&...args) {
+    auto &pool = cppmatch_detail::box_pool<E>::local();
+    void *slot = pool.allocate();
+#if _CPPUNWIND || __EXCEPTIONS || __cpp_exceptions
+    try {
+      return ::new (slot) E(std::forward<Args>(args)...);
+    } catch (...) {
+      pool.deallocate(slot);
+      throw;
+    }
+#else
+    return ::new (slot) E(std::forward<Args>(args)...);
+#endif
+  }
+
+  E *ptr_;
+};
+
+#if !defined(CPPMATCH_CONTEXT_BYTES)
+#define CPPMATCH_CONTEXT_BYTES 64
+#endif
+
+/**
+ * @brief Context frames attached to an error on its way up, innermost first.
+ *
+ * Frames are short strings kept inline, each behind a one-byte length, in an
+ * error_context of CPPMATCH_CONTEXT_BYTES bytes, so attaching one never
+ * allocates. A frame longer than the room left is truncated to fit; once no
+ * room is left, further frames are only counted in dropped().
+ */
+class error_context {
+  static_assert(CPPMATCH_CONTEXT_BYTES >= 8 && CPPMATCH_CONTEXT_BYTES <= 258,
+                "CPPMATCH_CONTEXT_BYTES must be between 8 and 258");
+
+public:
+  /// Bytes available to frames, their length bytes included.
+  static constexpr std::size_t capacity = CPPMATCH_CONTEXT_BYTES - 3;
+
+  /// Walks the frames, innermost first, as std::string_view.
+  class iterator {
+  public:
+    using value_type = std::string_view;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = std::forward_iterator_tag;
+
+    iterator() = default;
+
+    constexpr std::string_view operator*() const noexcept {
+      return {p_ + 1, static_cast<unsigned char>(*p_)};
+    }
+    constexpr iterator &operator++() noexcept {
+      p_ += 1 + static_cast<unsigned char>(*p_);
+      return *this;
+    }
+    constexpr iterator operator++(int) noexcept {
+      iterator old = *this;
+      ++*this;
+      return old;
+    }
+    friend constexpr bool operator==(iterator, iterator) noexcept = default;
+
+  private:
+    friend class error_context;
+    constexpr explicit iterator(const char *p) noexcept : p_(p) {}
+
+    const char *p_ = nullptr;
+  };
+
+  /// Appends @p frame as the next, outer, frame.
+  constexpr void push(std::string_view frame) noexcept {
+    std::size_t room = capacity - used_;
+    if (room < 2) {
+      if (dropped_ != std::numeric_limits<std::uint8_t>::max())
+        ++dropped_;
+      return;
+    }
+    std::size_t n = frame.size() < room - 1 ? frame.size() : room - 1;
+    bytes_[used_] = static_cast<char>(n);
+    std::char_traits<char>::copy(bytes_.data() + used_ + 1, frame.data(), n);
+    used_ = static_cast<std::uint8_t>(used_ + 1 + n);
+    ++size_;
+  }
+
+  constexpr std::size_t size() const noexcept { return size_; }
+  constexpr bool empty() const noexcept { return size_ == 0; }
+  /// Frames that found no room and were counted but not kept.
+  constexpr std::size_t dropped() const noexcept { return dropped_; }
+  constexpr iterator begin() const noexcept { return iterator(bytes_.data()); }
+  constexpr iterator end() const noexcept { return iterator(bytes_.data() + used_); }
+
+private:
+  std::array<char, capacity> bytes_{};
+  std::uint8_t used_ = 0;
+  std::uint8_t size_ = 0;
+  std::uint8_t dropped_ = 0;
+};
+
+namespace cppmatch_detail {
+
+/**
+ * @brief Trait to detect a Contextual error.
+ *
+ * @tparam T The type to check.
+ */
+template <typename T> struct is_contextual : std::false_type {};
+template <typename E> struct is_contextual<Contextual<E>> : std::true_type {};
+
+template <typename T>
+constexpr bool is_contextual_v = is_contextual<std::decay_t<T>>::value;
+
+/// The text of a context: what @p ctx returns if it is callable, else @p ctx.
+template <typename Ctx> constexpr decltype(auto) context_text(Ctx &ctx) {
+  if constexpr (std::is_invocable_v<Ctx &>)
+    return std::invoke(ctx);
+  else
+    return static_cast<Ctx &>(ctx);
+}
+
+} // namespace cppmatch_detail
+
+/**
+ * @brief An error together with the context frames added while it propagated.
+ *
+ * Frames are added by expect_ctx and with_context, on the error path only,
+ * so a context string is never built for a call that succeeds. Contextual is
+ * transparent to match: handlers receive the alternatives of E, and the
+ * frames stay readable through error_unchecked().context.
+ *
+ * A Contextual<E> is constructible from anything E is, and from a
+ * Contextual<F> whose F converts to E, keeping its frames. It is trivially
+ * copyable when E is, and adds CPPMATCH_CONTEXT_BYTES to the size of every
+ * Result that can carry it; Boxed<Contextual<E>> keeps that off the
+ * success path.
+ *
+ * @tparam E The underlying error type.
+ */
+template <typename E> class Contextual {
+public:
+  using error_type = E;
+
+  E error;
+  error_context context;
+
+  template <typename U>
+    requires(!cppmatch_detail::is_contextual_v<U> && std::is_constructible_v<E, U>)
+  constexpr Contextual(U &&u) noexcept(std::is_nothrow_constructible_v<E, U>)
+      : error(std::forward<U>(u)) {}
+
+  template <typename F>
+    requires std::is_constructible_v<E, const F &>
+  constexpr Contextual(const Contextual<F> &other) noexcept(
+      std::is_nothrow_constructible_v<E, const F &>)
+      : error(other.error), context(other.context) {}
+
+  template <typename F>
+    requires std::is_constructible_v<E, F>
+  constexpr Contextual(Contextual<F> &&other) noexcept(std::is_nothrow_constructible_v<E, F>)
+      : error(std::move(other.error)), context(other.context) {}
+
+  Contextual(const Contextual &) = default;
+  Contextual(Contextual &&) = default;
+  Contextual &operator=(const Contextual &) = default;
+  Contextual &operator=(Contextual &&) = default;
+};
+
+/**
+ * @brief Size and alignment of a Result, for budgets enforced with static_assert.
+ *
+ * @code
+ * static_assert(cppmatch::result_footprint<MyResult>::size <= 16);
+ * @endcode
+ *
+ * @tparam R The Result type.
+ */
+template <typename R> struct result_footprint {
+  static_assert(cppmatch_detail::is_result_v<R>, "result_footprint needs a Result");
+
+  /// sizeof the whole Result.
+  static constexpr std::size_t size = sizeof(R);
+  /// alignof the whole Result.
+  static constexpr std::size_t alignment = alignof(R);
+  /// sizeof the success type.
+  static constexpr std::size_t value_size = sizeof(typename R::value_type);
+  /// sizeof the error type.
+  static constexpr std::size_t error_size = sizeof(typename R::error_type);
+  /// Bytes added on top of the larger side: the tag and padding.
+  static constexpr std::size_t overhead =
+      size - (value_size > error_size ? value_size : error_size);
+};
+
+namespace cppmatch_detail {
+
+/**
+ * @brief Helper struct to allow overloaded lambda expressions.
+ *
+ * This struct inherits from multiple lambdas to allow a single call to
+ * std::visit to use overloaded call operators.
+ *
+ * @tparam Ts Lambda types.
+ */
+template <class... Ts>
+struct overloaded : Ts... {
+  using Ts::operator()...;
+};
+
+/**
+ * @brief Trait to check if a type is a std::variant.
+ *
+ * @tparam T The type to check.
+ */
+template <typename T> struct is_variant : std::false_type {};
+template <typename... Ts>
+struct is_variant<std::variant<Ts...>> : std::true_type {};
+
+/**
+ * @brief Variable template for is_variant.
+ *
+ * @tparam T The type to check.
+ */
+template <typename T>
+constexpr bool is_variant_v = is_variant<std::decay_t<T>>::value;
+
+/**
+ * @brief Trait to detect our custom Error type.
+ *
+ * @tparam T The type to check.
+ */
+template <typename T> struct is_error : std::false_type {};
+template <typename... Ts> struct is_error<Error<Ts...>> : std::true_type {};
+
+/**
+ * @brief Variable template for is_error.
+ *
+ * @tparam T The type to check.
+ */
+template <typename T>
+constexpr bool is_error_v = is_error<std::decay_t<T>>::value;
+
+/**
+ * @brief Trait to detect a Boxed payload.
+ *
+ * @tparam T The type to check.
+ */
+template <typename T> struct is_boxed : std::false_type {};
+template <typename E> struct is_boxed<Boxed<E>> : std::true_type {};
+
+template <typename T>
+constexpr bool is_boxed_v = is_boxed<std::decay_t<T>>::value;
+
+/**
+ * @brief Tells the optimizer that a point in the code can never be reached.
+ */
+[[noreturn]] inline void unreachable() {
+#if defined(__cpp_lib_unreachable)
+  std::unreachable();
+#elif defined(__GNUC__) || defined(__clang__)
+  __builtin_unreachable();
+#elif defined(_MSC_VER)
+  __assume(false);
+#endif
+}
+
+/**
+ * @brief A flattened alternative: the innermost type and the path of indices leading to it.
+ *
+ * Error and Boxed levels do not consume an index; they are crossed through their
+ * value member and their pointer.
+ *
+ * @tparam Path std::index_sequence of the Result/variant indices on the way down.
+ * @tparam T The leaf type.
+ */
+template <typename Path, typename T> struct leaf {
+  using path = Path;
+  using type = T;
+};
+
+template <typename... Leaves> struct leaf_list {
+  static constexpr std::size_t size = sizeof...(Leaves);
+};
+
+/// Concatenates leaf lists; declared only, for use in a fold over decltype.
+template <typename... As, typename... Bs>
+leaf_list<As..., Bs...> operator+(leaf_list<As...>, leaf_list<Bs...>);
+
+template <typename... Lists>
+using concat_leaves_t = decltype((leaf_list<>{} + ... + Lists{}));
+
+/// The leaves of a child at index I, with I prepended to their paths.
+template <std::size_t I, typename List> struct prefix_leaves;
+template <std::size_t I, typename... Paths, typename... Ts>
+struct prefix_leaves<I, leaf_list<leaf<Paths, Ts>...>> {
+private:
+  template <std::size_t... P>
+  static auto prefix(std::index_sequence<P...>) -> std::index_sequence<I, P...>;
+
+public:
+  using type = leaf_list<leaf<decltype(prefix(Paths{})), Ts>...>;
+};
+
+/**
+ * @brief Computes the flattened alternatives of a (possibly nested) Result, Error or variant.
+ *
+ * Paths are relative to T, so each type is flattened once per translation
+ * unit and its leaves are reused, prefixed, wherever it is nested.
+ *
+ * @tparam T The decayed type to flatten.
+ */
+template <typename T>
+struct flat_leaves {
+  using type = leaf_list<leaf<std::index_sequence<>, T>>;
+};
+
+template <typename... Ts>
+struct flat_leaves<Error<Ts...>> : flat_leaves<std::variant<Ts...>> {};
+
+template <typename E>
+struct flat_leaves<Boxed<E>> : flat_leaves<E> {};
+
+template <typename E>
+struct flat_leaves<Contextual<E>> : flat_leaves<E> {};
+
+template <typename T, typename E>
+struct flat_leaves<Result<T, E>> {
+  using type = concat_leaves_t<typename prefix_leaves<0, typename flat_leaves<T>::type>::type,
+                               typename prefix_leaves<1, typename flat_leaves<E>::type>::type>;
+};
+
+template <typename... Ts>
+struct flat_leaves<std::variant<Ts...>> {
+private:
+  template <std::size_t... I>
+  static auto helper(std::index_sequence<I...>) {
+    if constexpr ((std::is_same_v<typename flat_leaves<Ts>::type,
+                                  leaf_list<leaf<std::index_sequence<>, Ts>>> && ...))
+      // Every alternative is its own leaf: built without concatenating. A
+      // Boxed or Contextual alternative also has one leaf, but not itself.
+      return leaf_list<leaf<std::index_sequence<I>, Ts>...>{};
+    else
+      return concat_leaves_t<typename prefix_leaves<I, typename flat_leaves<Ts>::type>::type...>{};
+  }
+
+public:
+  using type = decltype(helper(std::index_sequence_for<Ts...>{}));
+};
+
+template <typename T>
+using flat_leaves_t = typename flat_leaves<std::decay_t<T>>::type;
+
+/// Number of flattened alternatives of T.
+template <typename T>
+inline constexpr std::size_t leaf_count_v = flat_leaves_t<T>::size;
+
+#if defined(__cpp_pack_indexing)
+/// The K-th type of Ts.
+template <std::size_t K, typename... Ts> using pack_element_t = Ts...[K];
+#elif defined(CPPMATCH_HAS_TYPE_PACK_ELEMENT)
+template <std::size_t K, typename... Ts> using pack_element_t = __type_pack_element<K, Ts...>;
+#else
+template <std::size_t K, typename T> struct indexed_type {
+  using type = T;
+};
+template <typename Is, typename... Ts> struct pack_indexer;
+template <std::size_t... I, typename... Ts>
+struct pack_indexer<std::index_sequence<I...>, Ts...> : indexed_type<I, Ts>... {};
+template <std::size_t K, typename T> indexed_type<K, T> select_indexed(const indexed_type<K, T> &);
+
+/// The K-th type of Ts, found by one derived-to-base deduction instead of recursion.
+template <std::size_t K, typename... Ts>
+using pack_element_t = typename decltype(select_indexed<K>(
+    pack_indexer<std::index_sequence_for<Ts...>, Ts...>{}))::type;
+#endif
+
+template <std::size_t K, typename List> struct leaf_at_index;
+template <std::size_t K, typename... Ls>
+struct leaf_at_index<K, leaf_list<Ls...>> {
+  using type = pack_element_t<K, Ls...>;
+};
+
+/**
+ * @brief Computes the index of the active flattened alternative.
+ *
+ * Each nesting level contributes the number of leaves that precede its
+ * active alternative, so the whole path collapses into one index.
+ *
+ * @param value The (possibly nested) value.
+ * @return The index into flat_leaves_t of the active alternative.
+ */
+template <typename T>
+constexpr std::size_t leaf_index(const T &value) {
+  if constexpr (is_error_v<T>) {
+    return leaf_index(value.value);
+  } else if constexpr (is_boxed_v<T>) {
+    return leaf_index(*value);
+  } else if constexpr (is_contextual_v<T>) {
+    return leaf_index(value.error);
+  } else if constexpr (is_result_v<T>) {
+    using R = std::decay_t<T>;
+    using V = typename R::value_type;
+    using E = typename R::error_type;
+    if constexpr (leaf_count_v<V> == 1 && leaf_count_v<E> == 1) {
+      return value.index();
+    } else {
+      return value.index() ? leaf_count_v<V> + leaf_index(value.error_unchecked())
+                           : leaf_index(value.value_unchecked());
+    }
+  } else if constexpr (is_variant_v<T>) {
+    if (value.valueless_by_exception())
+      throw_bad_variant_access();
+    return [&]<std::size_t... I>(std::index_sequence<I...>) {
+      using V = std::decay_t<T>;
+      if constexpr (((leaf_count_v<std::variant_alternative_t<I, V>> == 1) && ...)) {
+        return value.index();
+      } else {
+        constexpr std::size_t counts[] = {leaf_count_v<std::variant_alternative_t<I, V>>...};
+        std::size_t result = 0;
+        std::size_t offset = 0;
+        (void) ((value.index() == I
+                     ? (result = offset + leaf_index(*std::get_if<I>(&value)), true)
+                     : (offset += counts[I], false)) ||
+                ...);
+        return result;
+      }
+    }(std::make_index_sequence<std::variant_size_v<std::decay_t<T>>>{});
+  } else {
+    return 0;
+  }
+}
+
+/**
+ * @brief Accesses a flattened alternative through its path, without checking tags.
+ *
+ * The caller guarantees that the path is the active one.
+ *
+ * @tparam P The remaining indices of the path.
+ * @param value The (possibly nested) value.
+ * @return The leaf, forwarded with the value category of value.
+ */
+template <std::size_t... P, typename T>
+constexpr decltype(auto) leaf_get(std::index_sequence<P...>, T &&value) {
+  if constexpr (is_error_v<T>) {
+    return leaf_get(std::index_sequence<P...>{}, std::forward<T>(value).value);
+  } else if constexpr (is_boxed_v<T>) {
+    return leaf_get(std::index_sequence<P...>{}, *std::forward<T>(value));
+  } else if constexpr (is_contextual_v<T>) {
+    return leaf_get(std::index_sequence<P...>{}, std::forward<T>(value).error);
+  } else if constexpr (sizeof...(P) == 0) {
+    return std::forward<T>(value);
+  } else {
+    return [&]<std::size_t I, std::size_t... Rest>(std::index_sequence<I, Rest...>) -> decltype(auto) {
+      if (value.index() != I)
+        unreachable();
+      if constexpr (is_result_v<T> && sizeof...(Rest) == 0) {
+        // Returned directly: a packed Result hands out its sides by value.
+        if constexpr (I == 0)
+          return std::forward<T>(value).value_unchecked();
+        else
+          return std::forward<T>(value).error_unchecked();
+      } else if constexpr (is_result_v<T>) {
+        if constexpr (I == 0)
+          return leaf_get(std::index_sequence<Rest...>{}, std::forward<T>(value).value_unchecked());
+        else
+          return leaf_get(std::index_sequence<Rest...>{}, std::forward<T>(value).error_unchecked());
+      } else {
+        return leaf_get(std::index_sequence<Rest...>{}, std::get<I>(std::forward<T>(value)));
+      }
+    }(std::index_sequence<P...>{});
+  }
+}
+
+/// Up to this many alternatives, dispatch is an if-chain the compiler can inline fully.
+inline constexpr std::size_t dispatch_if_chain_limit = 4;
+
+template <std::size_t K, std::size_t N, typename F>
+constexpr decltype(auto) dispatch_if_chain(std::size_t index, F &&f) {
+  if constexpr (K + 1 == N) {
+    return std::forward<F>(f)(std::integral_constant<std::size_t, K>{});
+  } else {
+    if (index == K)
+      return std::forward<F>(f)(std::integral_constant<std::size_t, K>{});
+    return dispatch_if_chain<K + 1, N>(index, std::forward<F>(f));
+  }
+}
+
+template <std::size_t K, typename F>
+constexpr decltype(auto) dispatch_thunk(F &f) {
+  return std::forward<F>(f)(std::integral_constant<std::size_t, K>{});
+}
+
+/**
+ * @brief Calls f with std::integral_constant<std::size_t, index>, for index in [0, N).
+ *
+ * Small N becomes an if-chain, up to 64 a single switch, and anything larger
+ * a constexpr table of function pointers, so there is always exactly one
+ * dispatch no matter how the alternatives were nested.
+ *
+ * @tparam N The number of possible indices.
+ * @param index The runtime index; must be lower than N.
+ * @param f The callable receiving the index as a constant.
+ * @return What f returns.
+ */
+template <std::size_t N, typename F>
+constexpr decltype(auto) dispatch_index(std::size_t index, F &&f) {
+  static_assert(N > 0, "Nothing to dispatch to");
+#define CPPMATCH_DISPATCH_CASE(K)                                              \
+  case K:                                                                      \
+    if constexpr (K < N)                                                       \
+      return std::forward<F>(f)(std::integral_constant<std::size_t, K>{});     \
+    else                                                                       \
+      unreachable();
+#define CPPMATCH_DISPATCH_CASES_8(K)                                           \
+  CPPMATCH_DISPATCH_CASE(K + 0) CPPMATCH_DISPATCH_CASE(K + 1)                  \
+  CPPMATCH_DISPATCH_CASE(K + 2) CPPMATCH_DISPATCH_CASE(K + 3)                  \
+  CPPMATCH_DISPATCH_CASE(K + 4) CPPMATCH_DISPATCH_CASE(K + 5)                  \
+  CPPMATCH_DISPATCH_CASE(K + 6) CPPMATCH_DISPATCH_CASE(K + 7)
+  // Switches come in 16, 32 and 64 cases so that few discarded cases are
+  // instantiated for the N at hand.
+  if constexpr (N <= dispatch_if_chain_limit) {
+    return dispatch_if_chain<0, N>(index, std::forward<F>(f));
+  } else if constexpr (N <= 16) {
+    switch (index) {
+      CPPMATCH_DISPATCH_CASES_8(0)
+      CPPMATCH_DISPATCH_CASES_8(8)
+    default:
+      unreachable();
+    }
+  } else if constexpr (N <= 32) {
+    switch (index) {
+      CPPMATCH_DISPATCH_CASES_8(0)
+      CPPMATCH_DISPATCH_CASES_8(8)
+      CPPMATCH_DISPATCH_CASES_8(16)
+      CPPMATCH_DISPATCH_CASES_8(24)
+    default:
+      unreachable();
+    }
+  } else if constexpr (N <= 64) {
+    switch (index) {
+      CPPMATCH_DISPATCH_CASES_8(0)
+      CPPMATCH_DISPATCH_CASES_8(8)
+      CPPMATCH_DISPATCH_CASES_8(16)
+      CPPMATCH_DISPATCH_CASES_8(24)
+      CPPMATCH_DISPATCH_CASES_8(32)
+      CPPMATCH_DISPATCH_CASES_8(40)
+      CPPMATCH_DISPATCH_CASES_8(48)
+      CPPMATCH_DISPATCH_CASES_8(56)
+    default:
+      unreachable();
+    }
+  } else {
+    using R = decltype(std::forward<F>(f)(std::integral_constant<std::size_t, 0>{}));
+    return [&]<std::size_t... K>(std::index_sequence<K...>) -> R {
+      constexpr R (*table[])(F &) = {&dispatch_thunk<K, F>...};
+      return table[index](f);
+    }(std::make_index_sequence<N>{});
+  }
+#undef CPPMATCH_DISPATCH_CASES_8
+#undef CPPMATCH_DISPATCH_CASE
+}
+
+template <typename... Us, typename... Ts>
+struct alternative_remap<std::variant<Us...>, std::variant<Ts...>> {
+  /// Target index of each source alternative.
+  static constexpr std::size_t table[] = {index_of<Us, Ts...>()...};
+
+  /**
+   * @brief Builds the target variant with the active source alternative constructed in place.
+   *
+   * @param from The source variant, forwarded to the alternative constructor.
+   * @return The target variant, elided directly into the caller's storage.
+   */
+  template <typename Variant>
+  static constexpr std::variant<Ts...> convert(Variant &&from) {
+    if (from.valueless_by_exception())
+      throw_bad_variant_access();
+    return dispatch_index<sizeof...(Us)>(from.index(), [&](auto i) {
+      if (from.index() != i)
+        unreachable();
+      return std::variant<Ts...>(std::in_place_index<table[i]>,
+                                 std::get<i>(std::forward<Variant>(from)));
+    });
+  }
+};
+
+/**
+ * @brief Visits the innermost value of a nested Result, Error or variant.
+ *
+ * The nesting is flattened at compile time into a single list of leaf
+ * alternatives, so visiting reads the tags on the active path to build one
+ * combined index and then performs a single dispatch on it, instead of one
+ * std::visit per nesting level.
+ *
+ * @tparam T The type of the value.
+ * @tparam Visitor The visitor type.
+ * @param value The value to be visited.
+ * @param vis The visitor callable.
+ * @return The result of applying the visitor to the innermost value.
+ */
+template <typename T, typename Visitor>
+constexpr auto flat_visit(T &&value, Visitor &&vis) {
+  using Leaves = flat_leaves_t<T>;
+  auto visit_leaf = [&](auto k) -> decltype(auto) {
+    using Path = typename leaf_at_index<decltype(k)::value, Leaves>::type::path;
+    return std::forward<Visitor>(vis)(leaf_get(Path{}, std::forward<T>(value)));
+  };
+  if constexpr (Leaves::size == 1) {
+    return visit_leaf(std::integral_constant<std::size_t, 0>{});
+  } else {
+    return dispatch_index<Leaves::size>(leaf_index(value), visit_leaf);
+  }
+}
+
+/**
+ * @brief A tuple of references to values that match dispatches on together.
+ *
+ * Every element must be a Result, Error or variant; any other tuple is
+ * matched as a single value.
+ */
+template <typename T> struct is_match_tuple : std::false_type {};
+template <typename... Ts>
+struct is_match_tuple<std::tuple<Ts...>>
+    : std::bool_constant<(sizeof...(Ts) > 0) &&
+                         ((is_result_v<Ts> || is_error_v<Ts> || is_variant_v<Ts>) && ...)> {};
+
+template <typename T>
+constexpr bool is_match_tuple_v = is_match_tuple<std::remove_cvref_t<T>>::value;
+
+/**
+ * @brief The Cartesian product of the flattened alternatives of Ts.
+ *
+ * A combination is numbered in mixed radix, the last element varying
+ * fastest, so the per-element leaf indices combine into one index.
+ */
+template <typename... Ts> struct leaf_product {
+  static constexpr std::size_t counts[] = {leaf_count_v<Ts>...};
+  static constexpr std::size_t size = (leaf_count_v<Ts> * ... * 1);
+
+  static constexpr std::size_t stride(std::size_t j) {
+    std::size_t s = 1;
+    for (std::size_t i = j + 1; i < sizeof...(Ts); ++i)
+      s *= counts[i];
+    return s;
+  }
+
+  /// Leaf index of element j in combination k.
+  static constexpr std::size_t digit(std::size_t k, std::size_t j) {
+    return k / stride(j) % counts[j];
+  }
+};
+
+template <typename Tuple> struct leaf_product_of;
+template <typename... Ts> struct leaf_product_of<std::tuple<Ts...>> {
+  using type = leaf_product<Ts...>;
+};
+
+template <std::size_t J, std::size_t K, typename Tuple>
+using product_leaf_path = typename leaf_at_index<
+    leaf_product_of<std::remove_cvref_t<Tuple>>::type::digit(K, J),
+    flat_leaves_t<std::tuple_element_t<J, std::remove_cvref_t<Tuple>>>>::type::path;
+
+/**
+ * @brief Whether Visitor has a handler for every combination of alternatives.
+ */
+template <typename Visitor, typename Tuple, std::size_t... J, std::size_t... K>
+constexpr bool handles_every_combination(std::index_sequence<J...>, std::index_sequence<K...>) {
+  return ([]<std::size_t C>(std::integral_constant<std::size_t, C>) {
+    return std::is_invocable_v<Visitor, decltype(leaf_get(product_leaf_path<J, C, Tuple>{},
+                                                          std::get<J>(std::declval<Tuple>())))...>;
+  }(std::integral_constant<std::size_t, K>{}) && ...);
+}
+
+/**
+ * @brief Visits the innermost values of several Results, Errors or variants at once.
+ *
+ * The alternatives of all elements are flattened into their Cartesian
+ * product at compile time. The leaf indices of the elements combine into
+ * one index, so the visit is a single dispatch however many values take part.
+ *
+ * @param values A tuple of references, as made by std::tie or std::forward_as_tuple.
+ * @param vis The visitor, called with one leaf per element.
+ * @return The result of applying the visitor.
+ */
+template <typename Tuple, typename Visitor>
+constexpr auto flat_visit_product(Tuple &&values, Visitor &&vis) {
+  using Product = typename leaf_product_of<std::remove_cvref_t<Tuple>>::type;
+  constexpr std::size_t n = std::tuple_size_v<std::remove_cvref_t<Tuple>>;
+  return [&]<std::size_t... J>(std::index_sequence<J...> elements) {
+    static_assert(handles_every_combination<Visitor, Tuple &&>(
+                      elements, std::make_index_sequence<Product::size>{}),
+                  "match: some combination of alternatives has no handler");
+    auto visit_combination = [&](auto k) -> decltype(auto) {
+      return std::forward<Visitor>(vis)(
+          leaf_get(product_leaf_path<J, decltype(k)::value, Tuple>{},
+                   std::get<J>(std::forward<Tuple>(values)))...);
+    };
+    std::size_t index = ((leaf_index(std::get<J>(values)) * Product::stride(J)) + ...);
+    return dispatch_index<Product::size>(index, visit_combination);
+  }(std::make_index_sequence<n>{});
+}
+
+} // namespace cppmatch_detail
+
+/**
+ * @brief Checks if the Result holds an error.
+ *
+ * @tparam T The success type.
+ * @tparam E The error type.
+ * @param result The Result to check.
+ * @return true if the result holds an error; false otherwise.
+ */
+template <typename T, typename E>
+constexpr bool is_err(const Result<T, E> &result) noexcept {
+  return result.index() != 0;
+}
+
+/**
+ * @brief Checks if the Result holds a success value.
+ *
+ * @tparam T The success type.
+ * @tparam E The error type.
+ * @param result The Result to check.
+ * @return true if the result holds a success value; false otherwise.
+ */
+template <typename T, typename E>
+constexpr bool is_ok(const Result<T, E> &result) noexcept {
+  return !is_err(result);
+}
+
+/// Field pattern matching values in the closed range [Lo, Hi].
+template <auto Lo, auto Hi> struct range_pattern {};
+
+/// Matches a field whose value lies in [Lo, Hi].
+template <auto Lo, auto Hi> inline constexpr range_pattern<Lo, Hi> in_range{};
+
+/// Matches a field equal to V.
+template <auto V> inline constexpr range_pattern<V, V> equals{};
+
+/// A range test on the value read through Member (a data member, a nullary
+/// member function, or std::identity{} for the alternative itself).
+template <auto Member, auto Lo, auto Hi> struct field_test {};
+
+/// Builds a field_test: field<&Click::x>(in_range<0, 99>).
+template <auto Member> struct field_selector {
+  template <auto Lo, auto Hi>
+  constexpr field_test<Member, Lo, Hi> operator()(range_pattern<Lo, Hi>) const noexcept {
+    return {};
+  }
+};
+
+template <auto Member> inline constexpr field_selector<Member> field{};
+
+/// An arbitrary condition on the whole alternative, checked after its field tests.
+template <typename F> struct guard {
+  F pred;
+};
+
+/**
+ * @brief Wraps a predicate as a guard of a pattern: on<T>(..., when(pred)).
+ *
+ * @param pred Called with the alternative as a const reference.
+ * @return The guard.
+ */
+template <typename F> constexpr guard<std::decay_t<F>> when(F &&pred) {
+  return {std::forward<F>(pred)};
+}
+
+/// Stands for "any alternative" in the pattern built by otherwise.
+struct any_alternative {};
+
+namespace cppmatch_detail {
+
+template <typename... Tests> struct test_list {};
+
+/// The G-th guard of the arm that owns the test.
+template <std::size_t G> struct guard_test {};
+
+template <typename... Lists> struct list_concat;
+template <template <typename...> class L, typename... As>
+struct list_concat<L<As...>> {
+  using type = L<As...>;
+};
+template <template <typename...> class L, typename... As, typename... Bs, typename... Rest>
+struct list_concat<L<As...>, L<Bs...>, Rest...> : list_concat<L<As..., Bs...>, Rest...> {};
+
+template <typename... Lists>
+using list_concat_t = typename list_concat<Lists...>::type;
+
+template <typename T> struct is_guard : std::false_type {};
+template <typename F> struct is_guard<guard<F>> : std::true_type {};
+
+/// A pattern argument as a field test: a bare range tests the alternative itself.
+template <typename A> struct as_field_test {
+  using type = A;
+};
+template <auto Lo, auto Hi> struct as_field_test<range_pattern<Lo, Hi>> {
+  using type = field_test<std::identity{}, Lo, Hi>;
+};
+
+template <typename A>
+using pattern_tests_of = std::conditional_t<is_guard<A>::value, test_list<>,
+                                            test_list<typename as_field_test<A>::type>>;
+
+/// Ordering of pattern bounds and field values, without mixed-sign surprises.
+template <typename A, typename B>
+constexpr bool pattern_less(const A &a, const B &b) {
+  if constexpr (std::is_integral_v<A> && std::is_integral_v<B> &&
+                std::is_signed_v<A> != std::is_signed_v<B>) {
+    if constexpr (std::is_signed_v<A>)
+      return a < 0 || static_cast<std::make_unsigned_t<A>>(a) < b;
+    else
+      return b >= 0 && a < static_cast<std::make_unsigned_t<B>>(b);
+  } else {
+    return a < b;
+  }
+}
+
+template <typename A, typename B>
+constexpr bool pattern_equal(const A &a, const B &b) {
+  if constexpr (std::is_integral_v<A> && std::is_integral_v<B>)
+    return !pattern_less(a, b) && !pattern_less(b, a);
+  else
+    return a == b;
+}
+
+/**
+ * @brief What a known outcome of test Q says about test T.
+ *
+ * Only range tests on the same field are related; guards are opaque and
+ * never implied by, or in conflict with, anything.
+ */
+template <typename Q, typename T> struct test_relation {
+  /// Q true makes T true.
+  static constexpr bool implied = false;
+  /// Q true makes T false.
+  static constexpr bool contradicted = false;
+  /// T true would make Q true, so Q false makes T false.
+  static constexpr bool covered = false;
+};
+
+template <auto M, auto A, auto B, auto N, auto C, auto D>
+struct test_relation<field_test<M, A, B>, field_test<N, C, D>> {
+  static constexpr bool same_field =
+      std::is_same_v<std::integral_constant<decltype(M), M>, std::integral_constant<decltype(N), N>>;
+  static constexpr bool implied = same_field && !pattern_less(A, C) && !pattern_less(D, B);
+  static constexpr bool contradicted = same_field && (pattern_less(B, C) || pattern_less(D, A));
+  static constexpr bool covered = same_field && !pattern_less(C, A) && !pattern_less(B, D);
+};
+
+/// An arm still in play, with the tests it has left.
+template <std::size_t I, typename Tests> struct live_arm {};
+template <typename... Arms> struct live_set {};
+
+template <typename Q, typename Arm> struct refine_true;
+template <typename Q, std::size_t I, typename... Ts>
+struct refine_true<Q, live_arm<I, test_list<Ts...>>> {
+  using type = std::conditional_t<
+      (test_relation<Q, Ts>::contradicted || ...), live_set<>,
+      live_set<live_arm<I, list_concat_t<test_list<>, std::conditional_t<test_relation<Q, Ts>::implied,
+                                                                         test_list<>, test_list<Ts>>...>>>>;
+};
+
+template <typename Q, typename Arm> struct refine_false;
+template <typename Q, std::size_t I, typename... Ts>
+struct refine_false<Q, live_arm<I, test_list<Ts...>>> {
+  using type = std::conditional_t<(test_relation<Q, Ts>::covered || ...), live_set<>,
+                                  live_set<live_arm<I, test_list<Ts...>>>>;
+};
+
+template <std::size_t I, auto M, auto Lo, auto Hi, typename Leaf, typename Arms>
+constexpr bool evaluate_test(field_test<M, Lo, Hi>, const Leaf &leaf, Arms &) {
+  const auto &value = std::invoke(M, leaf);
+  if constexpr (pattern_equal(Lo, Hi))
+    return pattern_equal(value, Lo);
+  else
+    return !pattern_less(value, Lo) && !pattern_less(Hi, value);
+}
+
+template <std::size_t I, std::size_t G, typename Leaf, typename Arms>
+constexpr bool evaluate_test(guard_test<G>, const Leaf &leaf, Arms &arms) {
+  return static_cast<bool>(std::invoke(std::get<G>(std::get<I>(arms).guards).pred, leaf));
+}
+
+/**
+ * @brief The decision tree over the arms left for one alternative.
+ *
+ * The first live arm's next test is the one evaluated. Its outcome is then
+ * propagated to the other arms at compile time: on success, tests it implies
+ * are dropped and arms it contradicts are removed; on failure, arms that would
+ * have needed it are removed. Each node is a distinct instantiation, so a
+ * test whose outcome is already known never appears below it.
+ */
+template <typename Live> struct decision_tree {
+  template <typename Leaf, typename Arms>
+  static constexpr void run(Leaf &&, Arms &) {
+    static_assert(sizeof(Leaf) == 0, "match: the patterns for some alternative have no catch-all arm");
+  }
+};
+
+template <std::size_t I, typename... Rest>
+struct decision_tree<live_set<live_arm<I, test_list<>>, Rest...>> {
+  template <typename Leaf, typename Arms>
+  static constexpr decltype(auto) run(Leaf &&leaf, Arms &arms) {
+    return std::invoke(std::get<I>(arms).handler, std::forward<Leaf>(leaf));
+  }
+};
+
+template <std::size_t I, typename Q, typename... Ts, typename... Rest>
+struct decision_tree<live_set<live_arm<I, test_list<Q, Ts...>>, Rest...>> {
+  template <typename Leaf, typename Arms>
+  static constexpr decltype(auto) run(Leaf &&leaf, Arms &arms) {
+    using on_true = list_concat_t<live_set<live_arm<I, test_list<Ts...>>>,
+                                  typename refine_true<Q, Rest>::type...>;
+    using on_false = list_concat_t<live_set<>, typename refine_false<Q, Rest>::type...>;
+    if (evaluate_test<I>(Q{}, std::as_const(leaf), arms))
+      return decision_tree<on_true>::run(std::forward<Leaf>(leaf), arms);
+    return decision_tree<on_false>::run(std::forward<Leaf>(leaf), arms);
+  }
+};
+
+template <typename Arm> struct pattern_arm_traits;
+
+template <typename Is> struct guard_tests;
+template <std::size_t... G> struct guard_tests<std::index_sequence<G...>> {
+  using type = test_list<guard_test<G>...>;
+};
+
+/// The arms of Arms... that apply to alternative L, in order, with all their tests.
+template <typename L, typename Arms, typename Is> struct initial_live;
+template <typename L, typename... Arms, std::size_t... I>
+struct initial_live<L, std::tuple<Arms...>, std::index_sequence<I...>> {
+  using type = list_concat_t<
+      live_set<>,
+      std::conditional_t<pattern_arm_traits<std::decay_t<Arms>>::template applies_to<L>,
+                         live_set<live_arm<I, typename pattern_arm_traits<std::decay_t<Arms>>::tests>>,
+                         live_set<>>...>;
+};
+
+template <typename T, typename Leaves> struct has_leaf_type;
+template <typename T, typename... Leaves>
+struct has_leaf_type<T, leaf_list<Leaves...>>
+    : std::bool_constant<(std::is_same_v<T, typename Leaves::type> || ...)> {};
+
+} // namespace cppmatch_detail
+
+/**
+ * @brief A pattern on alternative T: field tests, then guards.
+ *
+ * Combine it with a handler through >> to get an arm for match.
+ */
+template <typename T, typename Tests, typename... Guards> struct pattern;
+
+/**
+ * @brief One arm of a pattern match: a pattern and the handler run when it matches.
+ */
+template <typename T, typename Tests, typename Guards, typename Handler> struct pattern_arm {
+  Guards guards;
+  Handler handler;
+};
+
+template <typename T, typename... Tests, typename... Guards>
+struct pattern<T, cppmatch_detail::test_list<Tests...>, Guards...> {
+  std::tuple<Guards...> guards;
+
+  template <typename Handler>
+  constexpr auto operator>>(Handler &&handler) const & {
+    return pattern_arm<T, cppmatch_detail::test_list<Tests...>, std::tuple<Guards...>,
+                       std::decay_t<Handler>>{guards, std::forward<Handler>(handler)};
+  }
+
+  template <typename Handler>
+  constexpr auto operator>>(Handler &&handler) && {
+    return pattern_arm<T, cppmatch_detail::test_list<Tests...>, std::tuple<Guards...>,
+                       std::decay_t<Handler>>{std::move(guards), std::forward<Handler>(handler)};
+  }
+};
+
+/**
+ * @brief Builds a pattern on alternative T.
+ *
+ * Arguments are field tests (field<&T::m>(in_range<a, b>), or a bare
+ * in_range/equals to test the alternative itself) and guards (when(pred)),
+ * all of which must hold. Field tests are evaluated before guards.
+ *
+ * @tparam T The alternative the pattern applies to.
+ * @param parts The field tests and guards.
+ * @return The pattern, to be completed with >> handler.
+ */
+template <typename T, typename... Parts>
+constexpr auto on(Parts &&...parts) {
+  using tests = cppmatch_detail::list_concat_t<cppmatch_detail::test_list<>,
+                                               cppmatch_detail::pattern_tests_of<std::decay_t<Parts>>...>;
+  auto guards = std::tuple_cat([&]() {
+    if constexpr (cppmatch_detail::is_guard<std::decay_t<Parts>>::value)
+      return std::tuple<std::decay_t<Parts>>(std::forward<Parts>(parts));
+    else
+      return std::tuple<>();
+  }()...);
+  return std::apply([](auto &&...g) {
+    return pattern<T, tests, std::decay_t<decltype(g)>...>{{std::move(g)...}};
+  }, std::move(guards));
+}
+
+/// A pattern matching whatever alternative reaches it.
+inline constexpr pattern<any_alternative, cppmatch_detail::test_list<>> otherwise{};
+
+namespace cppmatch_detail {
+
+template <typename T, typename... Tests, typename... Guards, typename Handler>
+struct pattern_arm_traits<pattern_arm<T, test_list<Tests...>, std::tuple<Guards...>, Handler>> {
+  using type = T;
+  using tests = list_concat_t<test_list<Tests...>,
+                              typename guard_tests<std::index_sequence_for<Guards...>>::type>;
+  template <typename L>
+  static constexpr bool applies_to = std::is_same_v<T, any_alternative> || std::is_same_v<T, L>;
+};
+
+template <typename T> struct is_pattern_arm : std::false_type {};
+template <typename T, typename Tests, typename Guards, typename Handler>
+struct is_pattern_arm<pattern_arm<T, Tests, Guards, Handler>> : std::true_type {};
+
+template <typename T>
+inline constexpr bool is_pattern_arm_v = is_pattern_arm<std::decay_t<T>>::value;
+
+/**
+ * @brief A visitor running the decision tree of each alternative over arms.
+ *
+ * The arms are held by reference and must outlive the visitor.
+ */
+template <typename... Arms>
+constexpr auto pattern_visitor(Arms &&...arms) {
+  return [arm_refs = std::forward_as_tuple(arms...)](auto &&leaf) mutable -> decltype(auto) {
+    using Live = typename initial_live<std::decay_t<decltype(leaf)>, std::tuple<Arms...>,
+                                       std::index_sequence_for<Arms...>>::type;
+    return decision_tree<Live>::run(std::forward<decltype(leaf)>(leaf), arm_refs);
+  };
+}
+
+/**
+ * @brief Matches a value against pattern arms.
+ *
+ * The alternative is found with the usual single flattened dispatch, and only
+ * the arms written for it take part in its decision tree.
+ */
+template <typename T, typename... Arms>
+constexpr decltype(auto) pattern_visit(T &&value, Arms &&...arms) {
+  using Leaves = flat_leaves_t<T>;
+  static_assert(((std::is_same_v<typename pattern_arm_traits<std::decay_t<Arms>>::type, any_alternative> ||
+                  has_leaf_type<typename pattern_arm_traits<std::decay_t<Arms>>::type, Leaves>::value) &&
+                 ...),
+                "match: a pattern names a type that is not an alternative of the value");
+  return flat_visit(std::forward<T>(value), pattern_visitor(std::forward<Arms>(arms)...));
+}
+
+/// Whether a handler's R leaves flat_visit, which returns auto, without throwing:
+/// a prvalue is elided into the caller, a reference is decay-copied.
+template <typename R>
+inline constexpr bool nothrow_decay_return_v =
+    !std::is_reference_v<R> || std::is_nothrow_constructible_v<std::decay_t<R>, R>;
+
+template <typename Visitor, typename... Args>
+struct nothrow_handler_call
+    : std::bool_constant<noexcept(std::declval<Visitor>()(std::declval<Args>()...)) &&
+                         nothrow_decay_return_v<decltype(std::declval<Visitor>()(
+                             std::declval<Args>()...))>> {};
+
+template <typename T, typename Visitor, typename Leaf>
+struct nothrow_visit_leaf
+    : nothrow_handler_call<Visitor, decltype(leaf_get(typename Leaf::path{}, std::declval<T>()))> {};
+
+/// Whether Visitor, as an rvalue, handles every leaf of T without throwing.
+/// A conjunction, so the usual handlers without noexcept stop at the first leaf.
+template <typename T, typename Visitor, typename Leaves = flat_leaves_t<T>>
+struct nothrow_visit;
+template <typename T, typename Visitor, typename... Ls>
+struct nothrow_visit<T, Visitor, leaf_list<Ls...>>
+    : std::conjunction<nothrow_visit_leaf<T, Visitor, Ls>...> {};
+
+/// Whether Visitor handles every combination of leaves of the tuple without throwing.
+template <typename Visitor, typename Tuple, std::size_t... J, std::size_t... K>
+constexpr bool nothrow_every_combination(std::index_sequence<J...>, std::index_sequence<K...>) {
+  auto nothrow_at = []<std::size_t C>(std::integral_constant<std::size_t, C>) {
+    return nothrow_handler_call<
+        Visitor, decltype(leaf_get(product_leaf_path<J, C, Tuple>{},
+                                   std::get<J>(std::declval<Tuple>())))...>::value;
+  };
+  return (nothrow_at(std::integral_constant<std::size_t, K>{}) && ...);
+}
+
+/// Which branch of match handles Variant with these handlers.
+enum class match_kind { pipeline, patterns, tuple, plain };
+
+template <typename Variant, typename... Lambdas>
+inline constexpr match_kind match_kind_v =
+    is_result_pipeline_v<Variant>                                       ? match_kind::pipeline
+    : sizeof...(Lambdas) > 0 && (is_pattern_arm_v<Lambdas> && ...) ? match_kind::patterns
+    : is_match_tuple_v<Variant>                                         ? match_kind::tuple
+                                                                        : match_kind::plain;
+
+/// Whether the handlers can be forwarded into one overloaded visitor without throwing.
+/// One noexcept expression: is_nothrow_constructible_v per closure type added a
+/// quarter to the compiler's memory on a large TU.
+template <typename... Lambdas>
+struct nothrow_handlers : std::bool_constant<noexcept(overloaded{std::declval<Lambdas>()...})> {};
+
+template <match_kind Kind, typename Variant, typename... Lambdas>
+struct nothrow_match_kind : std::false_type {};
+
+template <typename Variant, typename... Lambdas>
+inline constexpr bool nothrow_match_v =
+    nothrow_match_kind<match_kind_v<Variant, Lambdas...>, Variant, Lambdas...>::value;
+
+template <typename Variant, typename... Lambdas>
+struct nothrow_match_kind<match_kind::pipeline, Variant, Lambdas...>
+    : std::bool_constant<std::remove_cvref_t<Variant>::nothrow &&
+                         nothrow_match_v<typename std::remove_cvref_t<Variant>::result_type,
+                                         Lambdas...>> {};
+
+template <typename Variant, typename... Lambdas>
+struct nothrow_match_kind<match_kind::tuple, Variant, Lambdas...>
+    : std::conjunction<
+          nothrow_handlers<Lambdas...>,
+          std::bool_constant<nothrow_every_combination<overloaded<std::decay_t<Lambdas>...>, Variant>(
+              std::make_index_sequence<std::tuple_size_v<std::remove_cvref_t<Variant>>>{},
+              std::make_index_sequence<
+                  leaf_product_of<std::remove_cvref_t<Variant>>::type::size>{})>> {};
+
+template <typename Variant, typename... Lambdas>
+struct nothrow_match_kind<match_kind::plain, Variant, Lambdas...>
+    : std::conjunction<nothrow_handlers<Lambdas...>,
+                       nothrow_visit<Variant, overloaded<std::decay_t<Lambdas>...>>> {};
+
+} // namespace cppmatch_detail
+
+/**
+ * @brief Matches over the alternatives in a Result or nested variant.
+ *
+ * This function flattens nested Error or variant types and applies the provided
+ * overloaded lambdas to the innermost value. A pending combinator chain
+ * (r | transform(f) | ...) is evaluated first.
+ *
+ * Passing std::tie(a, b, ...) of Results, Errors or variants matches them
+ * together: each lambda takes one leaf per element, every combination must
+ * be handled, and the dispatch is a single jump over the product.
+ *
+ * Passing pattern arms (on<T>(field tests..., guards...) >> handler, or
+ * otherwise >> handler) matches on values as well: the first arm, in order,
+ * whose type and tests match runs.
+ *
+ * match is noexcept when every handler is noexcept for the leaves it can receive (and
+ * a pending chain cannot throw); a valueless variant then terminates instead
+ * of throwing bad_variant_access. Pattern arms are never considered noexcept.
+ *
+ * @tparam Variant The type of the variant.
+ * @tparam Lambdas The lambda functions to handle each alternative.
+ * @param v The variant value.
+ * @param lambdas The lambda handlers.
+ * @return The result of the matching.
+ */
+template <typename Variant, typename... Lambdas>
+constexpr auto match(Variant &&v, Lambdas &&...lambdas) noexcept(
+    cppmatch_detail::nothrow_match_v<Variant, Lambdas...>) {
+  if constexpr (cppmatch_detail::is_result_pipeline_v<Variant>)
+    return match(std::forward<Variant>(v).evaluate(), std::forward<Lambdas>(lambdas)...);
+  else if constexpr (sizeof...(Lambdas) > 0 && (cppmatch_detail::is_pattern_arm_v<Lambdas> && ...))
+    return cppmatch_detail::pattern_visit(std::forward<Variant>(v), std::forward<Lambdas>(lambdas)...);
+  else if constexpr (cppmatch_detail::is_match_tuple_v<Variant>)
+    return cppmatch_detail::flat_visit_product(
+        std::forward<Variant>(v),
+        cppmatch_detail::overloaded{std::forward<Lambdas>(lambdas)...});
+  else
+    return cppmatch_detail::flat_visit(
+        std::forward<Variant>(v),
+        cppmatch_detail::overloaded{std::forward<Lambdas>(lambdas)...});
+}
+
+#if defined(CPPMATCH_INSTRUMENT)
+/// How an error left a function.
+enum class propagation_kind { expect, expect_cold, expect_ctx, expect_e };
+
+/**
+ * @brief How many times errors of one type propagated through one call site.
+ */
+struct propagation_count {
+  std::source_location where;
+  propagation_kind kind;
+  /// The flattened error alternative, as spelled by the compiler.
+  std::string_view error_type;
+  std::uint64_t count;
+};
+
+namespace cppmatch_detail {
+
+/// The name of T as spelled by the compiler.
+template <typename T> constexpr std::string_view type_name() {
+#if defined(__clang__) || defined(__GNUC__)
+  std::string_view name = __PRETTY_FUNCTION__;
+  name.remove_prefix(name.find("T = ") + 4);
+  return name.substr(0, name.find_first_of(";]"));
+#elif defined(_MSC_VER)
+  std::string_view name = __FUNCSIG__;
+  name.remove_prefix(name.find("type_name<") + 10);
+  return name.substr(0, name.rfind(">(void)"));
+#else
+  return "unknown";
+#endif
+}
+
+template <typename List> struct leaf_names;
+template <typename... Ls> struct leaf_names<leaf_list<Ls...>> {
+  static constexpr std::string_view value[sizeof...(Ls) + 1] = {
+      type_name<typename Ls::type>()..., {}};
+};
+
+/**
+ * @brief Global table of propagation sites and per-thread counter shards.
+ *
+ * Every site owns a range of counter slots, one per flattened error
+ * alternative. Each thread increments its own shard with plain relaxed loads
+ * and stores, so the error path takes no lock. The mutex is only taken when a
+ * site is first seen, when a thread first counts or exits, and by snapshots.
+ */
+class propagation_registry {
+public:
+  static constexpr std::size_t block_size = 256;
+  static constexpr std::size_t max_blocks = 4096;
+
+  struct site {
+    std::source_location where;
+    propagation_kind kind;
+    const std::string_view *names;
+    std::size_t leaves;
+    std::size_t base;
+  };
+
+  /// The counters of one thread, readable by snapshots from other threads.
+  struct shard {
+    std::atomic<std::atomic<std::uint64_t> *> blocks[max_blocks] = {};
+    /// Events in slots past the last block, which have no counter.
+    std::atomic<std::uint64_t> dropped{0};
+
+    /// Counts one event in @p slot, or in dropped if the slot is past the last block.
+    void bump(std::size_t slot) {
+      if (slot >= max_blocks * block_size) [[unlikely]] {
+        dropped.store(dropped.load(std::memory_order_relaxed) + 1,
+                      std::memory_order_relaxed);
+        return;
+      }
+      auto *block = blocks[slot / block_size].load(std::memory_order_acquire);
+      if (!block) [[unlikely]] {
+        block = new std::atomic<std::uint64_t>[block_size]();
+        blocks[slot / block_size].store(block, std::memory_order_release);
+      }
+      auto &counter = block[slot % block_size];
+      counter.store(counter.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_relaxed);
+    }
+
+    template <typename F> void for_each_count(F &&f) const {
+      for (std::size_t b = 0; b < max_blocks; ++b)
+        if (auto *block = blocks[b].load(std::memory_order_acquire))
+          for (std::size_t i = 0; i < block_size; ++i)
+            f(b * block_size + i, block[i].load(std::memory_order_relaxed));
+    }
+
+    ~shard() {
+      for (auto &block : blocks)
+        delete[] block.load(std::memory_order_relaxed);
+    }
+  };
+
+  // Never destroyed, so threads exiting after main can still retire their shard.
+  static propagation_registry &instance() {
+    static propagation_registry *registry = new propagation_registry;
+    return *registry;
+  }
+
+  std::size_t add_site(std::source_location where, propagation_kind kind,
+                       const std::string_view *names, std::size_t leaves) {
+    std::lock_guard lock(mutex_);
+    return add_site_locked(where, kind, names, leaves);
+  }
+
+  /**
+   * @brief Returns the slots of a site, registering it on its first call only.
+   *
+   * Sites are identified by location, kind and error type (through the
+   * address of its leaf names), so any number of threads reaching the same
+   * site share one row of counters.
+   */
+  std::size_t find_or_add_site(std::source_location where, propagation_kind kind,
+                               const std::string_view *names, std::size_t leaves) {
+    std::lock_guard lock(mutex_);
+    auto [it, added] = site_bases_.try_emplace(site_key{where, kind, names}, 0);
+    if (added)
+      it->second = add_site_locked(where, kind, names, leaves);
+    return it->second;
+  }
+
+  /// The calling thread's shard, registered on first use.
+  shard &local_shard() {
+    struct owner {
+      shard *s = nullptr;
+      ~owner() {
+        if (s)
+          instance().retire(s);
+      }
+    };
+    thread_local owner mine;
+    if (!mine.s) [[unlikely]] {
+      mine.s = new shard;
+      std::lock_guard lock(mutex_);
+      shards_.push_back(mine.s);
+    }
+    return *mine.s;
+  }
+
+  /**
+   * @brief The counts since the last reset, one row per location, kind and error type.
+   *
+   * A site inside a template is registered once per instantiation; rows of
+   * instantiations that share a location and an error type are summed.
+   */
+  std::vector<propagation_count> snapshot() {
+    std::lock_guard lock(mutex_);
+    std::vector<std::uint64_t> totals = totals_locked();
+    std::vector<propagation_count> out;
+    std::unordered_map<row_key, std::size_t, row_key_hash> rows;
+    for (const site &s : sites_)
+      for (std::size_t leaf = 0; leaf < s.leaves; ++leaf) {
+        const std::size_t slot = s.base + leaf;
+        const std::uint64_t base = slot < baseline_.size() ? baseline_[slot] : 0;
+        if (totals[slot] <= base)
+          continue;
+        auto [it, added] = rows.try_emplace(row_key{s.where, s.kind, s.names[leaf]}, out.size());
+        if (added)
+          out.push_back({s.where, s.kind, s.names[leaf], 0});
+        out[it->second].count += totals[slot] - base;
+      }
+    return out;
+  }
+
+  /// Events since the last reset that fell past the last counter block.
+  std::uint64_t dropped() {
+    std::lock_guard lock(mutex_);
+    return dropped_locked() - baseline_dropped_;
+  }
+
+  void reset() {
+    std::lock_guard lock(mutex_);
+    baseline_ = totals_locked();
+    baseline_dropped_ = dropped_locked();
+  }
+
+private:
+  struct site_key {
+    std::source_location where;
+    propagation_kind kind;
+    const std::string_view *names;
+
+    friend bool operator==(const site_key &a, const site_key &b) noexcept {
+      return a.where.line() == b.where.line() && a.where.column() == b.where.column() &&
+             a.kind == b.kind && a.names == b.names &&
+             std::string_view(a.where.file_name()) == b.where.file_name();
+    }
+  };
+
+  struct site_key_hash {
+    std::size_t operator()(const site_key &k) const noexcept {
+      return std::hash<std::string_view>{}(k.where.file_name()) ^
+             (std::size_t{k.where.line()} << 16) ^ k.where.column() ^
+             std::hash<const void *>{}(k.names);
+    }
+  };
+
+  /// A row of a snapshot: like site_key, with the error type by name.
+  struct row_key {
+    std::source_location where;
+    propagation_kind kind;
+    std::string_view error_type;
+
+    friend bool operator==(const row_key &a, const row_key &b) noexcept {
+      return a.where.line() == b.where.line() && a.where.column() == b.where.column() &&
+             a.kind == b.kind && a.error_type == b.error_type &&
+             std::string_view(a.where.file_name()) == b.where.file_name();
+    }
+  };
+
+  struct row_key_hash {
+    std::size_t operator()(const row_key &k) const noexcept {
+      return std::hash<std::string_view>{}(k.where.file_name()) ^
+             (std::size_t{k.where.line()} << 16) ^ k.where.column() ^
+             std::hash<std::string_view>{}(k.error_type);
+    }
+  };
+
+  std::size_t add_site_locked(std::source_location where, propagation_kind kind,
+                              const std::string_view *names, std::size_t leaves) {
+    const std::size_t base = next_slot_;
+    next_slot_ += leaves;
+    sites_.push_back({where, kind, names, leaves, base});
+    return base;
+  }
+
+  std::vector<std::uint64_t> totals_locked() const {
+    std::vector<std::uint64_t> totals = retired_;
+    totals.resize(next_slot_);
+    for (const shard *sh : shards_)
+      sh->for_each_count([&](std::size_t slot, std::uint64_t count) {
+        if (slot < totals.size())
+          totals[slot] += count;
+      });
+    return totals;
+  }
+
+  std::uint64_t dropped_locked() const {
+    std::uint64_t total = retired_dropped_;
+    for (const shard *sh : shards_)
+      total += sh->dropped.load(std::memory_order_relaxed);
+    return total;
+  }
+
+  void retire(shard *sh) {
+    {
+      std::lock_guard lock(mutex_);
+      retired_dropped_ += sh->dropped.load(std::memory_order_relaxed);
+      retired_.resize(next_slot_);
+      sh->for_each_count([&](std::size_t slot, std::uint64_t count) {
+        if (slot < retired_.size())
+          retired_[slot] += count;
+      });
+      std::erase(shards_, sh);
+    }
+    delete sh;
+  }
+
+  std::mutex mutex_;
+  std::vector<site> sites_;
+  std::unordered_map<site_key, std::size_t, site_key_hash> site_bases_;
+  std::vector<shard *> shards_;
+  std::vector<std::uint64_t> retired_;
+  std::vector<std::uint64_t> baseline_;
+  std::uint64_t retired_dropped_ = 0;
+  std::uint64_t baseline_dropped_ = 0;
+  std::size_t next_slot_ = 0;
+};
+
+/**
+ * @brief Counts one propagation of @p error from the site identified by Site.
+ *
+ * Site is a type unique to the macro expansion, so the site's slots are
+ * looked up through a function-local static.
+ */
+template <propagation_kind Kind, typename Site, typename Err>
+void record_propagation(const Err &error, std::source_location where) {
+  using Leaves = flat_leaves_t<Err>;
+  static const std::size_t base = propagation_registry::instance().add_site(
+      where, Kind, leaf_names<Leaves>::value, Leaves::size);
+  propagation_registry::instance().local_shard().bump(base + leaf_index(error));
+}
+
+/**
+ * @brief Counts one propagation of @p error from a call site known only at runtime.
+ *
+ * Used by expect_e, whose call site arrives as a std::source_location. The
+ * registry gives each site its slots once per process; each thread caches
+ * them for the sites it has seen.
+ */
+template <propagation_kind Kind, typename Err>
+void record_propagation_at(const Err &error, std::source_location where) {
+  using Leaves = flat_leaves_t<Err>;
+  struct key_hash {
+    std::size_t operator()(const std::source_location &l) const noexcept {
+      return std::hash<const void *>{}(l.file_name()) ^ (std::size_t{l.line()} << 16) ^
+             l.column();
+    }
+  };
+  struct key_equal {
+    bool operator()(const std::source_location &a,
+                    const std::source_location &b) const noexcept {
+      return a.line() == b.line() && a.column() == b.column() &&
+             std::string_view(a.file_name()) == b.file_name();
+    }
+  };
+  thread_local std::unordered_map<std::source_location, std::size_t, key_hash, key_equal>
+      bases;
+  auto it = bases.find(where);
+  if (it == bases.end()) [[unlikely]]
+    it = bases
+             .emplace(where, propagation_registry::instance().find_or_add_site(
+                                 where, Kind, leaf_names<Leaves>::value, Leaves::size))
+             .first;
+  propagation_registry::instance().local_shard().bump(it->second + leaf_index(error));
+}
+
+} // namespace cppmatch_detail
+
+/**
+ * @brief Returns how often each error type propagated through each call site.
+ *
+ * Sums the counters of every thread, live or exited, since the last
+ * reset_propagation_counts(). Only available with CPPMATCH_INSTRUMENT.
+ */
+inline std::vector<propagation_count> propagation_counts() {
+  return cppmatch_detail::propagation_registry::instance().snapshot();
+}
+
+/**
+ * @brief How many propagations propagation_counts() is missing.
+ *
+ * The counters have room for a fixed number of sites and error types
+ * (propagation_registry::max_blocks * block_size slots in all); events at
+ * sites registered past that are only counted here. Also since the last reset.
+ */
+inline std::uint64_t dropped_propagation_counts() {
+  return cppmatch_detail::propagation_registry::instance().dropped();
+}
+
+/**
+ * @brief Starts counting from zero again, for every thread.
+ */
+inline void reset_propagation_counts() {
+  cppmatch_detail::propagation_registry::instance().reset();
+}
+
+#define CPPMATCH_RECORD_PROPAGATION(kind, error)                               \
+  cppmatch::cppmatch_detail::record_propagation<kind, decltype([] {})>(        \
+      error, std::source_location::current())
+#else
+#define CPPMATCH_RECORD_PROPAGATION(kind, error) ((void)0)
+#endif
+
+#if defined(CPPMATCH_TRACE)
+namespace cppmatch_detail {
+
+/**
+ * @brief Returns @p error with @p where appended to its propagation trace.
+ *
+ * Only reached on the error branch of expect, so the copy or move it makes
+ * never touches the success path.
+ */
+template <typename... Ts>
+constexpr Error<Ts...> traced(Error<Ts...> error, std::source_location where) noexcept(
+    std::is_nothrow_move_constructible_v<Error<Ts...>>) {
+  error.trace.push(where);
+  return error;
+}
+
+/// A Contextual records the site in the trace of the Error it wraps, if any.
+template <typename E>
+constexpr Contextual<E> traced(Contextual<E> error, std::source_location where) noexcept(
+    std::is_nothrow_move_constructible_v<Contextual<E>>) {
+  if constexpr (is_error_v<E>)
+    error.error.trace.push(where);
+  return error;
+}
+
+/// Errors that are not an Error carry no trace and pass through untouched.
+template <typename E>
+  requires(!is_error_v<std::remove_cvref_t<E>> && !is_contextual_v<std::remove_cvref_t<E>>)
+constexpr E &&traced(E &&error, std::source_location) noexcept {
+  return std::forward<E>(error);
+}
+
+} // namespace cppmatch_detail
+
+#define CPPMATCH_TRACED(error)                                                 \
+  cppmatch::cppmatch_detail::traced(error, std::source_location::current())
+#else
+#define CPPMATCH_TRACED(error) error
+#endif
+
+#if (defined(__GNUC__) || (defined(__clang__)))
+namespace cppmatch_detail {
+
+/**
+ * @brief An error on its way out of a function through expect_cold.
+ *
+ * Converting it into the caller's Result is what builds (and widens) the
+ * error, and that conversion is kept out of line and marked cold so it
+ * does not share cache lines with the success path.
+ *
+ * @tparam ErrorRef Reference to the error being propagated.
+ */
+template <typename ErrorRef>
+struct propagated_error {
+  ErrorRef error;
+
+  template <typename T, typename E>
+    requires std::is_constructible_v<E, ErrorRef>
+  [[gnu::cold, gnu::noinline]] constexpr operator Result<T, E>() && noexcept(
+      std::is_nothrow_constructible_v<E, ErrorRef>) {
+    return Result<T, E>(std::in_place_index<1>, std::forward<ErrorRef>(error));
+  }
+};
+
+/**
+ * @brief An error on its way out of a function through expect_ctx.
+ *
+ * Like propagated_error, but the conversion also calls the context function
+ * and pushes its text, so the context is only built once an error is known.
+ *
+ * @tparam ErrorRef Reference to the error being propagated.
+ * @tparam Ctx The context function, or a string.
+ */
+template <typename ErrorRef, typename Ctx>
+struct propagated_context {
+  ErrorRef error;
+  Ctx ctx;
+
+  template <typename T, typename E>
+    requires std::is_constructible_v<E, ErrorRef>
+  [[gnu::cold, gnu::noinline]] constexpr operator Result<T, E>() && {
+    static_assert(is_contextual_v<E>,
+                  "expect_ctx: the enclosing function's error type must be a Contextual");
+    E out(std::forward<ErrorRef>(error));
+    out.context.push(std::string_view(context_text(ctx)));
+    return Result<T, E>(std::in_place_index<1>, std::move(out));
+  }
+};
+
+template <typename ErrorRef, typename Ctx>
+constexpr propagated_context<ErrorRef, std::decay_t<Ctx>>
+propagate_with_context(ErrorRef error, Ctx &&ctx) {
+  return {std::forward<ErrorRef>(error), std::forward<Ctx>(ctx)};
+}
+
+} // namespace cppmatch_detail
+#endif
+
+/**
+ * @brief Macro to unwrap a Result or return an error.
+ *
+ * This macro evaluates an expression that returns a Result. If the result is an error,
  * it returns the error immediately; otherwise, it extracts and returns the success value.
  *
+ * Defining CPPMATCH_COLD_EXPECT before including this header makes expect behave
+ * as expect_cold. Defining CPPMATCH_INSTRUMENT counts every propagated error
+ * per call site and error type; see propagation_counts(). Defining
+ * CPPMATCH_TRACE appends the call site to the Error's propagation_trace.
+ *
  * @param expr An expression that returns a Result.
  */
 #if (defined(__GNUC__) || (defined(__clang__)))
+#if defined(CPPMATCH_COLD_EXPECT)
+#define expect(expr) expect_cold(expr)
+#else
 #define expect(expr)                                                           \
   __extension__({                                                              \
     auto &&expr_ = (expr);                                                     \
-    if (cppmatch::is_err(expr_))                                               \
-      return std::get<1>(std::move(expr_)); /* Handle error case */            \
-    std::get<0>(std::move(expr_));                                             \
+    if (cppmatch::is_err(expr_)) {                                             \
+      CPPMATCH_RECORD_PROPAGATION(cppmatch::propagation_kind::expect,          \
+                                  expr_.error_unchecked());                    \
+      return CPPMATCH_TRACED(std::move(expr_).error_unchecked());             \
+    }                                                                          \
+    std::move(expr_).value_unchecked();                                        \
+  })
+#endif
+
+/**
+ * @brief Macro to unwrap a Result or return an error, with the error path kept cold.
+ *
+ * Same as expect, but the error branch is marked [[unlikely]] and the error is
+ * converted into the enclosing function's Result by an out-of-line cold
+ * function, so the inlined success path is only a tag test and a fall-through.
+ * The enclosing function must return a Result.
+ *
+ * @param expr An expression that returns a Result.
+ */
+#define expect_cold(expr)                                                      \
+  __extension__({                                                              \
+    auto &&expr_ = (expr);                                                     \
+    if (cppmatch::is_err(expr_)) [[unlikely]] {                                \
+      CPPMATCH_RECORD_PROPAGATION(cppmatch::propagation_kind::expect_cold,     \
+                                  expr_.error_unchecked());                    \
+      return cppmatch::cppmatch_detail::propagated_error<                      \
+          decltype(CPPMATCH_TRACED(std::move(expr_).error_unchecked()))>{      \
+          CPPMATCH_TRACED(std::move(expr_).error_unchecked())};                \
+    }                                                                          \
+    std::move(expr_).value_unchecked();                                        \
+  })
+
+/**
+ * @brief Macro to unwrap a Result or return its error with one more context frame.
+ *
+ * Same as expect_cold, but on the error path the error is converted into the
+ * enclosing function's Contextual error and the text of the context is pushed
+ * onto its frames. The context is a callable returning something convertible
+ * to std::string_view, or such a string itself; a callable only runs when an
+ * error propagates, so formatting the context costs nothing on success.
+ *
+ * @code
+ * auto port = expect_ctx(parse_port(text), [&] { return std::format("port {}", text); });
+ * @endcode
+ *
+ * @param expr An expression that returns a Result.
+ * @param ... The context.
+ */
+#define expect_ctx(expr, ...)                                                  \
+  __extension__({                                                              \
+    auto &&expr_ = (expr);                                                     \
+    if (cppmatch::is_err(expr_)) [[unlikely]] {                                \
+      CPPMATCH_RECORD_PROPAGATION(cppmatch::propagation_kind::expect_ctx,      \
+                                  expr_.error_unchecked());                    \
+      return cppmatch::cppmatch_detail::propagate_with_context<                \
+          decltype(CPPMATCH_TRACED(std::move(expr_).error_unchecked()))>(      \
+          CPPMATCH_TRACED(std::move(expr_).error_unchecked()), __VA_ARGS__);   \
+    }                                                                          \
+    std::move(expr_).value_unchecked();                                        \
   })
 #elif defined(_MSC_VER)
 #define expect(expr)                                                           \
   static_assert([] { return false; }(),                                        \
                 "MSVC does not support 'statement expressions ({}), you can "  \
                 "still use the expect_e / match_e which use exceptions.")
+#define expect_cold(expr) expect(expr)
+#define expect_ctx(expr, ...) expect(expr)
 #else
 #define expect(expr)                                                           \
   static_assert(                                                               \
       [] { return false; }(),                                                  \
       "Unknown compiler: does not support 'statement expressions ({}), you "   \
       "can still use the expect_e / match_e which use exceptions.")
+#define expect_cold(expr) expect(expr)
+#define expect_ctx(expr, ...) expect(expr)
 #endif
 
 /**
- * @brief Returns the success value from a Result or a provided default.
+ * @brief Returns the success value from a Result or a provided default.
+ *
+ * @tparam T The success type.
+ * @tparam E The error type.
+ * @param result The Result to extract from.
+ * @param default_value The default value to return if the Result holds an error.
+ * @return The success value or the default value.
+ */
+template <typename T, typename E>
+constexpr T default_expect(const Result<T, E> &result, T &&default_value) noexcept(
+    std::is_nothrow_copy_constructible_v<T> && std::is_nothrow_move_constructible_v<T>) {
+  if (is_ok(result))
+    return result.value_unchecked();
+  return std::move(default_value);
+}
+
+/// Same as above, moving the success value out of an rvalue Result.
+template <typename T, typename E>
+constexpr T default_expect(Result<T, E> &&result, T &&default_value) noexcept(
+    std::is_nothrow_move_constructible_v<T>) {
+  if (is_ok(result))
+    return std::move(result).value_unchecked();
+  return std::move(default_value);
+}
+
+namespace cppmatch_detail {
+
+/// Whether default_expect_with(R, F) runs without throwing on either path.
+template <typename R, typename F>
+inline constexpr bool nothrow_default_expect_with_v = [] {
+  using V = decltype(std::declval<R>().value_unchecked());
+  using Er = decltype(std::declval<R>().error_unchecked());
+  using T = std::remove_cvref_t<V>;
+  if constexpr (!std::is_nothrow_constructible_v<T, V>)
+    return false;
+  else if constexpr (std::is_invocable_v<F, Er>)
+    return std::is_nothrow_invocable_v<F, Er> &&
+           std::is_nothrow_constructible_v<T, std::invoke_result_t<F, Er>>;
+  else
+    return std::is_nothrow_invocable_v<F> &&
+           std::is_nothrow_constructible_v<T, std::invoke_result_t<F>>;
+}();
+
+} // namespace cppmatch_detail
+
+/**
+ * @brief Returns the success value from a Result, or one built by @p factory.
+ *
+ * The factory runs only when the Result holds an error, so an expensive
+ * default costs nothing on the success path. It is called with the error if
+ * it accepts one, and with no arguments otherwise. An rvalue Result has its
+ * value, or the error passed to the factory, moved out.
+ *
+ * @param result The Result to extract from.
+ * @param factory Callable returning something convertible to the success type.
+ * @return The success value or the factory's value.
+ */
+template <typename R, typename F>
+  requires cppmatch_detail::is_result_v<R>
+constexpr auto default_expect_with(R &&result, F &&factory) noexcept(
+    cppmatch_detail::nothrow_default_expect_with_v<R &&, F &&>) {
+  using T = std::remove_cvref_t<decltype(std::forward<R>(result).value_unchecked())>;
+  if (is_ok(result)) [[likely]]
+    return T(std::forward<R>(result).value_unchecked());
+  if constexpr (std::is_invocable_v<F, decltype(std::forward<R>(result).error_unchecked())>)
+    return T(std::invoke(std::forward<F>(factory), std::forward<R>(result).error_unchecked()));
+  else
+    return T(std::invoke(std::forward<F>(factory)));
+}
+
+namespace cppmatch_detail {
+
+struct transform_tag {};
+struct and_then_tag {};
+struct transform_error_tag {};
+struct or_else_tag {};
+
+/**
+ * @brief One combinator waiting for the Result it applies to.
+ *
+ * @tparam Tag Which combinator.
+ * @tparam F The function it applies.
+ */
+template <typename Tag, typename F> struct pipeline_step {
+  using tag = Tag;
+  [[no_unique_address]] F f;
+};
+
+/**
+ * @brief The value and error a step hands on, as the expressions it passes them as.
+ *
+ * V and E are the argument types the step receives; the step's own function F
+ * determines what follows.
+ */
+template <typename Step, typename V, typename E> struct step_types;
+
+template <typename F, typename V, typename E>
+struct step_types<pipeline_step<transform_tag, F>, V, E> {
+  using value = std::invoke_result_t<F, V>;
+  using error = E;
+};
+
+template <typename F, typename V, typename E>
+struct step_types<pipeline_step<and_then_tag, F>, V, E> {
+  using next = std::remove_cvref_t<std::invoke_result_t<F, V>>;
+  static_assert(is_result_v<next>, "and_then: the function must return a Result");
+  using value = decltype(std::declval<next>().value_unchecked());
+  using error = decltype(std::declval<next>().error_unchecked());
+  static_assert(std::is_constructible_v<std::remove_cvref_t<error>, E>,
+                "and_then: the function's error type must be constructible from "
+                "the incoming error");
+};
+
+template <typename F, typename V, typename E>
+struct step_types<pipeline_step<transform_error_tag, F>, V, E> {
+  using value = V;
+  using error = std::invoke_result_t<F, E>;
+};
+
+template <typename F, typename V, typename E>
+struct step_types<pipeline_step<or_else_tag, F>, V, E> {
+  using next = std::remove_cvref_t<std::invoke_result_t<F, E>>;
+  static_assert(is_result_v<next>, "or_else: the function must return a Result");
+  using value = decltype(std::declval<next>().value_unchecked());
+  using error = decltype(std::declval<next>().error_unchecked());
+  static_assert(std::is_constructible_v<std::remove_cvref_t<value>, V>,
+                "or_else: the function's value type must be constructible from "
+                "the incoming value");
+};
+
+/// The types after the first I steps of Steps, a std::tuple.
+template <std::size_t I, typename V, typename E, typename Steps> struct pipeline_types_at {
+  using prev = pipeline_types_at<I - 1, V, E, Steps>;
+  using step = step_types<std::tuple_element_t<I - 1, Steps>, typename prev::value,
+                          typename prev::error>;
+  using value = typename step::value;
+  using error = typename step::error;
+};
+
+template <typename V, typename E, typename Steps>
+struct pipeline_types_at<0, V, E, Steps> {
+  using value = V;
+  using error = E;
+};
+
+/// Whether pass_as<Target>(X) does not throw.
+template <typename Target, typename X>
+inline constexpr bool nothrow_pass_as_v =
+    std::is_same_v<std::remove_cvref_t<Target>, std::remove_cvref_t<X>> ||
+    std::is_nothrow_constructible_v<std::remove_cvref_t<Target>, X>;
+
+/// Whether the step applies its function to the value (as opposed to the error).
+template <typename Tag>
+inline constexpr bool is_value_step_v =
+    std::is_same_v<Tag, transform_tag> || std::is_same_v<Tag, and_then_tag>;
+
+/// Passes @p x on as Target, converting only when the types differ.
+template <typename Target, typename X> constexpr decltype(auto) pass_as(X &&x) noexcept(
+    nothrow_pass_as_v<Target, X &&>) {
+  if constexpr (std::is_same_v<std::remove_cvref_t<Target>, std::remove_cvref_t<X>>)
+    return std::forward<X>(x);
+  else
+    return std::remove_cvref_t<Target>(std::forward<X>(x));
+}
+
+/**
+ * @brief A Result followed by combinators, evaluated as one.
+ *
+ * Evaluation tests the source's tag once and then follows either the value
+ * or the error through the steps, calling each function directly on the
+ * payload. Only the final Result is materialized, plus whatever Results the
+ * functions of and_then and or_else return themselves.
+ *
+ * An lvalue source is referred to, and must outlive the pipeline; an rvalue
+ * source is moved into it, so a chain built on a temporary may be stored and
+ * evaluated later. Evaluation consumes the pipeline.
+ *
+ * @tparam R The source Result: an lvalue reference, or a Result held by value.
+ * @tparam Steps The pipeline_step types, in order.
+ */
+template <typename R, typename... Steps> class [[nodiscard]] result_pipeline {
+  using steps_tuple = std::tuple<Steps...>;
+  using source_value = decltype(std::declval<R>().value_unchecked());
+  using source_error = decltype(std::declval<R>().error_unchecked());
+  template <std::size_t I>
+  using types_at = pipeline_types_at<I, source_value, source_error, steps_tuple>;
+  static constexpr std::size_t size = sizeof...(Steps);
+
+public:
+  using result_type = Result<std::remove_cvref_t<typename types_at<size>::value>,
+                             std::remove_cvref_t<typename types_at<size>::error>>;
+
+  constexpr result_pipeline(R &&source, steps_tuple steps) noexcept(
+      std::is_nothrow_constructible_v<R, R &&> &&
+      std::is_nothrow_move_constructible_v<steps_tuple>)
+      : source_(std::forward<R>(source)), steps_(std::move(steps)) {}
+
+  /// True when no function, conversion or construction along either path can throw.
+  static constexpr bool nothrow = [] {
+    auto step_nothrow = []<std::size_t I>(std::integral_constant<std::size_t, I>) {
+      using step = std::tuple_element_t<I, steps_tuple>;
+      using F = decltype(step::f);
+      using V = typename types_at<I>::value;
+      using Er = typename types_at<I>::error;
+      using next = types_at<I + 1>;
+      if constexpr (is_value_step_v<typename step::tag>)
+        return std::is_nothrow_invocable_v<F, V> &&
+               nothrow_pass_as_v<typename next::error, Er>;
+      else
+        return std::is_nothrow_invocable_v<F, Er> &&
+               nothrow_pass_as_v<typename next::value, V>;
+    };
+    return [&]<std::size_t... I>(std::index_sequence<I...>) {
+      return (step_nothrow(std::integral_constant<std::size_t, I>{}) && ...) &&
+             std::is_nothrow_constructible_v<typename result_type::value_type,
+                                             typename types_at<size>::value> &&
+             std::is_nothrow_constructible_v<typename result_type::error_type,
+                                             typename types_at<size>::error>;
+    }(std::make_index_sequence<size>{});
+  }();
+
+  /// Runs the chain and returns its Result.
+  constexpr result_type evaluate() && noexcept(nothrow) {
+    if (is_ok(source_))
+      return on_value<0>(std::forward<R>(source_).value_unchecked());
+    return on_error<0>(std::forward<R>(source_).error_unchecked());
+  }
+
+  constexpr operator result_type() && noexcept(nothrow) { return std::move(*this).evaluate(); }
+
+  template <typename Tag, typename F>
+  friend constexpr result_pipeline<R, Steps..., pipeline_step<Tag, F>>
+  operator|(result_pipeline &&p, pipeline_step<Tag, F> step) noexcept(
+      std::is_nothrow_constructible_v<R, R &&> &&
+      std::is_nothrow_move_constructible_v<steps_tuple> &&
+      std::is_nothrow_move_constructible_v<F>) {
+    return {std::forward<R>(p.source_),
+            std::tuple_cat(std::move(p.steps_), std::tuple(std::move(step)))};
+  }
+
+private:
+  template <std::size_t I, typename V> constexpr result_type on_value(V &&v) noexcept(nothrow) {
+    if constexpr (I == size) {
+      return result_type(std::in_place_index<0>, std::forward<V>(v));
+    } else {
+      using step = std::tuple_element_t<I, steps_tuple>;
+      [[maybe_unused]] auto &f = std::get<I>(steps_).f;
+      if constexpr (std::is_same_v<typename step::tag, transform_tag>) {
+        return on_value<I + 1>(std::invoke(std::move(f), std::forward<V>(v)));
+      } else if constexpr (std::is_same_v<typename step::tag, and_then_tag>) {
+        auto next = std::invoke(std::move(f), std::forward<V>(v));
+        if (is_ok(next))
+          return on_value<I + 1>(std::move(next).value_unchecked());
+        return on_error<I + 1>(std::move(next).error_unchecked());
+      } else {
+        return on_value<I + 1>(
+            pass_as<typename types_at<I + 1>::value>(std::forward<V>(v)));
+      }
+    }
+  }
+
+  template <std::size_t I, typename Err> constexpr result_type on_error(Err &&e) noexcept(nothrow) {
+    if constexpr (I == size) {
+      return result_type(std::in_place_index<1>, std::forward<Err>(e));
+    } else {
+      using step = std::tuple_element_t<I, steps_tuple>;
+      [[maybe_unused]] auto &f = std::get<I>(steps_).f;
+      if constexpr (std::is_same_v<typename step::tag, transform_error_tag>) {
+        return on_error<I + 1>(std::invoke(std::move(f), std::forward<Err>(e)));
+      } else if constexpr (std::is_same_v<typename step::tag, or_else_tag>) {
+        auto next = std::invoke(std::move(f), std::forward<Err>(e));
+        if (is_ok(next))
+          return on_value<I + 1>(std::move(next).value_unchecked());
+        return on_error<I + 1>(std::move(next).error_unchecked());
+      } else {
+        return on_error<I + 1>(
+            pass_as<typename types_at<I + 1>::error>(std::forward<Err>(e)));
+      }
+    }
+  }
+
+  R source_;
+  steps_tuple steps_;
+};
+
+} // namespace cppmatch_detail
+
+/**
+ * @brief Starts a combinator chain on a Result: r | transform(f) | and_then(g).
+ *
+ * Nothing runs until the chain is converted to a Result or matched; it then
+ * runs with a single tag test. An lvalue source is referred to; an rvalue
+ * source is moved into the chain, and its payload into the functions.
+ */
+template <typename R, typename Tag, typename F>
+  requires cppmatch_detail::is_result_v<R>
+constexpr cppmatch_detail::result_pipeline<R, cppmatch_detail::pipeline_step<Tag, F>>
+operator|(R &&result, cppmatch_detail::pipeline_step<Tag, F> step) noexcept(
+    std::is_nothrow_constructible_v<R, R &&> && std::is_nothrow_move_constructible_v<F>) {
+  return {std::forward<R>(result), std::tuple(std::move(step))};
+}
+
+/**
+ * @brief Maps the success value with @p f, a function of T returning U.
+ *
+ * Yields Result<U, E>; an error passes through unchanged.
+ */
+template <typename F>
+constexpr cppmatch_detail::pipeline_step<cppmatch_detail::transform_tag, std::decay_t<F>>
+transform(F &&f) noexcept(std::is_nothrow_constructible_v<std::decay_t<F>, F>) {
+  return {std::forward<F>(f)};
+}
+
+/**
+ * @brief Continues with @p f, a function of T returning Result<U, E2>.
+ *
+ * Yields Result<U, E2>. An incoming error is converted into E2, so E2 must
+ * be constructible from E; with Error types, any wider Error qualifies.
+ */
+template <typename F>
+constexpr cppmatch_detail::pipeline_step<cppmatch_detail::and_then_tag, std::decay_t<F>>
+and_then(F &&f) noexcept(std::is_nothrow_constructible_v<std::decay_t<F>, F>) {
+  return {std::forward<F>(f)};
+}
+
+/**
+ * @brief Maps the error with @p f, a function of E returning E2.
+ *
+ * Yields Result<T, E2>; a success value passes through unchanged. @p f
+ * receives the whole E, not the flattened alternative.
+ */
+template <typename F>
+constexpr cppmatch_detail::pipeline_step<cppmatch_detail::transform_error_tag,
+                                         std::decay_t<F>>
+transform_error(F &&f) noexcept(std::is_nothrow_constructible_v<std::decay_t<F>, F>) {
+  return {std::forward<F>(f)};
+}
+
+/**
+ * @brief Recovers with @p f, a function of E returning Result<T2, E2>.
+ *
+ * Yields Result<T2, E2>; an incoming success value is converted into T2.
+ */
+template <typename F>
+constexpr cppmatch_detail::pipeline_step<cppmatch_detail::or_else_tag, std::decay_t<F>>
+or_else(F &&f) noexcept(std::is_nothrow_constructible_v<std::decay_t<F>, F>) {
+  return {std::forward<F>(f)};
+}
+
+namespace cppmatch_detail {
+
+/// E itself if it already is a Contextual, Contextual<E> otherwise.
+template <typename E>
+using contextual_t = std::conditional_t<is_contextual_v<E>, std::decay_t<E>,
+                                        Contextual<std::decay_t<E>>>;
+
+/// The error function of with_context: wraps the error and pushes a frame.
+template <typename Ctx> struct context_adder {
+  [[no_unique_address]] Ctx ctx;
+
+  template <typename E> constexpr contextual_t<E> operator()(E &&error) const {
+    contextual_t<E> out(std::forward<E>(error));
+    out.context.push(std::string_view(context_text(ctx)));
+    return out;
+  }
+};
+
+} // namespace cppmatch_detail
+
+/**
+ * @brief Adds a context frame to the error with @p ctx, called only on error.
  *
- * @tparam T The success type.
- * @tparam E The error type.
- * @param result The Result to extract from.
- * @param default_value The default value to return if the Result holds an error.
- * @return The success value or the default value.
+ * Yields Result<T, Contextual<E>>, or keeps E if it already is a Contextual.
+ * @p ctx returns something convertible to std::string_view, or is such a
+ * string itself; see expect_ctx.
  */
-template <typename T, typename E>
-constexpr T default_expect(const Result<T, E> &result, T &&default_value) {
-  return std::holds_alternative<T>(result) ? std::get<T>(result)
-                                           : default_value;
+template <typename Ctx>
+constexpr cppmatch_detail::pipeline_step<cppmatch_detail::transform_error_tag,
+                                         cppmatch_detail::context_adder<std::decay_t<Ctx>>>
+with_context(Ctx &&ctx) noexcept(std::is_nothrow_constructible_v<std::decay_t<Ctx>, Ctx>) {
+  return {{std::forward<Ctx>(ctx)}};
+}
+
+/// Applies transform(f) to @p result at once.
+template <typename R, typename F>
+  requires cppmatch_detail::is_result_v<R>
+constexpr auto transform(R &&result, F &&f) noexcept(
+    noexcept((std::forward<R>(result) | transform(std::forward<F>(f))).evaluate())) {
+  return (std::forward<R>(result) | transform(std::forward<F>(f))).evaluate();
+}
+
+/// Applies and_then(f) to @p result at once.
+template <typename R, typename F>
+  requires cppmatch_detail::is_result_v<R>
+constexpr auto and_then(R &&result, F &&f) noexcept(
+    noexcept((std::forward<R>(result) | and_then(std::forward<F>(f))).evaluate())) {
+  return (std::forward<R>(result) | and_then(std::forward<F>(f))).evaluate();
+}
+
+/// Applies transform_error(f) to @p result at once.
+template <typename R, typename F>
+  requires cppmatch_detail::is_result_v<R>
+constexpr auto transform_error(R &&result, F &&f) noexcept(
+    noexcept((std::forward<R>(result) | transform_error(std::forward<F>(f))).evaluate())) {
+  return (std::forward<R>(result) | transform_error(std::forward<F>(f))).evaluate();
+}
+
+/// Applies or_else(f) to @p result at once.
+template <typename R, typename F>
+  requires cppmatch_detail::is_result_v<R>
+constexpr auto or_else(R &&result, F &&f) noexcept(
+    noexcept((std::forward<R>(result) | or_else(std::forward<F>(f))).evaluate())) {
+  return (std::forward<R>(result) | or_else(std::forward<F>(f))).evaluate();
+}
+
+/// Applies with_context(ctx) to @p result at once.
+template <typename R, typename Ctx>
+  requires cppmatch_detail::is_result_v<R>
+constexpr auto with_context(R &&result, Ctx &&ctx) noexcept(
+    noexcept((std::forward<R>(result) | with_context(std::forward<Ctx>(ctx))).evaluate())) {
+  return (std::forward<R>(result) | with_context(std::forward<Ctx>(ctx))).evaluate();
 }
 
 /**
  * @brief Transforms the error value in a Result.
  *
- * This function applies a transformation function to the error value of a Result,
- * returning a new Result with the transformed error type.
+ * Same as transform_error(result, f). An rvalue Result has its value moved
+ * into the new Result rather than copied.
  *
- * @tparam T The success type.
- * @tparam E1 The original error type.
+ * @tparam R The Result type.
  * @tparam F The function type for transforming the error.
  * @param result The original Result.
  * @param f The transformation function.
  * @return A new Result with the error transformed.
  */
-template <typename T, typename E1, typename F>
-constexpr auto map_error(const Result<T, E1> &result, F &&f) {
-  using E2 = std::invoke_result_t<F, const E1 &>;
-  return match(
-      result,
-      [](const T &val) {
-        return Result<T, E2>(std::in_place_index_t<0>{}, val);
-      },
-      [&](const E1 &err) {
-        return Result<T, E2>(std::in_place_index_t<1>{}, f(err));
-      });
+template <typename R, typename F>
+  requires cppmatch_detail::is_result_v<R>
+constexpr auto map_error(R &&result, F &&f) noexcept(
+    noexcept(transform_error(std::forward<R>(result), std::forward<F>(f)))) {
+  return transform_error(std::forward<R>(result), std::forward<F>(f));
 }
 
 } // namespace cppmatch
@@ -331,6 +3265,10 @@ template <typename T> struct FlattenErrorVariant {
   using type = T;
 };
 
+/// Specialization for Result, flattened like the equivalent std::variant.
+template <typename T, typename E>
+struct FlattenErrorVariant<Result<T, E>> : FlattenErrorVariant<std::variant<T, E>> {};
+
 /// Specialization for std::variant types.
 template <typename T, typename... Ts>
 struct FlattenErrorVariant<std::variant<T, Ts...>> {
@@ -354,28 +3292,125 @@ public:
 template <typename T>
 using FlattenErrorVariant_t = typename FlattenErrorVariant<T>::type;
 
+namespace cppmatch_detail {
+
+/**
+ * @brief Gives every type a unique address usable as a cheap runtime type id.
+ *
+ * @tparam T The type to identify.
+ */
+template <typename T> struct type_tag {
+  static constexpr char id = 0;
+};
+
+/**
+ * @brief Common base of the exceptions thrown by expect_e.
+ *
+ * It carries the type id of the innermost error alternative and a pointer to
+ * it, so match_e can catch every propagated error with a single handler and
+ * then dispatch on the alternative directly.
+ */
+class propagated_exception_base {
+public:
+  virtual ~propagated_exception_base() = default;
+
+  /// Address of type_tag<Leaf>::id for the held error type.
+  virtual const void *type() const noexcept = 0;
+
+  /// Pointer to the held error.
+  virtual const void *payload() const noexcept = 0;
+};
+
+/// Whether expect_e can wrap Leaf in a propagated_exception that derives from it.
+template <typename Leaf>
+inline constexpr bool wrappable_leaf_v = std::is_class_v<Leaf> && !std::is_final_v<Leaf>;
+
+/**
+ * @brief The exception thrown by expect_e for an error of type Leaf.
+ *
+ * It derives from Leaf, so a plain catch (const Leaf &) still catches the
+ * propagated error. Leaf types that cannot be derived from are thrown as
+ * themselves instead.
+ *
+ * @tparam Leaf The innermost error type, a class that is not final.
+ */
+template <typename Leaf>
+class propagated_exception : public propagated_exception_base, public Leaf {
+public:
+  template <typename U>
+  explicit propagated_exception(U &&u) : Leaf(std::forward<U>(u)) {}
+
+  const void *type() const noexcept override { return &type_tag<Leaf>::id; }
+  const void *payload() const noexcept override {
+    return static_cast<const Leaf *>(this);
+  }
+};
+
+/**
+ * @brief Finds the flattened alternative of ResultType that a propagated exception holds.
+ *
+ * @param err The caught exception.
+ * @return The index into flat_leaves_t<ResultType>, or the number of leaves if none matches.
+ */
+template <typename ResultType>
+std::size_t propagated_leaf_index(const propagated_exception_base &err) noexcept {
+  return []<typename... Ls>(leaf_list<Ls...>, const void *type) {
+    constexpr const void *ids[] = {&type_tag<typename Ls::type>::id...};
+    std::size_t i = 0;
+    while (i < sizeof...(Ls) && ids[i] != type)
+      ++i;
+    return i;
+  }(flat_leaves_t<ResultType>{}, err.type());
+}
+
+} // namespace cppmatch_detail
+
 /**
  * @brief Unwraps a Result or throws an exception if an error is present.
  *
  * This function is used in exception-enabled environments to extract the success value
- * from a Result. If the Result contains an error, the error is thrown.
+ * from a Result. If the Result contains an error, the innermost error is thrown wrapped
+ * in a propagated_exception, which match_e handles with a single catch and which can
+ * still be caught directly as the error. Errors that cannot be derived from (non-class
+ * and final types) are thrown as themselves, and match_e tries a catch clause per
+ * alternative for them. An rvalue Result has its value, or its error, moved out rather
+ * than copied.
+ *
+ * With CPPMATCH_INSTRUMENT, the propagation is counted against the caller's
+ * source location.
  *
  * @tparam T The success type.
  * @param v The Result to unwrap.
  * @return The success value.
  * @throws The error contained in the Result.
  */
+#if defined(CPPMATCH_INSTRUMENT)
+template <typename Variant>
+constexpr auto expect_e(Variant &&v,
+                        std::source_location where = std::source_location::current()) {
+  if (cppmatch::is_err(v)) {
+    cppmatch_detail::record_propagation_at<propagation_kind::expect_e>(
+        v.error_unchecked(), where);
+#else
 template <typename Variant> constexpr auto expect_e(Variant &&v) {
   if (cppmatch::is_err(v)) {
-    match(std::get<1>(v), [](auto &&err) -> void { throw err; });
+#endif
+    match(std::forward<Variant>(v).error_unchecked(), [](auto &&err) -> void {
+      using Leaf = std::decay_t<decltype(err)>;
+      if constexpr (cppmatch_detail::wrappable_leaf_v<Leaf>)
+        throw cppmatch_detail::propagated_exception<Leaf>(std::forward<decltype(err)>(err));
+      else
+        throw Leaf(std::forward<decltype(err)>(err));
+    });
   }
-  return std::get<0>(v);
+  return std::forward<Variant>(v).value_unchecked();
 }
 
 /**
  * @brief Helper function to handle exceptions by matching them to an error type.
  *
  * This function attempts to rethrow and catch an exception pointer as one of the expected error types.
+ * It is only used for exceptions that were not thrown by expect_e.
  *
  * @tparam ErrorType The variant type of error.
  * @tparam I The current index within the variant.
@@ -410,6 +3445,11 @@ constexpr auto handle_exception_index(std::exception_ptr eptr,
  *
  * This function calls the provided expression that returns a Result. If an exception is thrown,
  * it will attempt to handle the exception by matching it against the expected error types.
+ * Errors propagated by expect_e are caught once and dispatched on their alternative index.
+ * Any other exception, including the non-class and final errors expect_e throws as
+ * themselves, and a propagated error whose type is not itself listed (one derived from
+ * a listed alternative, say, or a type whose id differs across shared libraries), falls
+ * back to trying each alternative in turn with a catch clause.
  *
  * @tparam Expr The expression type that returns a Result.
  * @tparam Lambdas The lambda functions to handle each alternative.
@@ -419,11 +3459,21 @@ constexpr auto handle_exception_index(std::exception_ptr eptr,
 template <typename Expr, typename... Lambdas>
 constexpr auto dynamic_match(Expr &&expr, Lambdas &&...lambdas) {
   using ResultType = std::invoke_result_t<Expr>;
-  using SuccessType = std::variant_alternative_t<0, ResultType>;
-  using ErrorType = std::variant_alternative_t<1, ResultType>;
 
   try {
     return match(std::forward<Expr>(expr)(), std::forward<Lambdas>(lambdas)...);
+  } catch (const cppmatch_detail::propagated_exception_base &err) {
+    using Leaves = cppmatch_detail::flat_leaves_t<ResultType>;
+    const std::size_t index = cppmatch_detail::propagated_leaf_index<ResultType>(err);
+    if (index == Leaves::size)
+      return handle_exception_index<FlattenErrorVariant_t<ResultType>, 0>(
+          std::current_exception(), std::forward<Lambdas>(lambdas)...);
+    return cppmatch_detail::dispatch_index<Leaves::size>(index, [&](auto k) {
+      using Leaf = typename cppmatch_detail::leaf_at_index<decltype(k)::value, Leaves>::type::type;
+      return cppmatch_detail::flat_visit(
+          *static_cast<const Leaf *>(err.payload()),
+          cppmatch_detail::overloaded{std::forward<Lambdas>(lambdas)...});
+    });
   } catch (...) {
     std::exception_ptr eptr = std::current_exception();
     return handle_exception_index<FlattenErrorVariant_t<ResultType>, 0>(
@@ -454,46 +3504,681 @@ namespace cppmatch {
 namespace cppmatch_ranges {
 
 /**
- * @brief Function object to extract success values from a range of Results.
+ * @brief True when viewing the range must hand out its elements by value.
+ *
+ * Lvalue ranges and views over someone else's storage yield references into
+ * that storage. Owning rvalue ranges, and ranges whose elements are not
+ * lvalues, yield values moved out of the element.
+ */
+template <typename R>
+inline constexpr bool moves_elements_v =
+    !(std::is_lvalue_reference_v<std::ranges::range_reference_t<R>> &&
+      (std::is_lvalue_reference_v<R> ||
+       std::ranges::view<std::remove_cvref_t<R>>));
+
+/**
+ * @brief Projects one side of a Result, as a reference or moved out by value.
+ *
+ * @tparam Side 0 for the success value, 1 for the error.
+ * @tparam Move Whether the side is moved out instead of referenced.
+ */
+template <std::size_t Side, bool Move> struct side_projection {
+  template <typename Res> constexpr decltype(auto) operator()(Res &&res) const {
+    if constexpr (Move) {
+      using Value = std::remove_cvref_t<decltype(get<Side>(res))>;
+      if constexpr (Side == 0)
+        return Value(std::move(res).value_unchecked());
+      else
+        return Value(std::move(res).error_unchecked());
+    } else if constexpr (Side == 0) {
+      return (res.value_unchecked());
+    } else {
+      return (res.error_unchecked());
+    }
+  }
+};
+
+/**
+ * @brief Function object to extract one side from a range of Results.
+ *
+ * This functor filters a range of Result variants to those holding the
+ * requested side, then transforms the range to extract it. Lvalue ranges yield
+ * references to the stored values; owning rvalue ranges move each value out.
  *
- * This functor filters a range of Result variants to only those that are successful,
- * then transforms the range to extract the underlying success values.
+ * @tparam Side 0 for success values, 1 for errors.
  */
-struct successes_fn {
+template <std::size_t Side> struct side_fn {
   /**
-   * @brief Overloads the pipe operator to apply the success filter and transformation.
+   * @brief Overloads the pipe operator to apply the filter and transformation.
    *
-   * @tparam R A range type where each element is a Result with exactly two alternatives.
+   * @tparam R A range type where each element is a Result.
    * @param range The input range.
-   * @return A transformed range containing only the success values.
+   * @return A transformed range containing only the requested side.
    */
   template <std::ranges::range R>
-  friend auto operator|(R &&range, const successes_fn &self) {
-    using VariantType = std::ranges::range_value_t<R>;
-    static_assert(std::variant_size_v<VariantType> == 2,
-                  "Variants must have exactly two alternatives");
+  friend auto operator|(R &&range, const side_fn &self) {
+    using ResultType = std::ranges::range_value_t<R>;
+    static_assert(cppmatch_detail::is_result_v<ResultType>,
+                  "Range elements must be Results");
 
     return std::forward<R>(range) |
-           std::views::filter([](const auto &res) { return is_ok(res); }) |
-           std::views::transform(
-               [](const auto &res) { return std::get<0>(res); });
+           std::views::filter(
+               [](const auto &res) { return res.index() == Side; }) |
+           std::views::transform(side_projection<Side, moves_elements_v<R>>{});
   }
 
   /**
-   * @brief Function call operator to apply the successes view.
+   * @brief Function call operator to apply the view.
    *
    * @tparam R A range type.
    * @param range The input range.
-   * @return A range containing only the success values.
+   * @return A range containing only the requested side.
    */
   template <std::ranges::range R>
   auto operator()(R &&range) const {
-    return range | *this;
+    return std::forward<R>(range) | *this;
+  }
+};
+
+/**
+ * @brief Function object collecting a range of Results into all values or the
+ * first error.
+ *
+ * Iteration stops at the first error, so the rest of a lazy range is never
+ * evaluated. Sized inputs reserve the output once, and values are moved out of
+ * owning rvalue ranges.
+ */
+struct collect_fn {
+  /**
+   * @brief Collects into a new std::vector.
+   *
+   * @tparam R A range type where each element is a Result<T, E>.
+   * @param range The input range.
+   * @return Result<std::vector<T>, E> holding every value, or the first error.
+   */
+  template <std::ranges::input_range R>
+  constexpr auto operator()(R &&range) const {
+    using ResultType = std::ranges::range_value_t<R>;
+    static_assert(cppmatch_detail::is_result_v<ResultType>,
+                  "Range elements must be Results");
+    return (*this)(std::forward<R>(range),
+                   std::vector<typename ResultType::value_type>{});
+  }
+
+  /**
+   * @brief Collects by appending to a caller-provided container.
+   *
+   * The container is taken by value and handed back on success, so a buffer
+   * moved in keeps its capacity across calls. Values are appended through
+   * push_back.
+   *
+   * @tparam R A range type where each element is a Result<T, E>.
+   * @tparam C The output container type.
+   * @param range The input range.
+   * @param out The container to append to.
+   * @return Result<C, E> holding the filled container, or the first error.
+   */
+  template <std::ranges::input_range R, typename C>
+  constexpr auto operator()(R &&range, C out) const {
+    using ResultType = std::ranges::range_value_t<R>;
+    static_assert(cppmatch_detail::is_result_v<ResultType>,
+                  "Range elements must be Results");
+    using E = typename ResultType::error_type;
+    constexpr bool move = moves_elements_v<R>;
+
+    if constexpr (std::ranges::sized_range<R> &&
+                  requires { out.reserve(out.size()); })
+      out.reserve(out.size() + static_cast<std::size_t>(std::ranges::size(range)));
+
+    for (auto &&res : range) {
+      if (res.index() != 0) [[unlikely]]
+        return Result<C, E>(std::in_place_index<1>,
+                            side_projection<1, move>{}(
+                                std::forward<decltype(res)>(res)));
+      out.push_back(
+          side_projection<0, move>{}(std::forward<decltype(res)>(res)));
+    }
+    return Result<C, E>(std::in_place_index<0>, std::move(out));
+  }
+
+  /**
+   * @brief Overloads the pipe operator to collect into a std::vector.
+   */
+  template <std::ranges::input_range R>
+  friend constexpr auto operator|(R &&range, const collect_fn &self) {
+    return self(std::forward<R>(range));
+  }
+};
+
+/**
+ * @brief Hands one error to a try_transform sink.
+ *
+ * An integer sink counts the errors, a container with push_back collects
+ * them, and anything else is invoked with the error (for example to push into
+ * a bounded queue or to log and drop it).
+ */
+template <typename Sink, typename Err> constexpr void sink_error(Sink &sink, Err &&err) {
+  if constexpr (std::is_integral_v<Sink>)
+    ++sink;
+  else if constexpr (requires { sink.push_back(std::forward<Err>(err)); })
+    sink.push_back(std::forward<Err>(err));
+  else
+    std::invoke(sink, std::forward<Err>(err));
+}
+
+/**
+ * @brief Holds a function object or sink in a view, keeping the view assignable.
+ *
+ * Lambdas with captures have no assignment operator, which std::ranges::view
+ * requires; assignment here rebuilds the held object instead.
+ */
+template <typename T> class assignable_box {
+public:
+  constexpr explicit assignable_box(T value) : value_(std::move(value)) {}
+  constexpr assignable_box(const assignable_box &) = default;
+  constexpr assignable_box(assignable_box &&) = default;
+
+  constexpr assignable_box &operator=(const assignable_box &other) {
+    if (this != &other)
+      value_.emplace(*other.value_);
+    return *this;
+  }
+  constexpr assignable_box &operator=(assignable_box &&other) noexcept(
+      std::is_nothrow_move_constructible_v<T>) {
+    if (this != &other)
+      value_.emplace(std::move(*other.value_));
+    return *this;
+  }
+
+  constexpr T &operator*() noexcept { return *value_; }
+
+private:
+  std::optional<T> value_;
+};
+
+/**
+ * @brief A lazy view applying a Result-returning function to each element.
+ *
+ * Yields the success values only; every error goes to the sink as soon as it
+ * is produced, so no intermediate range of Results is ever built. It is an
+ * input view, traversed once: each element is transformed once, when the
+ * iterator reaches it, and the value is cached in the view until the next
+ * increment. Calling begin() again resumes where the pass stands.
+ *
+ * @tparam V The underlying view, for example lines of a mapped file.
+ * @tparam F The function, taking an element of V and returning a Result.
+ * @tparam Sink The error sink (see sink_error), held by reference when it was
+ * passed as an lvalue.
+ */
+template <std::ranges::input_range V, typename F, typename Sink>
+  requires std::ranges::view<V>
+class try_transform_view : public std::ranges::view_interface<try_transform_view<V, F, Sink>> {
+  using result_type =
+      std::remove_cvref_t<std::invoke_result_t<F &, std::ranges::range_reference_t<V>>>;
+  static_assert(cppmatch_detail::is_result_v<result_type>,
+                "try_transform needs a function returning a Result");
+  using value_type = std::remove_cvref_t<typename result_type::value_type>;
+
+public:
+  class iterator {
+  public:
+    using iterator_concept = std::input_iterator_tag;
+    using value_type = try_transform_view::value_type;
+    using difference_type = std::ptrdiff_t;
+
+    iterator() = default;
+    constexpr explicit iterator(try_transform_view *parent) noexcept : parent_(parent) {}
+
+    constexpr value_type &operator*() const noexcept { return *parent_->value_; }
+    constexpr value_type *operator->() const noexcept { return std::addressof(*parent_->value_); }
+
+    constexpr iterator &operator++() {
+      ++*parent_->current_;
+      parent_->satisfy();
+      return *this;
+    }
+    constexpr void operator++(int) { ++*this; }
+
+    friend constexpr bool operator==(const iterator &it, std::default_sentinel_t) {
+      return it.at_end();
+    }
+
+  private:
+    constexpr bool at_end() const { return *parent_->current_ == std::ranges::end(parent_->base_); }
+
+    try_transform_view *parent_ = nullptr;
+  };
+
+  constexpr try_transform_view(V base, F f, Sink sink)
+      : base_(std::move(base)), f_(std::move(f)), sink_(std::move(sink)) {}
+
+  /// Starts the single pass on the first call. Later calls resume at the
+  /// current element, so no element is transformed, nor error sunk, twice.
+  constexpr iterator begin() {
+    if (!current_) {
+      current_.emplace(std::ranges::begin(base_));
+      satisfy();
+    }
+    return iterator(this);
+  }
+  constexpr std::default_sentinel_t end() const noexcept { return {}; }
+
+  constexpr V base() const & { return base_; }
+
+private:
+  // Advances to the next element whose Result holds a value, sinking errors.
+  constexpr void satisfy() {
+    auto &current = *current_;
+    for (; current != std::ranges::end(base_); ++current) {
+      auto &&res = std::invoke(*f_, *current);
+      if (is_ok(res)) [[likely]] {
+        value_.emplace(std::move(res).value_unchecked());
+        return;
+      }
+      sink_error(unwrap(*sink_), std::move(res).error_unchecked());
+    }
+  }
+
+  template <typename S> static constexpr S &unwrap(S &s) noexcept { return s; }
+  template <typename S> static constexpr S &unwrap(std::reference_wrapper<S> s) noexcept {
+    return s.get();
+  }
+
+  V base_;
+  assignable_box<F> f_;
+  assignable_box<Sink> sink_;
+  // Empty until the pass starts, so the iterator need not be default constructible.
+  std::optional<std::ranges::iterator_t<V>> current_;
+  std::optional<value_type> value_;
+};
+
+/// The pipeable closure returned by try_transform(f, sink).
+template <typename F, typename Sink> struct try_transform_closure {
+  F f;
+  Sink sink;
+
+  template <std::ranges::viewable_range R>
+  friend constexpr auto operator|(R &&range, try_transform_closure self) {
+    return try_transform_view<std::views::all_t<R>, F, Sink>(
+        std::views::all(std::forward<R>(range)), std::move(self.f), std::move(self.sink));
   }
 };
 
+/// Extracts the success values of a range of Results.
+using successes_fn = side_fn<0>;
+
+/// Extracts the errors of a range of Results.
+using errors_fn = side_fn<1>;
+
 } // namespace cppmatch_ranges
 
 /// An inline constant instance of successes_fn for easy use with ranges.
 inline constexpr cppmatch_ranges::successes_fn successes{};
+
+/// Range adaptors over Results, named after the part of each Result they view.
+namespace views {
+
+/// The success values of a range of Results; the same object as cppmatch::successes.
+inline constexpr const cppmatch_ranges::successes_fn &successes = cppmatch::successes;
+
+/// The errors of a range of Results.
+inline constexpr cppmatch_ranges::errors_fn errors{};
+
+} // namespace views
+
+/// An inline constant instance of collect_fn for easy use with ranges.
+inline constexpr cppmatch_ranges::collect_fn collect_results{};
+
+/**
+ * @brief Lazily parses a range with a Result-returning function, keeping the successes.
+ *
+ * range | try_transform(f, sink) calls f on each element as it is reached and
+ * yields the success values. Errors go to @p sink: an integer counts them,
+ * a container is appended to, and a callable is invoked with each one. A sink
+ * passed as an lvalue is referenced, so the caller reads it afterwards.
+ *
+ * @param f Function from an element to a Result.
+ * @param sink Where the errors go.
+ * @return A closure to pipe a range into.
+ */
+template <typename F, typename Sink>
+constexpr auto try_transform(F &&f, Sink &&sink) {
+  using held_sink = std::conditional_t<std::is_lvalue_reference_v<Sink>,
+                                       std::reference_wrapper<std::remove_reference_t<Sink>>,
+                                       std::decay_t<Sink>>;
+  return cppmatch_ranges::try_transform_closure<std::decay_t<F>, held_sink>{
+      std::forward<F>(f), held_sink(std::forward<Sink>(sink))};
+}
+
+/**
+ * @brief Splits a range of Results into success values and errors in one pass.
+ *
+ * Success values are appended to @p ok_out and errors to @p err_out, both
+ * through push_back. Elements are moved out when the range owns them
+ * (an rvalue container) and copied otherwise. When the range is sized, both
+ * outputs are reserved up front: @p err_out for @p expected_errors elements
+ * and @p ok_out for the rest.
+ *
+ * @param range The input range of Results.
+ * @param ok_out Container receiving the success values.
+ * @param err_out Container receiving the errors.
+ * @param expected_errors Reserve hint for the number of errors.
+ */
+template <std::ranges::input_range R, typename OkOut, typename ErrOut>
+constexpr void partition_results(R &&range, OkOut &ok_out, ErrOut &err_out,
+                                 std::size_t expected_errors = 0) {
+  static_assert(cppmatch_detail::is_result_v<std::ranges::range_value_t<R>>,
+                "Range elements must be Results");
+  constexpr bool move = cppmatch_ranges::moves_elements_v<R>;
+
+  if constexpr (std::ranges::sized_range<R>) {
+    const auto n = static_cast<std::size_t>(std::ranges::size(range));
+    const auto errs = expected_errors < n ? expected_errors : n;
+    if constexpr (requires { ok_out.reserve(n); })
+      ok_out.reserve(ok_out.size() + (n - errs));
+    if constexpr (requires { err_out.reserve(n); })
+      err_out.reserve(err_out.size() + errs);
+  }
+
+  for (auto &&res : range) {
+    if (res.index() == 0)
+      ok_out.push_back(cppmatch_ranges::side_projection<0, move>{}(
+          std::forward<decltype(res)>(res)));
+    else
+      err_out.push_back(cppmatch_ranges::side_projection<1, move>{}(
+          std::forward<decltype(res)>(res)));
+  }
+}
+
+namespace cppmatch_detail {
+
+template <typename T, typename E> struct result_layout<Result<T, E>> {
+  /// Byte offset of the tag inside a Result. The same for every object.
+  static std::size_t tag_offset(const Result<T, E> &r) noexcept {
+    return static_cast<std::size_t>(
+        reinterpret_cast<const unsigned char *>(std::addressof(r.has_error_)) -
+        reinterpret_cast<const unsigned char *>(std::addressof(r)));
+  }
+
+#if defined(__AVX2__)
+  /// Whether 8 tags can be gathered as the aligned 32-bit words holding them.
+  static constexpr bool gatherable = !packed_result_traits<T, E>::enabled &&
+                                     alignof(Result<T, E>) >= 4 &&
+                                     sizeof(Result<T, E>) * 8 <= 0x7fffffff;
+
+  /**
+   * @brief Gathers the tags of 64 Results with AVX2.
+   *
+   * Each lane loads the aligned 32-bit word containing one tag. Because the
+   * Result is at least 4-byte aligned, that word never leaves the object.
+   */
+  static std::uint64_t error_bits_avx2(const Result<T, E> *p) noexcept {
+    const std::size_t tag = tag_offset(*p);
+    const __m256i offsets = _mm256_add_epi32(
+        _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                           _mm256_set1_epi32(sizeof(Result<T, E>))),
+        _mm256_set1_epi32(static_cast<int>(tag & ~std::size_t{3})));
+    const __m256i tag_byte =
+        _mm256_set1_epi32(static_cast<int>(0xffu << ((tag & 3) * 8)));
+
+    std::uint64_t bits = 0;
+    for (int j = 0; j < 8; ++j) {
+      const __m256i words = _mm256_i32gather_epi32(
+          reinterpret_cast<const int *>(p + 8 * j), offsets, 1);
+      const __m256i ok = _mm256_cmpeq_epi32(_mm256_and_si256(words, tag_byte),
+                                            _mm256_setzero_si256());
+      const auto lanes = static_cast<unsigned>(
+          _mm256_movemask_ps(_mm256_castsi256_ps(ok)));
+      bits |= static_cast<std::uint64_t>(~lanes & 0xffu) << (8 * j);
+    }
+    return bits;
+  }
+#endif
+};
+
+/**
+ * @brief Packs the error status of up to 64 consecutive Results into a word.
+ *
+ * Bit k is set when p[k] holds an error. When compiled with AVX2, full blocks
+ * gather the tags eight at a time; otherwise this is a branchless scalar loop.
+ */
+template <typename T, typename E>
+constexpr std::uint64_t error_bits(const Result<T, E> *p,
+                                   std::size_t count) noexcept {
+#if defined(__AVX2__)
+  if constexpr (result_layout<Result<T, E>>::gatherable) {
+    if (count == 64 && !std::is_constant_evaluated())
+      return result_layout<Result<T, E>>::error_bits_avx2(p);
+  }
+#endif
+  std::uint64_t bits = 0;
+  for (std::size_t k = 0; k < count; ++k)
+    bits |= static_cast<std::uint64_t>(p[k].index()) << k;
+  return bits;
+}
+
+/// Calls @p f with the error bits of each block of 64 Results, in order.
+/// Stops early when @p f returns true.
+template <typename T, typename E, typename F>
+constexpr void for_each_error_block(std::span<const Result<T, E>> results,
+                                    F &&f) {
+  const std::size_t n = results.size();
+  std::size_t i = 0;
+  for (; i + 64 <= n; i += 64)
+    if (f(i, error_bits(results.data() + i, 64)))
+      return;
+  if (i < n)
+    f(i, error_bits(results.data() + i, n - i));
+}
+
+/// True when error_bits() reads the tags of Result type R with vector gathers.
+template <typename R>
+inline constexpr bool gathers_tags_v =
+#if defined(__AVX2__)
+    result_layout<R>::gatherable;
+#else
+    false;
+#endif
+
+template <typename R>
+concept contiguous_results =
+    std::ranges::contiguous_range<R> && std::ranges::sized_range<R> &&
+    is_result_v<std::ranges::range_value_t<R>>;
+
+template <typename R> constexpr auto as_result_span(const R &range) {
+  using ResultType = std::ranges::range_value_t<R>;
+  return std::span<const ResultType>(std::ranges::data(range),
+                                     std::ranges::size(range));
+}
+
+} // namespace cppmatch_detail
+
+/**
+ * @brief Counts the errors in a contiguous range of Results.
+ *
+ * @param results A contiguous range of Results, such as a std::vector or std::span.
+ * @return The number of elements holding an error.
+ */
+template <cppmatch_detail::contiguous_results R>
+constexpr std::size_t count_errors(const R &results) {
+  std::size_t count = 0;
+  if constexpr (!cppmatch_detail::gathers_tags_v<std::ranges::range_value_t<R>>) {
+    // Without gathers a plain sum of the tags vectorizes better than packing bits.
+    for (const auto &res : results)
+      count += res.index();
+    return count;
+  }
+  cppmatch_detail::for_each_error_block(
+      cppmatch_detail::as_result_span(results),
+      [&](std::size_t, std::uint64_t bits) {
+        count += static_cast<std::size_t>(std::popcount(bits));
+        return false;
+      });
+  return count;
+}
+
+/**
+ * @brief Finds the first error in a contiguous range of Results.
+ *
+ * @param results A contiguous range of Results.
+ * @return The index of the first error, or the size of the range if there is none.
+ */
+template <cppmatch_detail::contiguous_results R>
+constexpr std::size_t find_first_error(const R &results) {
+  std::size_t found = std::ranges::size(results);
+  cppmatch_detail::for_each_error_block(
+      cppmatch_detail::as_result_span(results),
+      [&](std::size_t base, std::uint64_t bits) {
+        if (bits == 0)
+          return false;
+        found = base + static_cast<std::size_t>(std::countr_zero(bits));
+        return true;
+      });
+  return found;
+}
+
+/**
+ * @brief Writes a bitmask of the errors in a contiguous range of Results.
+ *
+ * Bit i % 64 of out_bits[i / 64] is set when element i holds an error; the
+ * unused high bits of the last word are cleared.
+ *
+ * @param results A contiguous range of Results.
+ * @param out_bits Destination with at least (size + 63) / 64 words.
+ */
+template <cppmatch_detail::contiguous_results R>
+constexpr void error_mask(const R &results, std::span<std::uint64_t> out_bits) {
+  assert(out_bits.size() >= (std::ranges::size(results) + 63) / 64 &&
+         "error_mask: out_bits is too short for the results");
+  cppmatch_detail::for_each_error_block(
+      cppmatch_detail::as_result_span(results),
+      [&](std::size_t base, std::uint64_t bits) {
+        out_bits[base / 64] = bits;
+        return false;
+      });
+}
+
+/// match_each mode handling the elements one by one, in range order.
+struct in_order_t {
+  explicit in_order_t() = default;
+};
+inline constexpr in_order_t in_order{};
+
+/// match_each mode grouping the elements by alternative before handling them.
+struct bucketed_t {
+  explicit bucketed_t() = default;
+};
+inline constexpr bucketed_t bucketed{};
+
+namespace cppmatch_detail {
+
+/// The visitor match() would build from the same handlers.
+template <typename... Lambdas>
+constexpr auto each_visitor(Lambdas &&...lambdas) {
+  if constexpr (sizeof...(Lambdas) > 0 && (is_pattern_arm_v<Lambdas> && ...))
+    return pattern_visitor(std::forward<Lambdas>(lambdas)...);
+  else
+    return overloaded{std::forward<Lambdas>(lambdas)...};
+}
+
+/// An element of R as match_each hands it to the visitor.
+template <typename R, typename Ref>
+constexpr decltype(auto) each_element(Ref &&element) {
+  if constexpr (cppmatch_ranges::moves_elements_v<R>)
+    return std::move(element);
+  else
+    return std::forward<Ref>(element);
+}
+
+/**
+ * @brief Runs the handlers of each alternative over the elements holding it.
+ *
+ * The flattened leaf index of every element is stored, a stable counting sort
+ * of the positions groups them by index, and then each alternative's handler
+ * is called in its own loop with the leaf already known at compile time.
+ *
+ * @tparam Pos The position type, wide enough for the size of the range.
+ */
+template <typename Pos, typename R, typename It, typename Visitor>
+void match_each_bucketed(It first, std::size_t n, Visitor &vis) {
+  using Leaves = flat_leaves_t<std::ranges::range_value_t<R>>;
+  constexpr std::size_t leaves = Leaves::size;
+  using Tag = std::conditional_t<(leaves <= 256), std::uint8_t, std::uint16_t>;
+  static_assert(leaves <= 65536, "match_each: too many alternatives to bucket");
+
+  std::vector<Tag> tags(n);
+  std::array<std::size_t, leaves + 1> start{};
+  for (std::size_t i = 0; i < n; ++i) {
+    tags[i] = static_cast<Tag>(leaf_index(first[i]));
+    ++start[tags[i] + 1];
+  }
+  for (std::size_t k = 0; k < leaves; ++k)
+    start[k + 1] += start[k];
+
+  std::vector<Pos> order(n);
+  auto next = start;
+  for (std::size_t i = 0; i < n; ++i)
+    order[next[tags[i]]++] = static_cast<Pos>(i);
+
+  [&]<std::size_t... K>(std::index_sequence<K...>) {
+    (
+        [&] {
+          using Path = typename leaf_at_index<K, Leaves>::type::path;
+          for (std::size_t j = start[K]; j < start[K + 1]; ++j)
+            vis(leaf_get(Path{}, each_element<R>(first[order[j]])));
+        }(),
+        ...);
+  }(std::make_index_sequence<leaves>{});
+}
+
+} // namespace cppmatch_detail
+
+/**
+ * @brief Matches every element of a range, in order.
+ *
+ * Equivalent to calling match(element, lambdas...) for each element, with
+ * the handlers combined once. Elements are moved when the range owns them.
+ * The handlers' return values are discarded.
+ *
+ * @param range A range of Results, Errors or variants.
+ * @param lambdas The handlers, or pattern arms, as for match.
+ */
+template <std::ranges::input_range R, typename... Lambdas>
+constexpr void match_each(R &&range, Lambdas &&...lambdas) {
+  auto vis = cppmatch_detail::each_visitor(std::forward<Lambdas>(lambdas)...);
+  for (auto &&element : range)
+    cppmatch_detail::flat_visit(
+        cppmatch_detail::each_element<R>(std::forward<decltype(element)>(element)), vis);
+}
+
+/// @copydoc match_each(R &&, Lambdas &&...)
+template <std::ranges::input_range R, typename... Lambdas>
+constexpr void match_each(in_order_t, R &&range, Lambdas &&...lambdas) {
+  match_each(std::forward<R>(range), std::forward<Lambdas>(lambdas)...);
+}
+
+/**
+ * @brief Matches every element of a range, grouped by alternative.
+ *
+ * All elements holding the first alternative are handled, in range order,
+ * then all holding the second, and so on. Each group is a loop calling one
+ * handler, so the per-element indirect branch of match becomes a predictable
+ * loop branch. This costs one pass to record the alternatives, one to sort
+ * the positions, and a byte plus a position of scratch memory per element.
+ * It pays off on long, mixed streams whose handlers do not depend on the
+ * order between alternatives.
+ *
+ * @param range A sized random-access range of Results, Errors or variants.
+ * @param lambdas The handlers, or pattern arms, as for match.
+ */
+template <std::ranges::random_access_range R, typename... Lambdas>
+  requires std::ranges::sized_range<R>
+void match_each(bucketed_t, R &&range, Lambdas &&...lambdas) {
+  auto vis = cppmatch_detail::each_visitor(std::forward<Lambdas>(lambdas)...);
+  const auto n = static_cast<std::size_t>(std::ranges::size(range));
+  if (n <= std::numeric_limits<std::uint32_t>::max())
+    cppmatch_detail::match_each_bucketed<std::uint32_t, R>(std::ranges::begin(range), n, vis);
+  else
+    cppmatch_detail::match_each_bucketed<std::size_t, R>(std::ranges::begin(range), n, vis);
+}
 } // namespace cppmatch
@@ -0,0 +1,367 @@
+#pragma once
+/*
+MIT License
+
+Copyright (c) 2025 Ruben Cano Diaz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Error payloads allocated from a per-thread arena that is reset per request.
+//
+// With CPPMATCH_ARENA_CHECKS, allocating outside any guard asserts, and each
+// arena_string records the guard it was made under and asserts, when its text
+// is read on the thread that made it, that the guard is still alive.
+
+#include "match.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <new>
+#include <span>
+#include <string_view>
+
+namespace cppmatch {
+
+namespace cppmatch_detail {
+
+/**
+ * @brief A per-thread bump allocator over chunks that are kept for reuse.
+ *
+ * Memory is handed out by moving a pointer and given back only by rewinding
+ * to a mark, which is what an error_arena does when it goes out of scope.
+ * Rewound chunks go to a spare list instead of the allocator, so once a
+ * thread has seen its largest error burst, error paths never call malloc.
+ */
+class error_arena_state {
+  static constexpr std::size_t chunk_bytes = 16 * 1024;
+
+  struct chunk {
+    chunk *prev;
+    std::size_t capacity;
+  };
+  static constexpr std::size_t header =
+      (sizeof(chunk) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+
+  static std::byte *data(chunk *c) noexcept { return reinterpret_cast<std::byte *>(c) + header; }
+
+public:
+  /// A position to rewind to.
+  struct mark {
+    chunk *current;
+    std::byte *top;
+  };
+
+  /// The calling thread's arena. Trivially destructible, so reaching it is a
+  /// plain thread-local access; the chunks are released at thread exit.
+  static error_arena_state &local() noexcept {
+    constinit thread_local error_arena_state state;
+    return state;
+  }
+
+  void *allocate(std::size_t n, std::size_t align) {
+#if defined(CPPMATCH_ARENA_CHECKS)
+    assert(depth > 0 && "error_arena: allocation outside any guard");
+#endif
+    auto p = reinterpret_cast<std::uintptr_t>(top_);
+    auto aligned = (p + align - 1) & ~(std::uintptr_t(align) - 1);
+    if (!top_ || aligned + n > reinterpret_cast<std::uintptr_t>(limit_)) [[unlikely]] {
+      push_chunk(n + align);
+      p = reinterpret_cast<std::uintptr_t>(top_);
+      aligned = (p + align - 1) & ~(std::uintptr_t(align) - 1);
+    }
+    top_ = reinterpret_cast<std::byte *>(aligned + n);
+    return reinterpret_cast<void *>(aligned);
+  }
+
+  /// The unused bytes of the current chunk, to format into before committing.
+  std::span<char> tail() noexcept {
+#if defined(CPPMATCH_ARENA_CHECKS)
+    assert(depth > 0 && "error_arena: allocation outside any guard");
+#endif
+    return {reinterpret_cast<char *>(top_), static_cast<std::size_t>(limit_ - top_)};
+  }
+  void commit(std::size_t n) noexcept { top_ += n; }
+
+  mark position() const noexcept { return {current_, top_}; }
+
+  void rewind(mark m) noexcept {
+    // Rewinding to before the first chunk keeps that chunk, emptied, so the
+    // next request starts with space instead of a trip through push_chunk.
+    chunk *keep = m.current;
+    while (current_ != keep && !(!keep && !current_->prev)) {
+      chunk *c = current_;
+      current_ = c->prev;
+      c->prev = spare_;
+      spare_ = c;
+    }
+    top_ = keep ? m.top : current_ ? data(current_) : nullptr;
+    limit_ = current_ ? data(current_) + current_->capacity : nullptr;
+  }
+
+  /// Bytes held by this thread's arena, in use or spare.
+  std::size_t reserved() const noexcept {
+    std::size_t total = 0;
+    for (chunk *c = current_; c; c = c->prev)
+      total += c->capacity;
+    for (chunk *c = spare_; c; c = c->prev)
+      total += c->capacity;
+    return total;
+  }
+
+  int depth = 0;
+
+  /// Called by a guard when it is created and destroyed.
+  void enter() noexcept {
+    ++depth;
+#if defined(CPPMATCH_ARENA_CHECKS)
+    if (depth < checked_depth)
+      live_[depth] = ++serial_;
+#endif
+  }
+  void leave() noexcept {
+#if defined(CPPMATCH_ARENA_CHECKS)
+    if (depth < checked_depth)
+      live_[depth] = 0;
+#endif
+    --depth;
+  }
+
+#if defined(CPPMATCH_ARENA_CHECKS)
+  /// Guards nested deeper than this are not told apart from their parent.
+  static constexpr int checked_depth = 64;
+
+  /// Identifies the innermost guard alive now: its depth and its serial.
+  std::uint64_t stamp() const noexcept {
+    const int d = depth < checked_depth ? depth : checked_depth - 1;
+    return live_[d] << 8 | static_cast<std::uint64_t>(d);
+  }
+
+  /// Whether the guard @p s was taken under is still alive.
+  bool live(std::uint64_t s) const noexcept {
+    const int d = static_cast<int>(s & 0xff);
+    return d <= depth && live_[d] == s >> 8;
+  }
+#endif
+
+private:
+  struct releaser {
+    error_arena_state *state;
+    ~releaser() { state->release(); }
+  };
+
+  void release() noexcept {
+    for (chunk **list : {&current_, &spare_}) {
+      while (*list) {
+        chunk *prev = (*list)->prev;
+        ::operator delete(*list);
+        *list = prev;
+      }
+    }
+    top_ = limit_ = nullptr;
+  }
+
+  [[gnu::noinline]] void push_chunk(std::size_t n) {
+    if (!current_ && !spare_) {
+      thread_local releaser at_exit{this};
+      (void)at_exit;
+    }
+    // Reuse the first spare chunk that is large enough.
+    chunk **link = &spare_;
+    while (*link && (*link)->capacity < n)
+      link = &(*link)->prev;
+    chunk *c = *link;
+    if (c) {
+      *link = c->prev;
+    } else {
+      std::size_t capacity = n > chunk_bytes - header ? n : chunk_bytes - header;
+      c = static_cast<chunk *>(::operator new(header + capacity));
+      c->capacity = capacity;
+    }
+    c->prev = current_;
+    current_ = c;
+    top_ = data(c);
+    limit_ = top_ + c->capacity;
+  }
+
+  chunk *current_ = nullptr;
+  chunk *spare_ = nullptr;
+  std::byte *top_ = nullptr;
+  std::byte *limit_ = nullptr;
+#if defined(CPPMATCH_ARENA_CHECKS)
+  // live_[d] is the serial of the guard alive at depth d, 0 when there is none.
+  std::uint64_t serial_ = 0;
+  std::uint64_t live_[checked_depth] = {};
+#endif
+};
+
+} // namespace cppmatch_detail
+
+/**
+ * @brief Scopes the error payloads allocated on this thread.
+ *
+ * Create one per request (or per batch): every arena_string made on this
+ * thread while it is alive is allocated from the thread's arena, and all of
+ * them are released together when it is destroyed. Guards nest; an inner one
+ * releases only what was allocated after it. Nothing here takes a lock.
+ *
+ * Payloads must not outlive the guard that was innermost when they were
+ * made. Outside any guard, allocations are kept until the thread exits;
+ * CPPMATCH_ARENA_CHECKS turns both mistakes into failed asserts.
+ */
+class error_arena {
+public:
+  error_arena() noexcept : mark_(cppmatch_detail::error_arena_state::local().position()) {
+    cppmatch_detail::error_arena_state::local().enter();
+  }
+  error_arena(const error_arena &) = delete;
+  error_arena &operator=(const error_arena &) = delete;
+  ~error_arena() {
+    auto &state = cppmatch_detail::error_arena_state::local();
+    state.rewind(mark_);
+    state.leave();
+  }
+
+  /// Allocates @p n bytes from the calling thread's arena.
+  static void *allocate(std::size_t n, std::size_t align = alignof(std::max_align_t)) {
+    return cppmatch_detail::error_arena_state::local().allocate(n, align);
+  }
+
+  /// Whether a guard is alive on the calling thread.
+  static bool active() noexcept { return cppmatch_detail::error_arena_state::local().depth > 0; }
+
+  /// Bytes the calling thread's arena holds, including chunks kept for reuse.
+  static std::size_t reserved_bytes() noexcept {
+    return cppmatch_detail::error_arena_state::local().reserved();
+  }
+
+private:
+  cppmatch_detail::error_arena_state::mark mark_;
+};
+
+/**
+ * @brief An error message stored in the thread's error arena.
+ *
+ * It is a pointer and a length, trivially copyable: widening an Error that
+ * holds one, propagating it with expect and matching it copy those two words
+ * and never the text, so a payload stays in the arena it was made in. With
+ * CPPMATCH_ARENA_CHECKS it also carries the stamp of its guard.
+ */
+class arena_string {
+public:
+  constexpr arena_string() = default;
+
+  /// Copies @p text into the arena.
+  explicit arena_string(std::string_view text)
+      : data_(copy(text)), size_(text.size()) {
+#if defined(CPPMATCH_ARENA_CHECKS)
+    owner_ = &cppmatch_detail::error_arena_state::local();
+    stamp_ = owner_->stamp();
+#endif
+  }
+
+  /**
+   * @brief Formats straight into the arena.
+   *
+   * The text is written into the free space of the current chunk, and only
+   * formatted a second time, into a fresh chunk, when it does not fit.
+   */
+  template <typename... Args>
+  static arena_string format(std::format_string<const Args &...> fmt, const Args &...args) {
+    auto &state = cppmatch_detail::error_arena_state::local();
+    auto tail = state.tail();
+    arena_string s;
+    s.size_ = static_cast<std::size_t>(
+        std::format_to_n(tail.data(), static_cast<std::ptrdiff_t>(tail.size()), fmt, args...).size);
+    if (s.size_ <= tail.size()) [[likely]] {
+      state.commit(s.size_);
+      s.data_ = tail.data();
+    } else {
+      char *dst = static_cast<char *>(state.allocate(s.size_, 1));
+      std::format_to(dst, fmt, args...);
+      s.data_ = dst;
+    }
+#if defined(CPPMATCH_ARENA_CHECKS)
+    s.owner_ = &state;
+    s.stamp_ = state.stamp();
+#endif
+    return s;
+  }
+
+  constexpr std::string_view view() const noexcept { return {data(), size_}; }
+  constexpr operator std::string_view() const noexcept { return view(); }
+  constexpr const char *data() const noexcept {
+#if defined(CPPMATCH_ARENA_CHECKS)
+    assert((!data_ || owner_ != &cppmatch_detail::error_arena_state::local() ||
+            owner_->live(stamp_)) &&
+           "arena_string: read after its error_arena was destroyed");
+#endif
+    return data_;
+  }
+  constexpr std::size_t size() const noexcept { return size_; }
+  constexpr bool empty() const noexcept { return size_ == 0; }
+
+  friend constexpr bool operator==(const arena_string &a, std::string_view b) noexcept {
+    return a.view() == b;
+  }
+
+private:
+  static const char *copy(std::string_view text) {
+    if (text.empty())
+      return nullptr;
+    char *dst = static_cast<char *>(error_arena::allocate(text.size(), 1));
+    std::memcpy(dst, text.data(), text.size());
+    return dst;
+  }
+
+  const char *data_ = nullptr;
+  std::size_t size_ = 0;
+#if defined(CPPMATCH_ARENA_CHECKS)
+  const cppmatch_detail::error_arena_state *owner_ = nullptr;
+  std::uint64_t stamp_ = 0;
+#endif
+};
+
+/**
+ * @brief A standard allocator over the thread's error arena.
+ *
+ * For error payloads that need a container, e.g.
+ * std::vector<Frame, arena_allocator<Frame>>. Deallocation does nothing; the
+ * memory comes back when the enclosing error_arena is destroyed.
+ */
+template <typename T> struct arena_allocator {
+  using value_type = T;
+
+  arena_allocator() = default;
+  template <typename U> constexpr arena_allocator(const arena_allocator<U> &) noexcept {}
+
+  T *allocate(std::size_t n) {
+    return static_cast<T *>(error_arena::allocate(n * sizeof(T), alignof(T)));
+  }
+  void deallocate(T *, std::size_t) noexcept {}
+
+  friend constexpr bool operator==(const arena_allocator &, const arena_allocator &) noexcept {
+    return true;
+  }
+};
+
+} // namespace cppmatch
@@ -0,0 +1,613 @@
+#pragma once
+/*
+MIT License
+
+Copyright (c) 2025 Ruben Cano Diaz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Asynchronous Result-returning tasks. Kept out of match.hpp so that including
+// the core library does not pull in <coroutine> and <thread>.
+
+#include "match.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+namespace cppmatch {
+
+template <typename R> class Task;
+class work_stealing_executor;
+
+namespace cppmatch_detail {
+
+/**
+ * @brief A cancellation flag, also raised when any enclosing flag is.
+ *
+ * Tasks check it each time they await another task or reschedule, so a
+ * cancelled task stops at its next suspension point.
+ */
+struct cancellation_state {
+  std::atomic<bool> requested{false};
+  const cancellation_state *parent = nullptr;
+
+  void request() noexcept { requested.store(true, std::memory_order_relaxed); }
+
+  bool stop_requested() const noexcept {
+    for (const cancellation_state *c = this; c; c = c->parent)
+      if (c->requested.load(std::memory_order_relaxed))
+        return true;
+    return false;
+  }
+};
+
+/**
+ * @brief The part of a Task's promise that does not depend on its Result.
+ *
+ * A task ends in one of three ways: with a Result, with an exception, or
+ * cancelled with neither. Whoever started the task installs on_finish, which
+ * inspects the outcome and returns the coroutine to run next.
+ */
+struct task_promise_base {
+  using finish_fn = std::coroutine_handle<> (*)(void *) noexcept;
+
+  finish_fn on_finish = nullptr;
+  void *finish_ctx = nullptr;
+  const cancellation_state *cancel = nullptr;
+  work_stealing_executor *executor = nullptr;
+#if defined(_CPPUNWIND) || defined(__EXCEPTIONS) || defined(__cpp_exceptions)
+  std::exception_ptr exception;
+#endif
+
+  bool cancelled() const noexcept { return cancel && cancel->stop_requested(); }
+  std::coroutine_handle<> finish() noexcept { return on_finish(finish_ctx); }
+
+  struct final_awaiter {
+    bool await_ready() const noexcept { return false; }
+    template <typename P>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept {
+      return h.promise().finish();
+    }
+    void await_resume() const noexcept {}
+  };
+
+  std::suspend_always initial_suspend() const noexcept { return {}; }
+  final_awaiter final_suspend() const noexcept { return {}; }
+
+  void unhandled_exception() noexcept {
+#if defined(_CPPUNWIND) || defined(__EXCEPTIONS) || defined(__cpp_exceptions)
+    exception = std::current_exception();
+#else
+    std::terminate();
+#endif
+  }
+};
+
+/// Marks awaitables that a Task awaits as they are, without unwrapping.
+struct task_awaitable {};
+
+/**
+ * @brief What co_await ex.schedule() returns: resumes the task on @p ex.
+ */
+struct schedule_awaiter : task_awaitable {
+  work_stealing_executor *executor;
+
+  bool await_ready() const noexcept { return false; }
+  template <typename P> std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h);
+  void await_resume() const noexcept {}
+};
+
+} // namespace cppmatch_detail
+
+/**
+ * @brief A fixed pool of threads that run coroutines, stealing from each other.
+ *
+ * Each worker owns a queue. Work posted from a worker goes to the back of its
+ * own queue and is taken from there first, which keeps a parent and the
+ * children it just spawned on one warm core. Idle workers steal from the
+ * front of the other queues.
+ *
+ * The executor must outlive every task it runs. Work still queued when it is
+ * destroyed is dropped.
+ */
+class work_stealing_executor {
+public:
+  explicit work_stealing_executor(
+      std::size_t threads = std::max(1u, std::thread::hardware_concurrency()))
+      : count_(std::max<std::size_t>(threads, 1)),
+        queues_(std::make_unique<queue[]>(count_)) {
+    workers_.reserve(count_);
+    for (std::size_t i = 0; i < count_; ++i)
+      workers_.emplace_back([this, i](std::stop_token stop) { run(stop, i); });
+  }
+
+  work_stealing_executor(const work_stealing_executor &) = delete;
+  work_stealing_executor &operator=(const work_stealing_executor &) = delete;
+
+  ~work_stealing_executor() {
+    for (auto &w : workers_)
+      w.request_stop();
+    wake_.notify_all();
+  }
+
+  /// Number of worker threads.
+  std::size_t size() const noexcept { return count_; }
+
+  /// Queues @p h to be resumed on one of the workers.
+  void post(std::coroutine_handle<> h) {
+    const worker_identity &self = current();
+    std::size_t target = self.owner == this
+                             ? self.index
+                             : next_.fetch_add(1, std::memory_order_relaxed) % count_;
+    {
+      std::lock_guard lock(queues_[target].mutex);
+      queues_[target].items.push_back(h);
+    }
+    {
+      std::lock_guard lock(sleep_mutex_);
+      pending_.fetch_add(1, std::memory_order_release);
+    }
+    wake_.notify_one();
+  }
+
+  /**
+   * @brief Awaitable that moves the awaiting Task onto this executor.
+   *
+   * Tasks the rescheduled task then awaits, directly or through
+   * when_all_results, run on this executor as well.
+   */
+  cppmatch_detail::schedule_awaiter schedule() noexcept { return {{}, this}; }
+
+private:
+  struct alignas(64) queue {
+    std::mutex mutex;
+    std::deque<std::coroutine_handle<>> items;
+  };
+
+  struct worker_identity {
+    const work_stealing_executor *owner = nullptr;
+    std::size_t index = 0;
+  };
+
+  static worker_identity &current() noexcept {
+    thread_local worker_identity id;
+    return id;
+  }
+
+  bool try_pop(std::size_t self, std::coroutine_handle<> &out) {
+    {
+      std::lock_guard lock(queues_[self].mutex);
+      if (!queues_[self].items.empty()) {
+        out = queues_[self].items.back();
+        queues_[self].items.pop_back();
+        return true;
+      }
+    }
+    for (std::size_t k = 1; k < count_; ++k) {
+      queue &victim = queues_[(self + k) % count_];
+      std::lock_guard lock(victim.mutex);
+      if (!victim.items.empty()) {
+        out = victim.items.front();
+        victim.items.pop_front();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void run(std::stop_token stop, std::size_t index) {
+    current() = {this, index};
+    while (!stop.stop_requested()) {
+      std::coroutine_handle<> h;
+      if (try_pop(index, h)) {
+        pending_.fetch_sub(1, std::memory_order_relaxed);
+        h.resume();
+        continue;
+      }
+      std::unique_lock lock(sleep_mutex_);
+      wake_.wait(lock, stop, [this] { return pending_.load(std::memory_order_acquire) != 0; });
+    }
+  }
+
+  std::size_t count_;
+  std::unique_ptr<queue[]> queues_;
+  std::atomic<std::size_t> next_{0};
+  std::atomic<std::size_t> pending_{0};
+  std::mutex sleep_mutex_;
+  std::condition_variable_any wake_;
+  // Last, so the workers are joined before the queues go away.
+  std::vector<std::jthread> workers_;
+};
+
+namespace cppmatch_detail {
+
+template <typename P>
+std::coroutine_handle<> schedule_awaiter::await_suspend(std::coroutine_handle<P> h) {
+  auto &promise = h.promise();
+  if (promise.cancelled())
+    return promise.finish();
+  promise.executor = executor;
+  executor->post(h);
+  return std::noop_coroutine();
+}
+
+template <typename T, typename E> class task_promise;
+
+/**
+ * @brief Forwards to an awaiter that stays where it was created.
+ *
+ * Some compilers copy the awaiter returned by await_transform into the
+ * coroutine frame; this keeps non-copyable awaiters such as
+ * when_all_awaiter in place.
+ */
+template <typename A> struct awaitable_ref {
+  A &awaiter;
+
+  bool await_ready() const noexcept { return awaiter.await_ready(); }
+  template <typename P> decltype(auto) await_suspend(std::coroutine_handle<P> h) {
+    return awaiter.await_suspend(h);
+  }
+  decltype(auto) await_resume() { return awaiter.await_resume(); }
+};
+
+/**
+ * @brief co_await on a Result inside a Task: the value, or the task ends with the error.
+ *
+ * @tparam R Reference to the awaited Result.
+ * @tparam P The awaiting task's promise.
+ */
+template <typename R, typename P> struct task_result_awaiter {
+  R &&result;
+  P &promise;
+
+  bool await_ready() const noexcept { return is_ok(result); }
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<>) noexcept {
+    promise.fail(std::forward<R>(result).error_unchecked());
+    return promise.finish();
+  }
+  auto await_resume() { return std::forward<R>(result).value_unchecked(); }
+};
+
+/**
+ * @brief co_await on a child Task: runs it, then resumes with its value or propagates.
+ *
+ * The child inherits the parent's executor and cancellation. When it ends
+ * with an error, the error is widened into the parent's Result and the
+ * parent finishes right away, without resuming the code after co_await. A
+ * cancelled or throwing child finishes the parent the same way.
+ */
+template <typename T, typename E, typename P> struct task_awaiter {
+  std::coroutine_handle<task_promise<T, E>> child;
+  std::coroutine_handle<P> parent;
+
+  bool await_ready() const noexcept { return false; }
+
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept {
+    parent = h;
+    P &p = h.promise();
+    if (p.cancelled())
+      return p.finish();
+    task_promise<T, E> &c = child.promise();
+    c.on_finish = &resume_parent;
+    c.finish_ctx = this;
+    c.cancel = p.cancel;
+    c.executor = p.executor;
+    return child;
+  }
+
+  T await_resume() { return std::move(*child.promise().result).value_unchecked(); }
+
+  static std::coroutine_handle<> resume_parent(void *self) noexcept {
+    task_awaiter &a = *static_cast<task_awaiter *>(self);
+    task_promise<T, E> &c = a.child.promise();
+    P &p = a.parent.promise();
+#if defined(_CPPUNWIND) || defined(__EXCEPTIONS) || defined(__cpp_exceptions)
+    if (c.exception) {
+      p.exception = std::move(c.exception);
+      return p.finish();
+    }
+#endif
+    if (!c.result)
+      return p.finish();
+    if (is_err(*c.result)) [[unlikely]] {
+      p.fail(std::move(*c.result).error_unchecked());
+      return p.finish();
+    }
+    return a.parent;
+  }
+};
+
+/**
+ * @brief Promise type of Task<Result<T, E>>.
+ *
+ * Tasks start suspended and run when awaited, passed to when_all_results or
+ * sync_wait. Inside a task, co_await unwraps a Result or a child Task and
+ * ends the task with the error if there is one.
+ */
+template <typename T, typename E> class task_promise : public task_promise_base {
+public:
+  std::optional<Result<T, E>> result;
+
+  Task<Result<T, E>> get_return_object() noexcept;
+
+  template <typename U = Result<T, E>>
+    requires std::is_constructible_v<Result<T, E>, U>
+  void return_value(U &&value) {
+    result.emplace(std::forward<U>(value));
+  }
+
+  template <typename Err> void fail(Err &&error) {
+    result.emplace(std::in_place_index<1>, std::forward<Err>(error));
+  }
+
+  template <typename R>
+    requires is_result_v<std::remove_cvref_t<R>>
+  task_result_awaiter<R, task_promise> await_transform(R &&r) noexcept {
+    return {std::forward<R>(r), *this};
+  }
+
+  template <typename U, typename E2>
+    requires std::is_constructible_v<E, E2>
+  task_awaiter<U, E2, task_promise> await_transform(Task<Result<U, E2>> &&t) noexcept {
+    return {t.handle(), {}};
+  }
+
+  template <typename A>
+    requires std::is_base_of_v<task_awaitable, std::remove_cvref_t<A>>
+  awaitable_ref<std::remove_reference_t<A>> await_transform(A &&a) noexcept {
+    return {a};
+  }
+};
+
+/**
+ * @brief Awaits a set of tasks of the same Result type, started together.
+ *
+ * With an executor every child is posted to it, otherwise each runs inline
+ * until its first suspension. The first child to fail records its error and
+ * cancels the others; the awaiter resumes only once every child has
+ * finished, since their frames live in the awaited vector.
+ */
+template <typename T, typename E> class when_all_awaiter : public task_awaitable {
+public:
+  explicit when_all_awaiter(std::vector<Task<Result<T, E>>> &tasks)
+      : tasks_(tasks), values_(tasks.size()), slots_(tasks.size()) {}
+
+  bool await_ready() const noexcept { return tasks_.empty(); }
+
+  template <typename P> std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) {
+    P &p = h.promise();
+    parent_ = h;
+    parent_promise_ = &p;
+    if (p.cancelled())
+      return p.finish();
+    cancel_.parent = p.cancel;
+    remaining_.store(tasks_.size() + 1, std::memory_order_relaxed);
+    for (std::size_t i = 0; i < tasks_.size(); ++i) {
+      slots_[i] = {this, i};
+      task_promise<T, E> &c = tasks_[i].handle().promise();
+      c.on_finish = &child_done;
+      c.finish_ctx = &slots_[i];
+      c.cancel = &cancel_;
+      c.executor = p.executor;
+    }
+    // Posted last to first: a worker takes its own queue from the back, so
+    // the first child runs first.
+    if (work_stealing_executor *executor = p.executor)
+      for (std::size_t i = tasks_.size(); i-- > 0;)
+        executor->post(tasks_[i].handle());
+    else
+      for (auto &t : tasks_)
+        t.handle().resume();
+    if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      return all_done();
+    return std::noop_coroutine();
+  }
+
+  Result<std::vector<T>, E> await_resume() {
+#if defined(_CPPUNWIND) || defined(__EXCEPTIONS) || defined(__cpp_exceptions)
+    if (exception_)
+      std::rethrow_exception(exception_);
+#endif
+    if (error_)
+      return Result<std::vector<T>, E>(std::in_place_index<1>, std::move(*error_));
+    std::vector<T> out;
+    out.reserve(values_.size());
+    for (auto &v : values_)
+      out.push_back(std::move(*v));
+    return Result<std::vector<T>, E>(std::in_place_index<0>, std::move(out));
+  }
+
+private:
+  struct slot {
+    when_all_awaiter *self;
+    std::size_t index;
+  };
+
+  std::coroutine_handle<> all_done() noexcept {
+    // Cancelled from outside, with children missing: the parent is cancelled too.
+    if (!failed_.load(std::memory_order_acquire) && parent_promise_->cancelled())
+      return parent_promise_->finish();
+    return parent_;
+  }
+
+  /// Records the failure and cancels the siblings, unless another child failed first.
+  template <typename F> void fail_first(F &&record) noexcept {
+    if (!failed_.exchange(true, std::memory_order_acq_rel)) {
+      record();
+      cancel_.request();
+    }
+  }
+
+  static std::coroutine_handle<> child_done(void *ctx) noexcept {
+    slot &s = *static_cast<slot *>(ctx);
+    when_all_awaiter &self = *s.self;
+    task_promise<T, E> &c = self.tasks_[s.index].handle().promise();
+#if defined(_CPPUNWIND) || defined(__EXCEPTIONS) || defined(__cpp_exceptions)
+    if (c.exception)
+      self.fail_first([&] { self.exception_ = c.exception; });
+    else
+#endif
+    if (c.result && is_ok(*c.result))
+      self.values_[s.index].emplace(std::move(*c.result).value_unchecked());
+    else if (c.result)
+      self.fail_first([&] { self.error_.emplace(std::move(*c.result).error_unchecked()); });
+    if (self.remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      return self.all_done();
+    return std::noop_coroutine();
+  }
+
+  std::vector<Task<Result<T, E>>> &tasks_;
+  std::vector<std::optional<T>> values_;
+  std::vector<slot> slots_;
+  std::optional<E> error_;
+#if defined(_CPPUNWIND) || defined(__EXCEPTIONS) || defined(__cpp_exceptions)
+  std::exception_ptr exception_;
+#endif
+  std::atomic<bool> failed_{false};
+  std::atomic<std::size_t> remaining_{0};
+  cancellation_state cancel_;
+  std::coroutine_handle<> parent_;
+  task_promise_base *parent_promise_ = nullptr;
+};
+
+/// Completion of the task driven by sync_wait: wakes the waiting thread.
+struct sync_wait_state {
+  std::mutex mutex;
+  std::condition_variable done_cv;
+  bool done = false;
+
+  static std::coroutine_handle<> complete(void *self) noexcept {
+    auto &s = *static_cast<sync_wait_state *>(self);
+    std::lock_guard lock(s.mutex);
+    s.done = true;
+    s.done_cv.notify_one();
+    return std::noop_coroutine();
+  }
+};
+
+} // namespace cppmatch_detail
+
+/**
+ * @brief A lazily started coroutine producing a Result<T, E>.
+ *
+ * Inside the coroutine, co_await on a Result or on another Task yields its
+ * value; on an error the task ends at once with the error, widened into E as
+ * Error conversions allow, without throwing. The Task owns its frame and is
+ * move-only.
+ *
+ * @tparam T The success type.
+ * @tparam E The error type.
+ */
+template <typename T, typename E> class [[nodiscard]] Task<Result<T, E>> {
+public:
+  using promise_type = cppmatch_detail::task_promise<T, E>;
+  using result_type = Result<T, E>;
+
+  Task(Task &&other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+  Task &operator=(Task &&other) noexcept {
+    if (this != &other) {
+      if (handle_)
+        handle_.destroy();
+      handle_ = std::exchange(other.handle_, {});
+    }
+    return *this;
+  }
+  ~Task() {
+    if (handle_)
+      handle_.destroy();
+  }
+
+  /// The coroutine, still owned by this Task.
+  std::coroutine_handle<promise_type> handle() const noexcept { return handle_; }
+
+private:
+  friend promise_type;
+  explicit Task(std::coroutine_handle<promise_type> h) noexcept : handle_(h) {}
+
+  std::coroutine_handle<promise_type> handle_;
+};
+
+template <typename T, typename E>
+Task<Result<T, E>> cppmatch_detail::task_promise<T, E>::get_return_object() noexcept {
+  return Task<Result<T, E>>(std::coroutine_handle<task_promise>::from_promise(*this));
+}
+
+/**
+ * @brief Runs @p tasks concurrently and collects their values in order.
+ *
+ * The result holds every value, or the error of the first task to fail. That
+ * failure cancels the remaining tasks, which stop at their next co_await.
+ * Children run on the executor of the awaiting task, or inline when it has
+ * none.
+ *
+ * @param tasks The tasks to run; all share one Result type.
+ * @return A Task producing Result<std::vector<T>, E>.
+ */
+template <typename T, typename E>
+Task<Result<std::vector<T>, E>> when_all_results(std::vector<Task<Result<T, E>>> tasks) {
+  co_return co_await cppmatch_detail::when_all_awaiter<T, E>(tasks);
+}
+
+/**
+ * @brief Runs @p task to completion and returns its Result.
+ *
+ * Blocks the calling thread. With an executor the task starts on one of its
+ * workers; otherwise it starts on the calling thread and continues wherever
+ * it reschedules itself. Exceptions escaping the task are rethrown here.
+ */
+template <typename T, typename E>
+Result<T, E> sync_wait(Task<Result<T, E>> task, work_stealing_executor *executor = nullptr) {
+  cppmatch_detail::sync_wait_state state;
+  auto &promise = task.handle().promise();
+  promise.on_finish = &cppmatch_detail::sync_wait_state::complete;
+  promise.finish_ctx = &state;
+  promise.executor = executor;
+  if (executor)
+    executor->post(task.handle());
+  else
+    task.handle().resume();
+  {
+    std::unique_lock lock(state.mutex);
+    state.done_cv.wait(lock, [&] { return state.done; });
+  }
+#if defined(_CPPUNWIND) || defined(__EXCEPTIONS) || defined(__cpp_exceptions)
+  if (promise.exception)
+    std::rethrow_exception(promise.exception);
+#endif
+  return std::move(*promise.result);
+}
+
+/// Runs @p task on @p executor and returns its Result.
+template <typename T, typename E>
+Result<T, E> sync_wait(work_stealing_executor &executor, Task<Result<T, E>> task) {
+  return sync_wait(std::move(task), &executor);
+}
+
+} // namespace cppmatch
@@ -0,0 +1,272 @@
+#pragma once
+/*
+MIT License
+
+Copyright (c) 2025 Ruben Cano Diaz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Result as a coroutine return type: co_await unwraps a Result or returns its
+// error, without statement expressions or exceptions. Kept out of match.hpp so
+// that including the core library does not pull in <coroutine>.
+
+#include "match.hpp"
+
+#include <cassert>
+#include <coroutine>
+#include <cstddef>
+#include <new>
+#include <optional>
+
+namespace cppmatch {
+namespace cppmatch_detail {
+
+/**
+ * @brief A per-thread stack of coroutine frames.
+ *
+ * A Result coroutine never outlives its call: it runs to completion before
+ * returning, and every co_await either continues or ends the coroutine. Frames
+ * are therefore freed in the reverse order of their allocation, and a bump
+ * pointer over chunks of memory replaces a heap allocation per call.
+ */
+class coroutine_frame_stack {
+  static constexpr std::size_t alignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+  static constexpr std::size_t chunk_bytes = 64 * 1024;
+
+  struct chunk {
+    chunk *prev;
+    std::byte *saved_top; ///< Top of prev when this chunk was pushed.
+    std::size_t capacity;
+  };
+  static constexpr std::size_t header = (sizeof(chunk) + alignment - 1) & ~(alignment - 1);
+
+  static constexpr std::size_t round(std::size_t n) noexcept {
+    return (n + alignment - 1) & ~(alignment - 1);
+  }
+  static std::byte *data(chunk *c) noexcept {
+    return reinterpret_cast<std::byte *>(c) + header;
+  }
+
+public:
+  /// The calling thread's stack. Trivially destructible, so reaching it is a
+  /// plain thread-local access; the chunks are released at thread exit.
+  static coroutine_frame_stack &local() noexcept {
+    constinit thread_local coroutine_frame_stack stack;
+    return stack;
+  }
+
+  void *allocate(std::size_t n) {
+    n = round(n);
+    if (static_cast<std::size_t>(limit_ - top_) < n) [[unlikely]]
+      push_chunk(n);
+    void *p = top_;
+    top_ += n;
+    return p;
+  }
+
+  /// Frees @p p, which must be the frame allocated last.
+  void deallocate([[maybe_unused]] void *p, std::size_t n) noexcept {
+    top_ -= round(n);
+    assert(p == top_ && "coroutine_frame_stack: frames freed out of order");
+    if (top_ == data(current_) && current_->prev) [[unlikely]]
+      pop_chunk();
+  }
+
+private:
+  struct releaser {
+    coroutine_frame_stack *stack;
+    ~releaser() { stack->release(); }
+  };
+
+  void release() noexcept {
+    ::operator delete(spare_);
+    while (current_) {
+      chunk *prev = current_->prev;
+      ::operator delete(current_);
+      current_ = prev;
+    }
+    spare_ = nullptr;
+    top_ = limit_ = nullptr;
+  }
+
+  [[gnu::noinline]] void push_chunk(std::size_t n) {
+    if (!current_) {
+      thread_local releaser at_exit{this};
+      (void)at_exit;
+    }
+    chunk *c = spare_;
+    spare_ = nullptr;
+    if (!c || c->capacity < n) {
+      ::operator delete(c);
+      std::size_t capacity = n > chunk_bytes - header ? n : chunk_bytes - header;
+      c = static_cast<chunk *>(::operator new(header + capacity));
+      c->capacity = capacity;
+    }
+    c->prev = current_;
+    c->saved_top = top_;
+    current_ = c;
+    top_ = data(c);
+    limit_ = top_ + c->capacity;
+  }
+
+  [[gnu::noinline]] void pop_chunk() noexcept {
+    chunk *c = current_;
+    current_ = c->prev;
+    top_ = c->saved_top;
+    limit_ = data(current_) + current_->capacity;
+    ::operator delete(spare_);
+    spare_ = c;
+  }
+
+  chunk *current_ = nullptr;
+  chunk *spare_ = nullptr;
+  std::byte *top_ = nullptr;
+  std::byte *limit_ = nullptr;
+};
+
+template <typename T, typename E> class result_promise;
+
+/**
+ * @brief What a Result coroutine hands back to its caller before it runs.
+ *
+ * The promise writes the outcome into this object, and the caller receives
+ * it through the conversion to Result. That relies on the conversion being
+ * applied once the coroutine has returned to its caller, which the standard
+ * leaves unspecified (CWG2563). GCC 12 and later convert at that point, which
+ * the tests check; other compilers are untested, and an early conversion trips
+ * the assert in operator Result.
+ */
+template <typename T, typename E> class result_return_object {
+public:
+  explicit result_return_object(result_promise<T, E> &promise) noexcept
+      : promise_(&promise) {
+    promise.out_ = this;
+  }
+
+  result_return_object(result_return_object &&other) noexcept(
+      std::is_nothrow_move_constructible_v<Result<T, E>>)
+      : promise_(other.promise_), result_(std::move(other.result_)) {
+    // Still running: the promise is alive and must write here instead.
+    if (!result_ && promise_)
+      promise_->out_ = this;
+  }
+
+  operator Result<T, E>() {
+    assert(result_ && "Result coroutine: return object converted before the coroutine returned");
+    return std::move(*result_);
+  }
+
+private:
+  friend class result_promise<T, E>;
+
+  result_promise<T, E> *promise_;
+  std::optional<Result<T, E>> result_;
+};
+
+/**
+ * @brief The awaiter of co_await on a Result inside a Result coroutine.
+ *
+ * Ready when the Result holds a value, which await_resume returns. Otherwise
+ * await_suspend stores the error as the coroutine's result and destroys the
+ * frame, so control goes straight back to the caller.
+ *
+ * @tparam R Reference to the awaited Result.
+ */
+template <typename R> struct result_awaiter {
+  R &&result;
+
+  bool await_ready() const noexcept { return is_ok(result); }
+
+  template <typename Promise> void await_suspend(std::coroutine_handle<Promise> h) {
+    h.promise().fail(std::forward<R>(result).error_unchecked());
+    h.destroy();
+  }
+
+  auto await_resume() { return std::forward<R>(result).value_unchecked(); }
+};
+
+/**
+ * @brief Promise type of coroutines returning Result<T, E>.
+ *
+ * The coroutine starts eagerly and never suspends past its end. Frames come
+ * from the thread's coroutine_frame_stack. co_await accepts Results whose
+ * error converts into E.
+ */
+template <typename T, typename E> class result_promise {
+public:
+  result_return_object<T, E> get_return_object() noexcept {
+    return result_return_object<T, E>(*this);
+  }
+
+  std::suspend_never initial_suspend() const noexcept { return {}; }
+  std::suspend_never final_suspend() const noexcept { return {}; }
+
+  template <typename U = Result<T, E>>
+    requires std::is_constructible_v<Result<T, E>, U>
+  void return_value(U &&value) {
+    out_->result_.emplace(std::forward<U>(value));
+    out_->promise_ = nullptr;
+  }
+
+  template <typename Err> void fail(Err &&error) {
+    out_->result_.emplace(std::in_place_index<1>, std::forward<Err>(error));
+    out_->promise_ = nullptr;
+  }
+
+  void unhandled_exception() {
+#if defined(_CPPUNWIND) || defined(__EXCEPTIONS) || defined(__cpp_exceptions)
+    throw;
+#else
+    std::terminate();
+#endif
+  }
+
+  template <typename R>
+    requires is_result_v<std::remove_cvref_t<R>>
+  result_awaiter<R> await_transform(R &&result) noexcept {
+    return {std::forward<R>(result)};
+  }
+
+  static void *operator new(std::size_t n) {
+    return coroutine_frame_stack::local().allocate(n);
+  }
+  static void operator delete(void *p, std::size_t n) noexcept {
+    coroutine_frame_stack::local().deallocate(p, n);
+  }
+
+private:
+  friend class result_return_object<T, E>;
+
+  result_return_object<T, E> *out_ = nullptr;
+};
+
+} // namespace cppmatch_detail
+} // namespace cppmatch
+
+/**
+ * @brief Makes every function returning Result<T, E> usable as a coroutine.
+ *
+ * Inside such a function, co_await r yields the value of r or returns its
+ * error, and co_return returns a value or an error.
+ */
+template <typename T, typename E, typename... Args>
+struct std::coroutine_traits<cppmatch::Result<T, E>, Args...> {
+  using promise_type = cppmatch::cppmatch_detail::result_promise<T, E>;
+};
@@ -0,0 +1,138 @@
+#pragma once
+/*
+MIT License
+
+Copyright (c) 2025 Ruben Cano Diaz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Error payloads that keep their arguments and format on demand.
+
+#include "match.hpp"
+
+#include <algorithm>
+#include <format>
+#include <string>
+#include <string_view>
+#include <tuple>
+
+namespace cppmatch {
+
+namespace cppmatch_detail {
+
+/// A string literal usable as a template argument.
+template <std::size_t N> struct fixed_string {
+  char data[N]{};
+
+  constexpr fixed_string(const char (&s)[N]) { std::copy_n(s, N, data); }
+
+  constexpr std::string_view view() const { return {data, N - 1}; }
+};
+
+template <std::size_t I, typename T> struct pack_leaf {
+  T value;
+};
+
+/**
+ * @brief Stores values side by side, like a tuple that stays trivially copyable
+ * when its elements are.
+ */
+template <typename Seq, typename... Ts> struct value_pack;
+
+template <std::size_t... I, typename... Ts>
+struct value_pack<std::index_sequence<I...>, Ts...> : pack_leaf<I, Ts>... {
+  constexpr value_pack() = default;
+
+  constexpr explicit value_pack(Ts... values)
+    requires(sizeof...(Ts) > 0)
+      : pack_leaf<I, Ts>{std::move(values)}... {}
+
+  template <std::size_t K> constexpr const auto &get() const noexcept {
+    return static_cast<const pack_leaf<K, std::tuple_element_t<K, std::tuple<Ts...>>> &>(*this)
+        .value;
+  }
+
+  template <typename F> constexpr decltype(auto) apply(F &&f) const {
+    return std::forward<F>(f)(static_cast<const pack_leaf<I, Ts> &>(*this).value...);
+  }
+};
+
+} // namespace cppmatch_detail
+
+/**
+ * @brief An error payload that defers formatting until the message is read.
+ *
+ * The format string is part of the type and the arguments are stored by value
+ * inside the object, so creating, copying and dropping a lazy_error never
+ * allocates or formats. The text is produced only by message() or
+ * format_to(). Arguments that are views (const char*, std::string_view) are
+ * stored as views and must outlive the error.
+ *
+ * Each format string gives a distinct type, usable as an alternative of
+ * Error<...> and matched like any other error type.
+ *
+ * @tparam Fmt The std::format format string.
+ * @tparam Args The stored argument types.
+ */
+template <cppmatch_detail::fixed_string Fmt, typename... Args>
+struct lazy_error {
+  constexpr lazy_error() = default;
+
+  constexpr explicit lazy_error(Args... a)
+    requires(sizeof...(Args) > 0)
+      : args_(std::move(a)...) {}
+
+  /// The format string.
+  static constexpr std::string_view format() noexcept { return Fmt.view(); }
+
+  /// The I-th stored argument.
+  template <std::size_t I> constexpr const auto &arg() const noexcept {
+    return args_.template get<I>();
+  }
+
+  /// Formats the message into @p out and returns the end iterator.
+  template <typename Out> Out format_to(Out out) const {
+    return args_.apply(
+        [&](const Args &...a) { return std::format_to(out, Fmt.view(), a...); });
+  }
+
+  /// Formats the message into a new string.
+  std::string message() const {
+    return args_.apply(
+        [](const Args &...a) { return std::format(Fmt.view(), a...); });
+  }
+
+private:
+  cppmatch_detail::value_pack<std::index_sequence_for<Args...>, Args...> args_;
+};
+
+/**
+ * @brief Creates a lazy_error, deducing the argument types.
+ *
+ * @code
+ * return make_lazy_error<"{} exceeds max_depth">(n);
+ * @endcode
+ */
+template <cppmatch_detail::fixed_string Fmt, typename... Args>
+constexpr lazy_error<Fmt, std::decay_t<Args>...> make_lazy_error(Args &&...args) {
+  return lazy_error<Fmt, std::decay_t<Args>...>(std::forward<Args>(args)...);
+}
+
+} // namespace cppmatch
@@ -0,0 +1,193 @@
+#pragma once
+/*
+MIT License
+
+Copyright (c) 2025 Ruben Cano Diaz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Newline-delimited records as string_views, over memory or a mapped file.
+
+#include "match.hpp"
+
+#include <cstring>
+#include <iterator>
+#include <ranges>
+#include <string_view>
+#include <system_error>
+
+#if __has_include(<sys/mman.h>) && __has_include(<fcntl.h>) && __has_include(<unistd.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define CPPMATCH_HAS_MMAP 1
+#endif
+
+namespace cppmatch {
+
+/**
+ * @brief The lines of a block of text, as string_views into it.
+ *
+ * Lines end at '\n', which is not part of the view; a final line without a
+ * newline is still produced, and an empty text has no lines. Splitting scans
+ * with memchr and never copies, so the text must outlive the view.
+ */
+class line_view : public std::ranges::view_interface<line_view> {
+public:
+  class iterator {
+  public:
+    using iterator_concept = std::forward_iterator_tag;
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::string_view;
+    using difference_type = std::ptrdiff_t;
+
+    iterator() = default;
+
+    constexpr value_type operator*() const noexcept { return {pos_, eol_}; }
+
+    iterator &operator++() noexcept {
+      pos_ = eol_ == end_ ? end_ : eol_ + 1;
+      eol_ = find_eol(pos_, end_);
+      return *this;
+    }
+    iterator operator++(int) noexcept {
+      auto old = *this;
+      ++*this;
+      return old;
+    }
+
+    friend constexpr bool operator==(const iterator &a, const iterator &b) noexcept {
+      return a.pos_ == b.pos_;
+    }
+
+  private:
+    friend class line_view;
+
+    iterator(const char *pos, const char *end) noexcept
+        : pos_(pos), eol_(find_eol(pos, end)), end_(end) {}
+
+    static const char *find_eol(const char *pos, const char *end) noexcept {
+      if (pos == end)
+        return end;
+      auto eol = static_cast<const char *>(std::memchr(pos, '\n', static_cast<std::size_t>(end - pos)));
+      return eol ? eol : end;
+    }
+
+    const char *pos_ = nullptr;
+    const char *eol_ = nullptr;
+    const char *end_ = nullptr;
+  };
+
+  line_view() = default;
+  constexpr explicit line_view(std::string_view text) noexcept : text_(text) {}
+
+  iterator begin() const noexcept { return {text_.data(), text_.data() + text_.size()}; }
+  iterator end() const noexcept {
+    auto e = text_.data() + text_.size();
+    return {e, e};
+  }
+
+  /// The text being split.
+  constexpr std::string_view text() const noexcept { return text_; }
+
+private:
+  std::string_view text_;
+};
+
+/// Splits @p text into lines; see line_view.
+inline line_view lines(std::string_view text) noexcept { return line_view(text); }
+
+#if defined(CPPMATCH_HAS_MMAP)
+/**
+ * @brief A read-only memory mapping of a whole file.
+ *
+ * The file is mapped once and read through the page cache, with sequential
+ * read-ahead requested, so a multi-GB input is parsed without reading it into
+ * a buffer. Move-only; the mapping is released by the destructor.
+ */
+class mapped_file {
+public:
+  mapped_file() = default;
+  mapped_file(const mapped_file &) = delete;
+  mapped_file &operator=(const mapped_file &) = delete;
+  mapped_file(mapped_file &&other) noexcept
+      : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0)) {}
+  mapped_file &operator=(mapped_file &&other) noexcept {
+    if (this != &other) {
+      release();
+      data_ = std::exchange(other.data_, nullptr);
+      size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+  }
+  ~mapped_file() { release(); }
+
+  /**
+   * @brief Maps the file at @p path.
+   *
+   * @return The mapping, or the errno of the failing open, fstat or mmap.
+   */
+  static Result<mapped_file, std::error_code> open(const char *path) {
+    const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+      return std::error_code(errno, std::system_category());
+    mapped_file file;
+    struct stat st{};
+    if (::fstat(fd, &st) != 0) {
+      const int err = errno;
+      ::close(fd);
+      return std::error_code(err, std::system_category());
+    }
+    if (st.st_size > 0) {
+      void *data = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data == MAP_FAILED) {
+        const int err = errno;
+        ::close(fd);
+        return std::error_code(err, std::system_category());
+      }
+      ::madvise(data, static_cast<std::size_t>(st.st_size), MADV_SEQUENTIAL);
+      file.data_ = static_cast<const char *>(data);
+      file.size_ = static_cast<std::size_t>(st.st_size);
+    }
+    ::close(fd);
+    return file;
+  }
+
+  /// The mapped bytes.
+  std::string_view text() const noexcept { return {data_, size_}; }
+
+  /// The lines of the file.
+  line_view lines() const noexcept { return line_view(text()); }
+
+private:
+  void release() noexcept {
+    if (data_)
+      ::munmap(const_cast<char *>(data_), size_);
+  }
+
+  const char *data_ = nullptr;
+  std::size_t size_ = 0;
+};
+#endif
+
+} // namespace cppmatch
+
+template <> inline constexpr bool std::ranges::enable_borrowed_range<cppmatch::line_view> = true;
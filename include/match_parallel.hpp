@@ -0,0 +1,261 @@
+#pragma once
+/*
+MIT License
+
+Copyright (c) 2025 Ruben Cano Diaz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Parallel algorithms over ranges of Results. Kept out of match.hpp so that
+// including the core library does not pull in <thread>.
+
+#include "match.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <execution>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <thread>
+
+namespace cppmatch {
+
+namespace cppmatch_detail {
+
+inline constexpr std::size_t no_failure = std::numeric_limits<std::size_t>::max();
+
+/// Lowers @p target to @p index unless it already holds a smaller one.
+inline void fetch_min(std::atomic<std::size_t> &target, std::size_t index) noexcept {
+  std::size_t current = target.load(std::memory_order_relaxed);
+  while (index < current &&
+         !target.compare_exchange_weak(current, index, std::memory_order_relaxed)) {
+  }
+}
+
+/// The earliest failure one worker has seen: an error or a thrown exception.
+template <typename E> struct worker_failure {
+  std::size_t index = no_failure;
+  std::optional<E> error;
+  std::exception_ptr exception;
+};
+
+/**
+ * @brief Helper threads shared by every parallel_collect call.
+ *
+ * The threads start on first use and wait for work between calls, so a call
+ * pays for waking them rather than for creating them. One call uses the pool
+ * at a time; a call made while it is busy, including one nested inside @p f,
+ * runs its job on the calling thread alone.
+ */
+class helper_pool {
+public:
+  static helper_pool &instance() {
+    static helper_pool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return pool;
+  }
+
+  /// Number of helper threads, the calling thread not included.
+  std::size_t size() const noexcept { return threads_.size(); }
+
+  /**
+   * @brief Runs job(0) on the calling thread and job(1) .. job(helpers) on the pool.
+   *
+   * Returns once every one of them has returned. When the pool is busy, only
+   * job(0) runs, so the job must be able to do all the work in one call.
+   */
+  template <typename Job> void run(std::size_t helpers, Job &job) {
+    bool expected = false;
+    if (helpers == 0 || !busy_.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+      job(std::size_t{0});
+      return;
+    }
+    helpers = std::min(helpers, threads_.size());
+    {
+      std::lock_guard lock(mutex_);
+      call_ = [](void *ctx, std::size_t index) { (*static_cast<Job *>(ctx))(index); };
+      ctx_ = &job;
+      next_ = 1;
+      last_ = helpers;
+      remaining_ = helpers;
+    }
+    wake_.notify_all();
+    job(std::size_t{0});
+    {
+      std::unique_lock lock(mutex_);
+      done_.wait(lock, [this] { return remaining_ == 0; });
+    }
+    busy_.store(false, std::memory_order_release);
+  }
+
+private:
+  explicit helper_pool(std::size_t threads) {
+    threads_.reserve(threads);
+    for (std::size_t i = 0; i < threads; ++i)
+      threads_.emplace_back([this](std::stop_token stop) { serve(stop); });
+  }
+
+  void serve(std::stop_token stop) {
+    std::unique_lock lock(mutex_);
+    while (wake_.wait(lock, stop, [this] { return next_ <= last_; })) {
+      const std::size_t index = next_++;
+      lock.unlock();
+      call_(ctx_, index);
+      lock.lock();
+      if (--remaining_ == 0)
+        done_.notify_one();
+    }
+  }
+
+  std::atomic<bool> busy_{false};
+  std::mutex mutex_;
+  std::condition_variable_any wake_;
+  std::condition_variable_any done_;
+  void (*call_)(void *, std::size_t) = nullptr;
+  void *ctx_ = nullptr;
+  std::size_t next_ = 1;
+  std::size_t last_ = 0;
+  std::size_t remaining_ = 0;
+  // Last, so the threads are joined before the state they wait on goes away.
+  std::vector<std::jthread> threads_;
+};
+
+} // namespace cppmatch_detail
+
+/**
+ * @brief Applies @p f to every element in parallel and collects the results.
+ *
+ * @p f maps an element to a Result<T, E>. The range is handed out to workers in
+ * chunks of increasing index. A worker hitting an error publishes its index,
+ * and every worker then skips the elements after it, so the rest of the work
+ * is cancelled early. Elements before that index are still evaluated, which
+ * makes the reported error the one at the lowest index, exactly as a serial
+ * collect_results would report it.
+ *
+ * If @p f throws, the exception counts as a failure at that index and is
+ * rethrown from the calling thread when it is the earliest failure.
+ *
+ * `std::execution::seq` runs on the calling thread. The parallel policies use
+ * up to std::thread::hardware_concurrency() threads, the calling thread
+ * included, so @p f must be safe to call concurrently. The other threads come
+ * from a pool started on the first call and reused by later ones.
+ *
+ * @param policy A standard execution policy.
+ * @param range A sized random access range.
+ * @param f Callable returning a Result for each element.
+ * @return Result<std::vector<T>, E> with every value in order, or the earliest error.
+ */
+template <typename Policy, std::ranges::random_access_range R, typename F>
+  requires std::is_execution_policy_v<std::remove_cvref_t<Policy>> &&
+           std::ranges::sized_range<R>
+auto parallel_collect([[maybe_unused]] Policy &&policy, R &&range, F f) {
+  using ResultType = std::remove_cvref_t<
+      std::invoke_result_t<F &, std::ranges::range_reference_t<R>>>;
+  static_assert(cppmatch_detail::is_result_v<ResultType>,
+                "f must return a Result");
+  using T = typename ResultType::value_type;
+  using E = typename ResultType::error_type;
+  using Out = Result<std::vector<T>, E>;
+
+  if constexpr (std::is_same_v<std::remove_cvref_t<Policy>,
+                               std::execution::sequenced_policy>) {
+    return collect_results(range | std::views::transform(std::ref(f)));
+  } else {
+    const std::size_t n = static_cast<std::size_t>(std::ranges::size(range));
+    const auto first = std::ranges::begin(range);
+
+    // Values land in their own slot, so the output keeps the input order.
+    // std::vector<bool> packs bits, so bool goes through std::optional too.
+    constexpr bool direct =
+        std::is_default_constructible_v<T> && !std::is_same_v<T, bool>;
+    using Slot = std::conditional_t<direct, T, std::optional<T>>;
+    std::vector<Slot> slots(n);
+
+    auto &pool = cppmatch_detail::helper_pool::instance();
+    const std::size_t threads =
+        std::min<std::size_t>(pool.size() + 1, n / 64 + 1);
+    const std::size_t grain = std::max<std::size_t>(1, n / (threads * 16));
+
+    std::atomic<std::size_t> next_chunk{0};
+    std::atomic<std::size_t> failed_at{cppmatch_detail::no_failure};
+    std::vector<cppmatch_detail::worker_failure<E>> failures(threads);
+
+    auto work = [&](cppmatch_detail::worker_failure<E> &failure) {
+      for (;;) {
+        const std::size_t begin =
+            next_chunk.fetch_add(grain, std::memory_order_relaxed);
+        if (begin >= n || begin > failed_at.load(std::memory_order_relaxed))
+          return;
+        const std::size_t end = std::min(n, begin + grain);
+        for (std::size_t i = begin; i < end; ++i) {
+          if (i > failed_at.load(std::memory_order_relaxed))
+            return;
+#if _CPPUNWIND || __EXCEPTIONS || __cpp_exceptions
+          try {
+#endif
+            auto res = f(first[static_cast<std::ranges::range_difference_t<R>>(i)]);
+            if (is_err(res)) [[unlikely]] {
+              failure.index = i;
+              failure.error.emplace(std::move(res).error_unchecked());
+              cppmatch_detail::fetch_min(failed_at, i);
+              return;
+            }
+            slots[i] = std::move(res).value_unchecked();
+#if _CPPUNWIND || __EXCEPTIONS || __cpp_exceptions
+          } catch (...) {
+            failure.index = i;
+            failure.exception = std::current_exception();
+            cppmatch_detail::fetch_min(failed_at, i);
+            return;
+          }
+#endif
+        }
+      }
+    };
+
+    auto job = [&](std::size_t t) { work(failures[t]); };
+    pool.run(threads - 1, job);
+
+    // Each worker returns at its first failure, and failures at a lower index
+    // are never skipped, so the minimum over workers is the earliest one.
+    auto earliest = std::ranges::min_element(failures, {}, [](const auto &f) {
+      return f.index;
+    });
+    if (earliest->index != cppmatch_detail::no_failure) {
+      if (earliest->exception)
+        std::rethrow_exception(earliest->exception);
+      return Out(std::in_place_index<1>, std::move(*earliest->error));
+    }
+
+    if constexpr (direct) {
+      return Out(std::in_place_index<0>, std::move(slots));
+    } else {
+      std::vector<T> values;
+      values.reserve(n);
+      for (auto &slot : slots)
+        values.push_back(std::move(*slot));
+      return Out(std::in_place_index<0>, std::move(values));
+    }
+  }
+}
+
+} // namespace cppmatch
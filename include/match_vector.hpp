@@ -0,0 +1,277 @@
+#pragma once
+/*
+MIT License
+
+Copyright (c) 2025 Ruben Cano Diaz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// A structure-of-arrays container for batches of Results in which errors are rare.
+
+#include "match.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <span>
+
+namespace cppmatch {
+
+/**
+ * @brief A sequence of Result<T, E> stored as separate arrays.
+ *
+ * Instead of a Result per element, padded to hold either side plus a tag, the
+ * container keeps:
+ * - a bitmap with one bit per element, set when the element is ok;
+ * - a dense array of the success values, contiguous and in order;
+ * - a side table of (index, error) entries for the failures.
+ *
+ * Scans over success values therefore walk contiguous memory, and the bitmap
+ * answers status queries in bulk. Element access by index is O(1) for the
+ * status and the value, and O(log errors) for an error.
+ *
+ * @tparam T The success type.
+ * @tparam E The error type.
+ */
+template <typename T, typename E> class ResultVector {
+public:
+  using value_type = Result<T, E>;
+  using size_type = std::size_t;
+
+  /// A failed element: its position in the sequence and its error.
+  struct error_entry {
+    size_type index;
+    E error;
+  };
+
+  ResultVector() = default;
+
+  /**
+   * @brief Reserves storage for @p n elements.
+   *
+   * @param n The expected number of elements.
+   * @param expected_errors How many of them are expected to be errors.
+   */
+  void reserve(size_type n, size_type expected_errors = 0) {
+    const size_type words = (n + 63) / 64;
+    bits_.reserve(words);
+    ok_before_.reserve(words);
+    values_.reserve(n - std::min(n, expected_errors));
+    errors_.reserve(expected_errors);
+  }
+
+  /// Appends a success value constructed from @p args.
+  template <typename... Args> T &emplace_value(Args &&...args) {
+    T &value = values_.emplace_back(std::forward<Args>(args)...);
+    append_bit(true);
+    return value;
+  }
+
+  /// Appends an error constructed from @p args.
+  template <typename... Args> E &emplace_error(Args &&...args) {
+    E &error =
+        errors_.emplace_back(error_entry{size_, E(std::forward<Args>(args)...)})
+            .error;
+    append_bit(false);
+    return error;
+  }
+
+  /// Appends a copy of @p res.
+  void push_back(const Result<T, E> &res) {
+    if (res.index() == 0)
+      emplace_value(res.value_unchecked());
+    else
+      emplace_error(res.error_unchecked());
+  }
+
+  /// Appends @p res, moving its content.
+  void push_back(Result<T, E> &&res) {
+    if (res.index() == 0)
+      emplace_value(std::move(res).value_unchecked());
+    else
+      emplace_error(std::move(res).error_unchecked());
+  }
+
+  /// Number of elements.
+  size_type size() const noexcept { return size_; }
+
+  /// True if there are no elements.
+  bool empty() const noexcept { return size_ == 0; }
+
+  /// Number of successes, counted with a popcount over the bitmap.
+  size_type count_ok() const noexcept {
+    size_type count = 0;
+    for (std::uint64_t word : bits_)
+      count += static_cast<size_type>(std::popcount(word));
+    return count;
+  }
+
+  /// Number of errors.
+  size_type count_err() const noexcept { return size_ - count_ok(); }
+
+  /// True if element @p i is a success.
+  bool is_ok(size_type i) const noexcept {
+    return (bits_[i / 64] >> (i % 64)) & 1u;
+  }
+
+  /// True if element @p i is an error.
+  bool is_err(size_type i) const noexcept { return !is_ok(i); }
+
+  /**
+   * @brief Returns a copy of element @p i as a Result.
+   */
+  Result<T, E> operator[](size_type i) const {
+    if (is_ok(i))
+      return Result<T, E>(std::in_place_index<0>, values_[rank(i)]);
+    return Result<T, E>(std::in_place_index<1>, error_at(i));
+  }
+
+  /// The success value of element @p i, which must be ok.
+  const T &value_unchecked(size_type i) const noexcept {
+    return values_[rank(i)];
+  }
+
+  /// The error of element @p i, which must be an error.
+  const E &error_unchecked(size_type i) const noexcept { return error_at(i); }
+
+  /// Every success value, in order, as one contiguous span.
+  std::span<T> values() noexcept { return values_; }
+  std::span<const T> values() const noexcept { return values_; }
+
+  /// Every error with its index, in order.
+  std::span<const error_entry> errors() const noexcept { return errors_; }
+
+  /// The raw status bitmap: bit i % 64 of word i / 64 is set when element i is ok.
+  std::span<const std::uint64_t> status_words() const noexcept { return bits_; }
+
+  /**
+   * @brief Matches every element in order.
+   *
+   * Success values and the alternatives of each error are dispatched to the
+   * overloaded lambdas, as match() does for a single Result. Runs of words in
+   * which every element is ok go straight over the value array.
+   */
+  template <typename... Lambdas> void for_each(Lambdas &&...lambdas) const {
+    cppmatch_detail::overloaded vis{std::forward<Lambdas>(lambdas)...};
+    size_type value = 0, error = 0;
+    for (size_type w = 0; w < bits_.size(); ++w) {
+      const size_type count = std::min<size_type>(64, size_ - w * 64);
+      if (count == 64 && bits_[w] == ~std::uint64_t{0}) {
+        for (size_type k = 0; k < 64; ++k)
+          cppmatch_detail::flat_visit(values_[value++], vis);
+        continue;
+      }
+      for (size_type k = 0; k < count; ++k) {
+        if ((bits_[w] >> k) & 1u)
+          cppmatch_detail::flat_visit(values_[value++], vis);
+        else
+          cppmatch_detail::flat_visit(errors_[error++].error, vis);
+      }
+    }
+  }
+
+  /// Removes every element, keeping the storage.
+  void clear() noexcept {
+    bits_.clear();
+    ok_before_.clear();
+    values_.clear();
+    errors_.clear();
+    size_ = 0;
+  }
+
+  /// The success values, as `rv | successes`.
+  friend std::span<const T> operator|(const ResultVector &rv,
+                                      const cppmatch_ranges::successes_fn &) {
+    return rv.values_;
+  }
+  friend std::span<T> operator|(ResultVector &rv,
+                                const cppmatch_ranges::successes_fn &) {
+    return rv.values_;
+  }
+
+  /// The errors in order, as `rv | errors`.
+  friend auto operator|(const ResultVector &rv,
+                        const cppmatch_ranges::errors_fn &) {
+    return std::span<const error_entry>(rv.errors_) |
+           std::views::transform(&error_entry::error);
+  }
+
+private:
+  void append_bit(bool ok) {
+    if (size_ % 64 == 0) {
+      bits_.push_back(0);
+      ok_before_.push_back(values_.size() - ok);
+    }
+    bits_.back() |= std::uint64_t{ok} << (size_ % 64);
+    ++size_;
+  }
+
+  /// Position in values_ of element @p i: the number of successes before it.
+  size_type rank(size_type i) const noexcept {
+    const std::uint64_t below = (std::uint64_t{1} << (i % 64)) - 1;
+    return ok_before_[i / 64] +
+           static_cast<size_type>(std::popcount(bits_[i / 64] & below));
+  }
+
+  const E &error_at(size_type i) const noexcept {
+    auto it = std::ranges::lower_bound(errors_, i, {}, &error_entry::index);
+    return it->error;
+  }
+
+  std::vector<std::uint64_t> bits_;
+  std::vector<size_type> ok_before_;
+  std::vector<T> values_;
+  std::vector<error_entry> errors_;
+  size_type size_ = 0;
+};
+
+/// Number of errors in @p rv, from its bitmap.
+template <typename T, typename E>
+std::size_t count_errors(const ResultVector<T, E> &rv) noexcept {
+  return rv.count_err();
+}
+
+/// Index of the first error in @p rv, or rv.size() if there is none.
+template <typename T, typename E>
+std::size_t find_first_error(const ResultVector<T, E> &rv) noexcept {
+  const auto words = rv.status_words();
+  for (std::size_t w = 0; w < words.size(); ++w) {
+    const std::uint64_t errors = ~words[w];
+    if (errors != 0) {
+      const std::size_t i = w * 64 + static_cast<std::size_t>(std::countr_zero(errors));
+      return std::min(i, rv.size());
+    }
+  }
+  return rv.size();
+}
+
+/// Writes the error bitmask of @p rv, laid out as for a span of Results.
+template <typename T, typename E>
+void error_mask(const ResultVector<T, E> &rv, std::span<std::uint64_t> out_bits) {
+  const auto words = rv.status_words();
+  assert(out_bits.size() >= words.size() && "error_mask: out_bits is too short for the results");
+  for (std::size_t w = 0; w < words.size(); ++w)
+    out_bits[w] = ~words[w];
+  if (const std::size_t tail = rv.size() % 64; tail != 0)
+    out_bits[words.size() - 1] &= (std::uint64_t{1} << tail) - 1;
+}
+
+} // namespace cppmatch
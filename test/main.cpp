@@ -1,12 +1,29 @@
 #include "match.hpp"
+#include "match_parallel.hpp"
+#include "match_vector.hpp"
+#include "match_lazy_error.hpp"
+#include "match_coro.hpp"
+#include "match_async.hpp"
+#include "match_lines.hpp"
+#include "match_arena.hpp"
 
 #include <print>
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <cstdint>
+#include <filesystem>
 #include <iostream>
+#include <memory>
+#include <numeric>
+#include <optional>
 #include <stdexcept>
 #include <string>
 #include <tuple>
 #include <vector>
 #include <source_location>
+#include <span>
+#include <thread>
 #include <string_view>
 
 using namespace cppmatch;
@@ -49,6 +66,163 @@ Result<int, Error<std::string>> test_expect_macro_error() {
     return value; // This line is never reached.
 }
 
+// Same as above through expect_cold, which propagates through an out-of-line conversion.
+Result<int, Error<std::string, int>> test_expect_cold_macro(Result<int, Error<std::string>> res) {
+    int value = expect_cold(res);
+    return value + 1;
+}
+
+// ---------------------------------------------------------------------------
+// Test functions using expect_e, which propagates errors as exceptions.
+struct E1 {}; struct E2 {}; struct E3 {}; struct E4 {}; struct E5 {};
+struct E6 { std::string message; };
+using SixErrors = Error<E1, E2, E3, E4, E5, E6>;
+
+Result<int, Error<E6, E1>> test_expect_e_inner(bool fail) {
+    if (fail) return E6{"last alternative"};
+    return 20;
+}
+
+Result<int, SixErrors> test_expect_e_outer(bool fail) {
+    return expect_e(test_expect_e_inner(fail)) + 1;
+}
+
+Result<int, SixErrors> test_foreign_throw() {
+    throw E4{};
+}
+
+// Packed Result layouts, opted into through packed_result_traits.
+struct PackedNode { int payload; };
+enum class io_errc : std::uint8_t { closed = 1, timeout = 7 };
+struct overflow {};
+
+template <> struct cppmatch::packed_result_traits<PackedNode*, io_errc>
+    : cppmatch::tagged_pointer_packing<PackedNode*, io_errc> {};
+template <> struct cppmatch::packed_result_traits<std::uint32_t, overflow>
+    : cppmatch::niche_packing<std::uint32_t, overflow, 0xffffffffu> {};
+template <> struct cppmatch::packed_result_traits<std::uint32_t, io_errc>
+    : cppmatch::word_packing<std::uint32_t, io_errc> {};
+
+// Whether V packs as a success value in a constant expression; the niche does not.
+template <std::uint32_t V>
+constexpr bool niche_packs_as_value = requires {
+    typename std::integral_constant<
+        std::size_t, Result<std::uint32_t, overflow>(std::in_place_index<0>, V).index()>;
+};
+
+Result<std::uint32_t, io_errc> packed_step(std::uint32_t x) {
+    if (x == 0) return io_errc::timeout;
+    return x - 1;
+}
+
+Result<std::uint32_t, io_errc> packed_twice(std::uint32_t x) {
+    auto once = expect(packed_step(x));
+    return expect(packed_step(once));
+}
+
+// Destroyed during thread exit, after the releaser of the thread's Boxed pool.
+struct BoxedLeftover { int line; };
+void boxed_at_thread_exit() {
+    thread_local std::optional<Boxed<BoxedLeftover>> late;
+    late.emplace(BoxedLeftover{5});
+    { Boxed<BoxedLeftover> pooled(BoxedLeftover{6}); }
+}
+
+#if defined(CPPMATCH_INSTRUMENT)
+struct Throttled {};
+struct Refused {};
+
+Result<int, Error<Throttled, Refused>> instrumented_leaf(int x) {
+    if (x == 1) return Throttled{};
+    if (x == 2) return Refused{};
+    return x;
+}
+
+Result<int, Error<Throttled, Refused>> instrumented_caller(int x) {
+    return expect(instrumented_leaf(x)) + 1;
+}
+
+Result<int, Error<Throttled, Refused>> instrumented_caller_e(int x) {
+    return expect_e(instrumented_leaf(x)) + 1;
+}
+
+template <typename T> Result<T, Error<Throttled, Refused>> instrumented_generic(T x) {
+    return expect(instrumented_leaf(static_cast<int>(x))) + x;
+}
+
+std::uint64_t propagations_of(std::string_view type, propagation_kind kind) {
+    std::uint64_t total = 0;
+    for (const auto& c : propagation_counts())
+        if (c.kind == kind && c.error_type.ends_with(type))
+            total += c.count;
+    return total;
+}
+#endif
+
+struct Overflow {};
+struct Negative {};
+
+Result<int, Error<Negative>> coro_checked(int x) {
+    if (x < 0) co_return Negative{};
+    co_return x;
+}
+
+Result<int, Error<Negative, Overflow>> coro_sum(int a, int b) {
+    int x = co_await coro_checked(a);
+    int y = co_await coro_checked(b);
+    if (x > 1000 - y) co_return Overflow{};
+    co_return x + y;
+}
+
+Result<unsigned, Overflow> coro_depth(unsigned n) {
+    if (n == 0) co_return 0u;
+    co_return co_await coro_depth(n - 1) + 1;
+}
+
+struct NotFound { int id; };
+struct Unavailable {};
+
+Task<Result<int, Error<NotFound>>> async_lookup(int id) {
+    if (id < 0) co_return NotFound{id};
+    co_return id * 10;
+}
+
+Task<Result<int, Error<NotFound, Unavailable>>> async_handler(int id) {
+    int a = co_await async_lookup(id);
+    int b = co_await async_lookup(id + 1);
+    co_return a + b;
+}
+
+Task<Result<int, Unavailable>> async_step(work_stealing_executor& ex, int i, std::atomic<int>& finished) {
+    co_await ex.schedule();
+    if (i == 3) co_return Unavailable{};
+    for (int k = 0; k < 20; ++k) co_await ex.schedule();
+    finished.fetch_add(1);
+    co_return i;
+}
+
+#if defined(CPPMATCH_TRACE)
+struct Timeout {};
+
+Result<int, Error<Timeout>> traced_leaf(int x) {
+    if (x < 0) return Timeout{};
+    return x;
+}
+
+Result<int, Error<Timeout, io_errc>> traced_middle(int x) {
+    return expect(traced_leaf(x)) * 2;
+}
+
+Result<int, Error<Timeout, io_errc>> traced_top(int x) {
+    return expect_cold(traced_middle(x)) + 1;
+}
+
+Result<int, Error<Timeout, io_errc>> traced_recursive(int depth) {
+    if (depth == 0) return Timeout{};
+    return expect(traced_recursive(depth - 1));
+}
+#endif
+
 // ---------------------------------------------------------------------------
 // A simple test runner helper that prints colorful output.
 template<typename Func>
@@ -75,7 +249,7 @@ void run_tests() {
     run_test("test_expect_macro_success", [](){
         auto res = test_expect_macro_success();
         CHECK(res.index() == 0);
-        CHECK(std::get<0>(res) == 10);
+        CHECK(get<0>(res) == 10);
     }, passed, failed);
 
     run_test("test_expect_macro_error", [](){
@@ -83,6 +257,98 @@ void run_tests() {
         CHECK(res.index() == 1);
     }, passed, failed);
 
+    run_test("test_expect_cold_macro", [](){
+        auto ok = test_expect_cold_macro(41);
+        CHECK(is_ok(ok) && get<0>(ok) == 42);
+        auto err = test_expect_cold_macro(Error<std::string>(std::string("Failed")));
+        CHECK(is_err(err));
+        CHECK(match(err, [](int) { return false; }, [](const std::string& s) { return s == "Failed"; }));
+    }, passed, failed);
+
+    run_test("expect_e / match_e propagate through a single wrapper exception", [](){
+        auto ok = match_e(test_expect_e_outer(false),
+            [](int v) { return std::to_string(v); },
+            [](const auto&) { return std::string("error"); });
+        CHECK(ok == "21");
+        auto err = match_e(test_expect_e_outer(true),
+            [](int) { return std::string(); },
+            [](const E6& e) { return e.message; },
+            [](const auto&) { return std::string("other"); });
+        CHECK(err == "last alternative");
+    }, passed, failed);
+
+    run_test("expect_e errors can still be caught as themselves", [](){
+        bool caught = false;
+        try {
+            (void) expect_e(test_expect_e_inner(true));
+        } catch (const E6& e) {
+            caught = e.message == "last alternative";
+        }
+        CHECK(caught);
+    }, passed, failed);
+
+    run_test("match_e falls back for foreign exceptions", [](){
+        auto which = match_e(test_foreign_throw(),
+            [](int) { return 0; },
+            [](const E4&) { return 4; },
+            [](const auto&) { return -1; });
+        CHECK(which == 4);
+    }, passed, failed);
+
+    run_test("expect_e throws non-class and final errors as themselves", [](){
+        struct Sealed final { int code; };
+        auto code = [](bool fail) -> Result<int, Error<int>> {
+            if (fail) return Error<int>(42);
+            return 0;
+        };
+        auto sealed = []() -> Result<int, Error<Sealed>> { return Sealed{9}; };
+        int caught = 0;
+        try {
+            (void) expect_e(code(true));
+        } catch (int v) {
+            caught = v;
+        }
+        CHECK(caught == 42);
+        try {
+            (void) expect_e(sealed());
+        } catch (const Sealed& s) {
+            caught = s.code;
+        }
+        CHECK(caught == 9);
+
+        auto outer = [&]() -> Result<long, Error<Sealed, int>> { return expect_e(code(true)); };
+        CHECK(match_e(outer(), [](long) { return 0; }, [](const Sealed&) { return -2; },
+                      [](int v) { return v; }) == 42);
+        auto outer_sealed = [&]() -> Result<long, Error<Sealed>> { return expect_e(sealed()); };
+        CHECK(match_e(outer_sealed(), [](long) { return 0; }, [](const Sealed& s) { return s.code; }) == 9);
+    }, passed, failed);
+
+    run_test("match_e catches errors derived from a listed alternative", [](){
+        struct BaseErr { int code; };
+        struct DerivedErr : BaseErr {};
+        struct Unrelated {};
+        auto inner = [](bool unrelated) -> Result<int, Error<DerivedErr, Unrelated>> {
+            if (unrelated)
+                return Unrelated{};
+            return DerivedErr{{7}};
+        };
+        auto outer = [&](bool unrelated) -> Result<int, Error<BaseErr>> {
+            return expect_e(inner(unrelated));
+        };
+        auto code = match_e(outer(false),
+            [](int) { return 0; },
+            [](const BaseErr& e) { return e.code; });
+        CHECK(code == 7);
+
+        bool escaped = false;
+        try {
+            (void) match_e(outer(true), [](int) { return 0; }, [](const BaseErr&) { return 1; });
+        } catch (const Unrelated&) {
+            escaped = true;
+        }
+        CHECK(escaped);
+    }, passed, failed);
+
     run_test("is_ok() with success variant", [](){
         Result<int, std::string> r = 5;
         CHECK(is_ok(r));
@@ -149,11 +415,74 @@ void run_tests() {
         CHECK(result2 == result);
       }, passed, failed);
 
+    run_test("Error conversion constructs the target alternative in place", [](){
+        struct NoDefault { explicit NoDefault(int v) : v(v) {} int v; };
+        struct Counted {
+            int* copies;
+            explicit Counted(int* c) : copies(c) {}
+            Counted(const Counted& o) : copies(o.copies) { ++*copies; }
+            Counted(Counted&& o) noexcept : copies(o.copies) {}
+        };
+        int copies = 0;
+        Error<Counted, std::string> narrow = Counted{&copies};
+        Error<NoDefault, std::string, Counted> wide = std::move(narrow);
+        CHECK(copies == 0);
+        CHECK(wide.value.index() == 2);
+        Error<NoDefault, std::string, Counted> copied = Error<Counted, std::string>(Counted{&copies});
+        CHECK(copies == 0);
+        Error<Counted, std::string> lvalue = std::string("text");
+        Error<NoDefault, std::string, Counted> from_lvalue = lvalue;
+        CHECK(std::get<std::string>(from_lvalue.value) == "text");
+        CHECK(std::get<std::string>(lvalue.value) == "text");
+    }, passed, failed);
+
+    run_test("match() flattens deeply nested alternatives", [](){
+        using Inner = Error<int, std::string>;
+        using Outer = Error<Inner, std::variant<char, long>, float>;
+        using Nested = Result<double, Outer>;
+        auto which = [](const Nested& n) {
+            return match(n,
+                [](double) { return 0; },
+                [](int) { return 1; },
+                [](const std::string&) { return 2; },
+                [](char) { return 3; },
+                [](long) { return 4; },
+                [](float) { return 5; });
+        };
+        CHECK(which(Nested{1.0}) == 0);
+        CHECK(which(Nested{Inner{7}}) == 1);
+        CHECK(which(Nested{Inner{std::string("s")}}) == 2);
+        CHECK(which(Nested{std::variant<char, long>{'c'}}) == 3);
+        CHECK(which(Nested{std::variant<char, long>{9L}}) == 4);
+        CHECK(which(Nested{Outer{2.0f}}) == 5);
+
+        static_assert(match(Result<int, std::variant<char, float>>{std::variant<char, float>{'x'}},
+            [](int) { return 0; },
+            [](char c) { return c == 'x' ? 1 : -1; },
+            [](float) { return 2; }) == 1);
+    }, passed, failed);
+
+    run_test("match() on wide variants and rvalues", [](){
+        auto wide = []<std::size_t... I>(std::index_sequence<I...>) {
+            return std::variant<std::integral_constant<std::size_t, I>...>{};
+        };
+        using Wide = decltype(wide(std::make_index_sequence<40>{}));
+        Wide w{std::in_place_index<37>};
+        CHECK(match(w, [](auto c) { return decltype(c)::value; }) == 37);
+
+        Result<int, Error<std::string, Wide>> r = std::string("moved");
+        std::string out = match(std::move(r),
+            [](int) { return std::string(); },
+            [](std::string&& s) { return std::move(s); },
+            [](auto) { return std::string(); });
+        CHECK(out == "moved");
+    }, passed, failed);
+
     run_test("map_error with success", [](){
         Result<int, std::string> r = 42;
         auto r2 = map_error(r, [](const std::string& s) { return s.size(); });
         CHECK(r2.index() == 0);
-        CHECK(std::get<0>(r2) == 42);
+        CHECK(get<0>(r2) == 42);
     }, passed, failed);
 
     run_test("map_error with error", [](){
@@ -162,7 +491,257 @@ void run_tests() {
         Result<int, ErrorType1> r = ErrorType1{};  // Error case
         auto r2 = map_error(r, [](const ErrorType1& /*s*/) { return ErrorType2{}; });
         CHECK(r2.index() == 1);
-        CHECK(std::holds_alternative<ErrorType2>(r2));
+        CHECK(holds_alternative<ErrorType2>(r2));
+    }, passed, failed);
+
+    run_test("fused combinators", [](){
+        struct Parse { std::string input; };
+        struct Range {};
+        using R = Result<int, Error<Parse>>;
+        auto parse = [](const std::string& s) -> R {
+            if (s.empty() || s[0] < '0' || s[0] > '9') return Parse{s};
+            return std::stoi(s);
+        };
+        auto in_range = [](int x) -> Result<int, Error<Parse, Range>> {
+            if (x > 100) return Range{};
+            return x;
+        };
+
+        Result<std::string, Error<Parse, Range>> ok =
+            parse("42") | transform([](int x) { return x * 2; }) | and_then(in_range) |
+            transform([](int x) { return std::to_string(x); });
+        CHECK(get<0>(ok) == "84");
+
+        auto describe = [&](const std::string& s) {
+            return match(parse(s) | and_then(in_range) | transform([](int x) { return x + 1; }),
+                [](int x) { return std::to_string(x); },
+                [](const Parse& p) { return "parse:" + p.input; },
+                [](Range) { return std::string("range"); });
+        };
+        CHECK(describe("7") == "8");
+        CHECK(describe("x") == "parse:x");
+        CHECK(describe("700") == "range");
+
+        // Each function runs at most once, and only on its side.
+        int calls = 0;
+        Result<int, std::string> failed = std::string("bad");
+        auto traced = failed | transform([&](int x) { ++calls; return x; }) |
+                      transform_error([&](std::string e) { ++calls; return e.size(); });
+        Result<int, std::size_t> sized = std::move(traced);
+        CHECK(get<1>(sized) == 3u && calls == 1);
+
+        auto recovered = or_else(Result<int, std::string>(std::string("bad")),
+                                 [](std::string&& e) -> Result<long, int> { return static_cast<long>(e.size()); });
+        CHECK(get<0>(recovered) == 3);
+
+        // A chain built on a temporary owns it, so it can be stored and evaluated later.
+        auto doubled = parse("21") | transform([](int x) { return x * 2; });
+        auto rejected = parse("not a number, and longer than any small string") |
+                        transform([](int x) { return x * 2; });
+        Result<int, Error<Parse>> later = std::move(doubled);
+        CHECK(get<0>(later) == 42);
+        Result<int, Error<Parse>> later_error = std::move(rejected);
+        CHECK(match(later_error, [](int) { return std::string(); },
+                    [](const Parse& p) { return p.input; }) ==
+              "not a number, and longer than any small string");
+
+        // Rvalue sources move their payload into the functions.
+        Result<std::string, int> text = std::string(64, 'a');
+        auto moved = transform(std::move(text), [](std::string&& s) { return std::move(s); });
+        CHECK(get<0>(moved).size() == 64 && get<0>(text).empty());
+
+        constexpr auto folded = transform(and_then(Result<int, float>(20), [](int x) -> Result<int, float> {
+            return x + 1; }), [](int x) { return x * 2; });
+        static_assert(folded.value_unchecked() == 42);
+    }, passed, failed);
+
+    run_test("move-out accessors", [](){
+        struct Payload {
+            std::vector<int> data;
+            int* copies;
+            Payload(std::vector<int> d, int* c) : data(std::move(d)), copies(c) {}
+            Payload(const Payload& o) : data(o.data), copies(o.copies) { ++*copies; }
+            Payload(Payload&&) noexcept = default;
+            Payload& operator=(const Payload&) = default;
+            Payload& operator=(Payload&&) noexcept = default;
+        };
+        int copies = 0;
+        auto make = [&](bool ok) -> Result<Payload, std::string> {
+            if (!ok) return std::string("missing");
+            return Payload{std::vector<int>(1000, 1), &copies};
+        };
+
+        CHECK(default_expect(make(true), Payload{{}, &copies}).data.size() == 1000);
+        CHECK(default_expect(make(false), Payload{{7}, &copies}).data.size() == 1);
+        CHECK(expect_e(make(true)).data.size() == 1000);
+        CHECK(map_error(make(true), [](const std::string& e) { return e.size(); }).value_unchecked().data.size() == 1000);
+        CHECK(copies == 0);
+
+        // The factory only runs on the error path, and can see the error.
+        int built = 0;
+        auto fallback = [&]() { ++built; return Payload{{1, 2}, &copies}; };
+        CHECK(default_expect_with(make(true), fallback).data.size() == 1000);
+        CHECK(built == 0);
+        CHECK(default_expect_with(make(false), fallback).data.size() == 2);
+        CHECK(built == 1);
+        auto r = make(false);
+        CHECK(default_expect_with(r, [&](const std::string& e) { return Payload{std::vector<int>(e.size()), &copies}; }).data.size() == 7);
+        CHECK(copies == 0);
+
+        // Lvalues are still copied, and left intact.
+        auto kept = make(true);
+        CHECK(default_expect(kept, Payload{{}, &copies}).data.size() == 1000);
+        CHECK(copies == 1 && kept.value_unchecked().data.size() == 1000);
+    }, passed, failed);
+
+    run_test("matching several values at once", [](){
+        struct Login { int user; };
+        struct Logout { int user; };
+        struct Timeout {};
+        using Event = std::variant<Login, Logout>;
+        Result<int, Error<Timeout, std::string>> lookup = 5;
+        Event e = Logout{5};
+
+        auto correlate = [](auto&& event, auto&& result) {
+            return match(std::tie(event, result),
+                [](const Login& l, int user) { return l.user == user ? 1 : 0; },
+                [](const Logout& l, int user) { return l.user == user ? 2 : 0; },
+                [](const auto&, Timeout) { return -1; },
+                [](const auto&, const std::string&) { return -2; });
+        };
+        CHECK(correlate(e, lookup) == 2);
+        CHECK(correlate(Event{Login{5}}, lookup) == 1);
+        CHECK(correlate(e, Result<int, Error<Timeout, std::string>>(Timeout{})) == -1);
+        CHECK(correlate(e, Result<int, Error<Timeout, std::string>>(std::string("x"))) == -2);
+
+        // Three values: 2 x 3 x 2 = 12 combinations in one dispatch.
+        Result<int, char> a = 'c';
+        Result<bool, float> b = 2.5f;
+        int seen = match(std::tie(e, lookup, a),
+            [](const Login&, int, int) { return 0; },
+            [](const Logout&, int, char c) { return c == 'c' ? 3 : 0; },
+            [](const auto&, const auto&, const auto&) { return 9; });
+        CHECK(seen == 3);
+        CHECK(match(std::tie(a, b), [](char, float f) { return f; }, [](auto, auto) { return 0.f; }) == 2.5f);
+
+        // Rvalue elements are handed over as rvalues.
+        Result<std::string, int> text = std::string(40, 'z');
+        Event login = Login{1};
+        std::string taken = match(std::forward_as_tuple(std::move(text), login),
+            [](std::string&& s, const auto&) { return std::move(s); },
+            [](int, const auto&) { return std::string(); });
+        CHECK(taken.size() == 40 && get<0>(text).empty());
+
+        // A tuple of plain values is still one value.
+        CHECK(match(std::tuple(1, 2), [](std::tuple<int, int> t) { return std::get<1>(t); }) == 2);
+    }, passed, failed);
+
+    run_test("value patterns and guards", [](){
+        struct KeyPress { char c; };
+        struct Click { std::uint64_t x, y; };
+        struct Paste { std::string text; };
+        using Event = std::variant<KeyPress, Click, Paste>;
+
+        int guard_calls = 0;
+        auto route = [&](const Event& e) {
+            return match(e,
+                on<KeyPress>(field<&KeyPress::c>(equals<'q'>)) >> [](const KeyPress&) { return 1; },
+                on<KeyPress>(field<&KeyPress::c>(in_range<'a', 'z'>)) >> [](const KeyPress&) { return 2; },
+                on<Click>(field<&Click::x>(in_range<0, 99>), field<&Click::y>(in_range<0, 99>))
+                    >> [](const Click&) { return 3; },
+                on<Click>(field<&Click::x>(in_range<0, 99>),
+                          when([&](const Click& c) { ++guard_calls; return c.y % 2 == 0; }))
+                    >> [](const Click&) { return 4; },
+                on<Click>(field<&Click::x>(in_range<10, 20>)) >> [](const Click&) { return 5; },
+                otherwise >> [](const auto&) { return 0; });
+        };
+        CHECK(route(KeyPress{'q'}) == 1);
+        CHECK(route(KeyPress{'b'}) == 2);
+        CHECK(route(KeyPress{'!'}) == 0);
+        CHECK(route(Click{5, 5}) == 3);
+        CHECK(guard_calls == 0);
+        CHECK(route(Click{5, 200}) == 4);
+        CHECK(route(Click{15, 201}) == 5);
+        CHECK(guard_calls == 2);
+        // x outside [0, 99] rules out [10, 20] too, and the guard is never asked.
+        CHECK(route(Click{500, 0}) == 0);
+        CHECK(guard_calls == 2);
+        CHECK(route(Paste{"text"}) == 0);
+
+        // Bare ranges test the alternative itself; handlers receive rvalues from rvalues.
+        Result<int, Error<std::string, Paste>> r = 7;
+        auto classify = [](auto&& value) {
+            return match(std::forward<decltype(value)>(value),
+                on<int>(in_range<-9, 9>) >> [](int v) { return v; },
+                on<int>() >> [](int) { return 100; },
+                on<std::string>() >> [](auto&& s) {
+                    return std::is_rvalue_reference_v<decltype(s)> ? int(s.size()) : -int(s.size());
+                },
+                otherwise >> [](auto&&) { return -1; });
+        };
+        CHECK(classify(r) == 7);
+        CHECK(classify(Result<int, Error<std::string, Paste>>(-40)) == 100);
+        CHECK(classify(Result<int, Error<std::string, Paste>>(std::string("four"))) == 4);
+        Result<int, Error<std::string, Paste>> text = std::string("five!");
+        CHECK(classify(text) == -5);
+        CHECK(classify(Result<int, Error<std::string, Paste>>(Paste{"x"})) == -1);
+
+        // Mixed signedness compares by value.
+        CHECK(match(Result<unsigned, char>(5u),
+                    on<unsigned>(in_range<-1, 5>) >> [](unsigned) { return true; },
+                    otherwise >> [](auto) { return false; }));
+    }, passed, failed);
+
+    run_test("match_each over ranges", [](){
+        struct Open { int id; };
+        struct Data { int id; std::string payload; };
+        struct Close { int id; };
+        using Event = std::variant<Open, Data, Close>;
+        std::vector<Event> events = {Open{1}, Data{1, "a"}, Open{2}, Close{1}, Data{2, "bb"}, Data{1, "ccc"}, Close{2}};
+
+        std::vector<int> seen;
+        auto record = [&](auto&&... mode) {
+            seen.clear();
+            match_each(mode..., events,
+                [&](const Open& o) { seen.push_back(100 + o.id); },
+                [&](const Data& d) { seen.push_back(200 + int(d.payload.size())); },
+                [&](const Close& c) { seen.push_back(300 + c.id); });
+            return seen;
+        };
+        CHECK((record() == std::vector<int>{101, 201, 102, 301, 202, 203, 302}));
+        CHECK((record(in_order) == record()));
+        // Grouped by alternative, each group in range order.
+        CHECK((record(bucketed) == std::vector<int>{101, 102, 201, 202, 203, 301, 302}));
+
+        // Nested Results are bucketed by flattened alternative; owned ranges are moved from.
+        struct Timeout {};
+        std::vector<Result<std::string, Error<Timeout, int>>> results;
+        results.push_back(std::string("x"));
+        results.push_back(7);
+        results.push_back(Timeout{});
+        results.push_back(std::string(30, 'y'));
+        std::vector<std::string> texts;
+        int codes = 0, timeouts = 0;
+        match_each(bucketed, std::move(results),
+            [&](std::string&& s) { texts.push_back(std::move(s)); },
+            [&](Timeout) { timeouts += 1; },
+            [&](int c) { codes += c; });
+        CHECK(texts.size() == 2 && texts[0] == "x" && texts[1].size() == 30);
+        CHECK(results[3].value_unchecked().empty());
+        CHECK(codes == 7 && timeouts == 1);
+
+        // Pattern arms work in both modes.
+        int quick = 0, slow = 0;
+        std::vector<Result<int, std::string>> latencies = {5, 900, std::string("lost"), 12};
+        match_each(bucketed, latencies,
+            on<int>(in_range<0, 99>) >> [&](int) { ++quick; },
+            on<int>() >> [&](int) { ++slow; },
+            otherwise >> [](const auto&) {});
+        CHECK(quick == 2 && slow == 1);
+        match_each(std::views::all(latencies) | std::views::take(2),
+            on<int>(in_range<0, 99>) >> [&](int) { ++quick; },
+            otherwise >> [](const auto&) {});
+        CHECK(quick == 3);
     }, passed, failed);
 
     run_test("successes range adaptor", [](){
@@ -181,7 +760,854 @@ void run_tests() {
         std::vector<int> expected = {1, 4};
         CHECK(collected == expected);
     }, passed, failed);
-    
+
+    run_test("successes and errors views reference or move", [](){
+        using R = Result<std::string, Error<std::string>>;
+        std::vector<R> results = {R{"a"}, R{Error<std::string>{std::string("bad")}}, R{"b"}};
+
+        // Lvalue ranges yield references into the vector.
+        static_assert(std::is_same_v<std::ranges::range_reference_t<decltype(results | cppmatch::successes)>, std::string&>);
+        std::string* first = &*(results | cppmatch::successes).begin();
+        CHECK(first == &results[0].value_unchecked());
+        std::vector<std::string> errs;
+        for (const auto& e : results | cppmatch::views::errors)
+            errs.push_back(get<std::string>(e.value));
+        CHECK(errs == std::vector<std::string>{"bad"});
+        CHECK(std::ranges::distance(results | cppmatch::views::successes) == 2);
+
+        // Owning rvalue ranges move the values out, so move-only types work.
+        std::vector<Result<std::unique_ptr<int>, std::string>> owned;
+        owned.emplace_back(std::make_unique<int>(3));
+        owned.emplace_back(std::string("err"));
+        owned.emplace_back(std::make_unique<int>(4));
+        int sum = 0;
+        for (auto p : std::move(owned) | cppmatch::successes)
+            sum += *p;
+        CHECK(sum == 7);
+    }, passed, failed);
+
+    run_test("try_transform over lines", [](){
+        auto parse = [](std::string_view line) -> Result<int, std::string> {
+            if (line.empty() || line[0] == '#')
+                return std::string(line);
+            return int(line.size());
+        };
+        CHECK(std::ranges::equal(lines("ab\n#c\nabc\n\nlast"),
+                                 std::vector<std::string_view>{"ab", "#c", "abc", "", "last"}));
+        CHECK(std::ranges::distance(lines("")) == 0);
+        CHECK(std::ranges::distance(lines("one\n")) == 1);
+
+        // An lvalue counter is referenced and read afterwards.
+        std::size_t dropped = 0;
+        std::vector<int> sizes;
+        for (int n : lines("ab\n#c\nabc\n\nlast") | try_transform(parse, dropped))
+            sizes.push_back(n);
+        CHECK((sizes == std::vector<int>{2, 3, 4}));
+        CHECK(dropped == 2);
+
+        // A container collects the errors; a callable sees each one.
+        std::vector<std::string> errs;
+        auto total = 0;
+        for (int n : lines("#x\nabcd\n#y") | try_transform(parse, errs))
+            total += n;
+        CHECK(total == 4);
+        CHECK((errs == std::vector<std::string>{"#x", "#y"}));
+        std::size_t bounded = 0;
+        auto keep_two = [&](std::string e) { if (bounded < 2) errs.push_back(std::move(e)); ++bounded; };
+        for ([[maybe_unused]] int n : lines("#1\n#2\n#3\nok") | try_transform(parse, keep_two)) {}
+        CHECK(bounded == 3 && errs.size() == 4);
+
+        // The function runs once per element, as the iterator reaches it.
+        int calls = 0;
+        auto counted = [&](std::string_view line) { ++calls; return parse(line); };
+        auto view = lines("a\nbb\nccc") | try_transform(counted, dropped);
+        static_assert(std::ranges::input_range<decltype(view)>);
+        CHECK(calls == 0);
+        auto it = view.begin();
+        CHECK(*it == 1 && calls == 1);
+
+        // A second begin() resumes the pass rather than sinking errors again.
+        std::size_t sunk = 0;
+        auto once = lines("#a\nb\n#c\ndd") | try_transform(counted, sunk);
+        calls = 0;
+        CHECK(*once.begin() == 1 && sunk == 1);
+        auto again = once.begin();
+        CHECK(*again == 1 && sunk == 1 && calls == 2);
+        ++again;
+        CHECK(*again == 2 && sunk == 2);
+
+        // The underlying iterator need not be default constructible.
+        struct stop { const std::string_view* p = nullptr; };
+        struct cursor {
+            using difference_type = std::ptrdiff_t;
+            using value_type = std::string_view;
+            const std::string_view* p;
+            explicit cursor(const std::string_view* p) : p(p) {}
+            std::string_view operator*() const { return *p; }
+            cursor& operator++() { ++p; return *this; }
+            void operator++(int) { ++p; }
+            bool operator==(const stop& s) const { return p == s.p; }
+        };
+        static_assert(!std::default_initializable<cursor>);
+        const std::string_view words[] = {"#x", "yy", "zzz"};
+        auto no_default = std::ranges::subrange(cursor(words), stop{words + 3}) | try_transform(parse, sunk);
+        CHECK(std::ranges::equal(no_default, std::vector<int>{2, 3}));
+
+#if defined(CPPMATCH_HAS_MMAP)
+        const auto path = std::filesystem::temp_directory_path() / "cppmatch_lines_test.txt";
+        if (auto* out = std::fopen(path.c_str(), "wb")) {
+            std::fputs("10\n#bad\n200\n", out);
+            std::fclose(out);
+        }
+        auto file = mapped_file::open(path.c_str());
+        CHECK(is_ok(file));
+        std::size_t bad = 0;
+        int sum = 0;
+        for (int n : file.value_unchecked().lines() | try_transform(parse, bad))
+            sum += n;
+        CHECK(sum == 5 && bad == 1);
+        std::filesystem::remove(path);
+        CHECK(!is_ok(mapped_file::open(path.c_str())));
+#endif
+    }, passed, failed);
+
+    run_test("partition_results", [](){
+        using R = Result<std::unique_ptr<int>, std::string>;
+        std::vector<R> batch;
+        for (int i = 0; i < 6; ++i) {
+            if (i % 3 == 0) batch.emplace_back(std::string("err") + std::to_string(i));
+            else batch.emplace_back(std::make_unique<int>(i));
+        }
+
+        std::vector<std::unique_ptr<int>> oks;
+        std::vector<std::string> errs;
+        partition_results(std::move(batch), oks, errs, 2);
+        CHECK(oks.size() == 4);
+        CHECK(*oks[0] == 1 && *oks[3] == 5);
+        CHECK(errs == (std::vector<std::string>{"err0", "err3"}));
+        CHECK(oks.capacity() >= 4);
+
+        // Lvalue ranges are copied and left intact.
+        std::vector<Result<int, std::string>> mixed = {1, std::string("x"), 2};
+        std::vector<int> ints;
+        std::vector<std::string> strs;
+        partition_results(mixed, ints, strs);
+        CHECK(ints == (std::vector<int>{1, 2}));
+        CHECK(strs == std::vector<std::string>{"x"});
+        CHECK(get<1>(mixed[1]) == "x");
+    }, passed, failed);
+
+    run_test("collect_results", [](){
+        std::vector<Result<int, std::string>> all_ok = {1, 2, 3};
+        auto collected = all_ok | cppmatch::collect_results;
+        CHECK(is_ok(collected));
+        CHECK(get<0>(collected) == (std::vector<int>{1, 2, 3}));
+
+        // A lazy range stops being evaluated at the first error.
+        int evaluated = 0;
+        auto lazy = std::views::iota(0, 10) | std::views::transform([&](int i) -> Result<int, std::string> {
+            ++evaluated;
+            if (i == 3) return std::string("bad ") + std::to_string(i);
+            return i;
+        });
+        auto first_error = cppmatch::collect_results(lazy);
+        CHECK(is_err(first_error));
+        CHECK(get<1>(first_error) == "bad 3");
+        CHECK(evaluated == 4);
+
+        // A caller-provided buffer is appended to and handed back.
+        std::vector<int> buffer;
+        buffer.reserve(16);
+        const int* storage = buffer.data();
+        auto filled = cppmatch::collect_results(all_ok, std::move(buffer));
+        CHECK(get<0>(filled).data() == storage);
+        CHECK(get<0>(filled).size() == 3);
+
+        // Owning rvalue ranges move values out.
+        std::vector<Result<std::unique_ptr<int>, std::string>> owned;
+        owned.emplace_back(std::make_unique<int>(5));
+        auto moved = cppmatch::collect_results(std::move(owned));
+        CHECK(*get<0>(moved).front() == 5);
+    }, passed, failed);
+
+    run_test("parallel_collect", [](){
+        std::vector<int> rows(100000);
+        std::iota(rows.begin(), rows.end(), 0);
+        auto square = [](int x) -> Result<long, std::string> { return static_cast<long>(x) * x; };
+
+        auto all = parallel_collect(std::execution::par, rows, square);
+        CHECK(is_ok(all));
+        CHECK(get<0>(all).size() == rows.size());
+        CHECK(get<0>(all)[99999] == 99999L * 99999L);
+
+        // Several failures: the one at the lowest index wins, every time.
+        std::atomic<int> calls{0};
+        auto validate = [&](int x) -> Result<int, std::string> {
+            calls.fetch_add(1, std::memory_order_relaxed);
+            if (x == 1234 || x == 50000 || x == 99000) return std::to_string(x);
+            return x;
+        };
+        for (int run = 0; run < 10; ++run) {
+            calls.store(0);
+            auto first_bad = parallel_collect(std::execution::par, rows, validate);
+            CHECK(is_err(first_bad));
+            CHECK(get<1>(first_bad) == "1234");
+            // Cancelled: most of the elements after the error are never evaluated.
+            CHECK(calls.load() < static_cast<int>(rows.size()) / 2);
+        }
+
+        auto serial = parallel_collect(std::execution::seq, rows, validate);
+        CHECK(get<1>(serial) == "1234");
+
+        // An exception thrown before the earliest error is rethrown.
+        bool thrown = false;
+        try {
+            parallel_collect(std::execution::par, rows, [](int x) -> Result<int, std::string> {
+                if (x == 10) throw std::runtime_error("boom");
+                if (x == 20000) return std::string("late");
+                return x;
+            });
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        CHECK(thrown);
+
+        // Non-default-constructible values and bool keep their order.
+        struct Id { explicit Id(int v) : v(v) {} int v; };
+        auto ids = parallel_collect(std::execution::par, rows, [](int x) -> Result<Id, std::string> { return Id{x}; });
+        CHECK(get<0>(ids)[777].v == 777);
+        auto flags = parallel_collect(std::execution::par, rows, [](int x) -> Result<bool, std::string> { return x % 2 == 0; });
+        CHECK(get<0>(flags)[4] && !get<0>(flags)[5]);
+
+        // A call nested inside f finds the pool busy and runs on its own thread.
+        std::vector<int> inner(200, 1);
+        auto nested = parallel_collect(std::execution::par, std::span(rows).first(1000), [&](int x) -> Result<int, std::string> {
+            auto sums = parallel_collect(std::execution::par, inner, [](int y) -> Result<int, std::string> { return y; });
+            return x + static_cast<int>(get<0>(sums).size());
+        });
+        CHECK(get<0>(nested)[10] == 210);
+    }, passed, failed);
+
+    run_test("ResultVector", [](){
+        struct NotFound { int id; };
+        struct Corrupt { std::string why; };
+        using R = Result<std::string, Error<NotFound, Corrupt>>;
+
+        ResultVector<std::string, Error<NotFound, Corrupt>> rv;
+        rv.reserve(200, 2);
+        for (int i = 0; i < 200; ++i) {
+            if (i == 70) rv.push_back(R{NotFound{i}});
+            else if (i == 130) rv.emplace_error(Corrupt{"bad checksum"});
+            else rv.push_back(R{std::to_string(i)});
+        }
+
+        CHECK(rv.size() == 200);
+        CHECK(rv.count_ok() == 198);
+        CHECK(rv.count_err() == 2);
+        CHECK(rv.is_ok(69) && rv.is_err(70) && rv.is_err(130));
+        CHECK(rv.value_unchecked(199) == "199");
+        CHECK(get<0>(rv[131]) == "131");
+        CHECK(get<NotFound>(get<1>(rv[70]).value).id == 70);
+        CHECK(get<Corrupt>(rv.error_unchecked(130).value).why == "bad checksum");
+
+        // Success values are one contiguous span.
+        std::span<const std::string> values = rv | cppmatch::successes;
+        CHECK(values.size() == 198);
+        CHECK(values[70] == "71");
+        CHECK(rv.errors()[1].index == 130);
+        int error_count = 0;
+        for (const auto& e : rv | cppmatch::views::errors) {
+            (void)e;
+            ++error_count;
+        }
+        CHECK(error_count == 2);
+
+        // for_each visits in order, with the error alternatives flattened.
+        std::string trace;
+        std::size_t visited = 0;
+        rv.for_each(
+            [&](const std::string&) { ++visited; },
+            [&](const NotFound& e) { ++visited; trace += 'N'; trace += std::to_string(e.id); },
+            [&](const Corrupt&) { ++visited; trace += "C"; });
+        CHECK(visited == 200);
+        CHECK(trace == "N70C");
+
+        static_assert(sizeof(std::string) < sizeof(R));
+    }, passed, failed);
+
+    run_test("bulk status queries", [](){
+        using R = Result<int, Error<std::string>>;
+        std::vector<R> batch(200, R{1});
+        for (std::size_t i : {5u, 64u, 130u, 199u})
+            batch[i] = Error<std::string>{std::string("bad")};
+
+        CHECK(count_errors(batch) == 4);
+        CHECK(find_first_error(batch) == 5);
+        CHECK(find_first_error(std::span<const R>(batch).subspan(6)) == 58);
+        CHECK(find_first_error(std::vector<R>(10, R{1})) == 10);
+
+        std::array<std::uint64_t, 4> mask{};
+        error_mask(batch, mask);
+        CHECK(mask[0] == (std::uint64_t{1} << 5));
+        CHECK(mask[1] == 1u);
+        CHECK(mask[2] == (std::uint64_t{1} << 2));
+        CHECK(mask[3] == (std::uint64_t{1} << 7));
+
+        ResultVector<int, Error<std::string>> rv;
+        for (auto& r : batch) rv.push_back(r);
+        std::array<std::uint64_t, 4> rv_mask{};
+        error_mask(rv, rv_mask);
+        CHECK(rv_mask == mask);
+        CHECK(count_errors(rv) == 4);
+        CHECK(find_first_error(rv) == 5);
+        ResultVector<int, Error<std::string>> all_ok;
+        all_ok.emplace_value(1);
+        CHECK(find_first_error(all_ok) == 1);
+    }, passed, failed);
+
+    run_test("lazy_error", [](){
+        using depth_error = lazy_error<"{} exceeds max_depth {}", unsigned, unsigned>;
+        using closed = lazy_error<"connection closed">;
+        static_assert(std::is_trivially_copyable_v<depth_error>);
+        static_assert(sizeof(closed) == 1);
+        static_assert(depth_error::format() == "{} exceeds max_depth {}");
+
+        auto validate = [](unsigned n, unsigned max) -> Result<unsigned, Error<depth_error, closed>> {
+            if (max == 0) return closed{};
+            if (n > max) return make_lazy_error<"{} exceeds max_depth {}">(n, max);
+            return n;
+        };
+
+        auto r = validate(7, 3);
+        CHECK(get<depth_error>(get<1>(r).value).arg<0>() == 7u);
+        std::string text = match(r,
+            [](unsigned) { return std::string("ok"); },
+            [](const depth_error& e) { return e.message(); },
+            [](const closed& e) { return e.message(); });
+        CHECK(text == "7 exceeds max_depth 3");
+
+        char buffer[32];
+        auto end = get<depth_error>(get<1>(r).value).format_to(buffer);
+        CHECK(std::string_view(buffer, end) == "7 exceeds max_depth 3");
+        CHECK(match(validate(1, 0), [](unsigned) { return std::string(); }, [](const auto& e) { return e.message(); }) == "connection closed");
+        CHECK(default_expect(validate(9, 1), 0u) == 0u);
+    }, passed, failed);
+
+    run_test("error arena payloads", [](){
+        struct NotFound { arena_string what; };
+        using Narrow = Error<NotFound, arena_string>;
+        using Wide = Error<NotFound, arena_string, int>;
+        static_assert(std::is_trivially_copyable_v<arena_string>);
+        static_assert(std::is_trivially_copyable_v<Wide>);
+        static_assert(std::is_nothrow_constructible_v<Wide, const Narrow&>);
+
+        CHECK(!error_arena::active());
+        const char* text = nullptr;
+        {
+            error_arena request;
+            CHECK(error_arena::active());
+            auto lookup = [](int key) -> Result<int, Narrow> {
+                if (key < 0)
+                    return NotFound{arena_string::format("no entry for key {}", key)};
+                return key;
+            };
+            auto handler = [&](int key) -> Result<int, Wide> {
+                return expect(lookup(key)) * 2;
+            };
+            auto r = handler(-7);
+            text = match(r,
+                [](int) { return static_cast<const char*>(nullptr); },
+                [](const NotFound& e) { return e.what.data(); },
+                [](const auto&) { return static_cast<const char*>(nullptr); });
+            CHECK(text != nullptr);
+            CHECK(get<NotFound>(r.error_unchecked().value).what == "no entry for key -7");
+
+            // An inner guard releases only its own payloads.
+            auto before = arena_string("outer");
+            {
+                error_arena inner;
+                arena_string big = arena_string::format("{:>40000}", 'x');
+                CHECK(big.size() == 40000);
+            }
+            auto after = arena_string("outer2");
+            CHECK(before == "outer" && after == "outer2");
+
+            std::vector<int, arena_allocator<int>> frames;
+            for (int i = 0; i < 100; ++i)
+                frames.push_back(i);
+            CHECK(frames[99] == 99);
+        }
+        CHECK(!error_arena::active());
+
+        // Once warm, a request reuses the chunks instead of allocating.
+        const auto reserved = error_arena::reserved_bytes();
+        for (int i = 0; i < 1000; ++i) {
+            error_arena request;
+            auto e = arena_string::format("request {} failed", i);
+            CHECK(e.size() > 0);
+        }
+        CHECK(error_arena::reserved_bytes() == reserved);
+
+#if defined(CPPMATCH_ARENA_CHECKS)
+        // A guard's stamp stops being live once it is gone, even when a new
+        // guard takes its depth.
+        auto& state = cppmatch_detail::error_arena_state::local();
+        {
+            error_arena request;
+            std::uint64_t first = 0;
+            {
+                error_arena inner;
+                first = state.stamp();
+                CHECK(state.live(first));
+            }
+            CHECK(!state.live(first));
+            error_arena again;
+            CHECK(state.live(state.stamp()) && !state.live(first));
+        }
+#endif
+    }, passed, failed);
+
+    run_test("Boxed error payloads", [](){
+        struct Diagnostic { char text[200]; int line; };
+        struct Timeout {};
+        using Fat = Result<int, Error<Diagnostic, Timeout>>;
+        using Slim = Result<int, Error<Boxed<Diagnostic>, Timeout>>;
+        static_assert(result_footprint<Fat>::size > 200);
+#if !defined(CPPMATCH_TRACE)
+        static_assert(result_footprint<Slim>::size <= 3 * sizeof(void*));
+#endif
+        static_assert(result_footprint<Result<int, Boxed<Diagnostic>>>::size == 2 * sizeof(void*));
+        static_assert(result_footprint<Slim>::alignment == alignof(void*));
+
+        auto parse = [](int line) -> Slim {
+            if (line < 0) return Timeout{};
+            if (line > 10) return Diagnostic{"unexpected token", line};
+            return line;
+        };
+
+        // Handlers receive the payload itself, not the box.
+        auto describe = [](const Slim& r) {
+            return match(r,
+                [](int v) { return std::to_string(v); },
+                [](const Diagnostic& d) { return std::string(d.text) + "@" + std::to_string(d.line); },
+                [](const Timeout&) { return std::string("timeout"); });
+        };
+        CHECK(describe(parse(3)) == "3");
+        CHECK(describe(parse(12)) == "unexpected token@12");
+        CHECK(describe(parse(-1)) == "timeout");
+
+        // expect_e propagates the payload, and match_e finds its alternative.
+        auto forward = [&](int line) -> Slim { return expect_e(parse(line)) + 1; };
+        static_assert(std::is_same_v<cppmatch_detail::leaf_at_index<1, cppmatch_detail::flat_leaves_t<Slim>>::type::type, Diagnostic>);
+        CHECK(match_e(forward(12),
+            [](int) { return 0; },
+            [](const Diagnostic& d) { return d.line; },
+            [](const Timeout&) { return -1; }) == 12);
+
+        // Copies are deep, moves transfer the slot, and the slot is reused once freed.
+        Slim a = parse(42);
+        Slim b = a;
+        const Diagnostic* slot = get<Boxed<Diagnostic>>(get<1>(b).value).get();
+        CHECK(slot != get<Boxed<Diagnostic>>(get<1>(a).value).get());
+        Slim c = std::move(b);
+        CHECK(get<Boxed<Diagnostic>>(get<1>(c).value).get() == slot);
+        c = 1;
+        Slim d = parse(43);
+        CHECK(get<Boxed<Diagnostic>>(get<1>(d).value).get() == slot);
+
+        // Widening keeps the box.
+        Result<int, Error<Boxed<Diagnostic>, Timeout, std::string>> wide = Error<Boxed<Diagnostic>, Timeout>(get<1>(d));
+        CHECK(match(wide, [](const Diagnostic& x) { return x.line; }, [](const auto&) { return 0; }) == 43);
+
+        // A moved-from box is empty; only assigning or destroying it is allowed.
+        Boxed<Diagnostic> full(Diagnostic{"x", 1});
+        Boxed<Diagnostic> taken = std::move(full);
+        CHECK(full.get() == nullptr && taken->line == 1);
+        full = taken;
+        CHECK(full->line == 1);
+
+        // A box outliving its thread's pool release goes back to the allocator.
+        std::thread worker([] { boxed_at_thread_exit(); });
+        worker.join();
+    }, passed, failed);
+
+    run_test("error context", [](){
+        struct BadDigit { char c; };
+        struct OutOfRange { int value; };
+        using ParseError = Error<BadDigit, OutOfRange>;
+        static_assert(std::is_trivially_copyable_v<Contextual<ParseError>>);
+        static_assert(std::is_nothrow_constructible_v<Contextual<ParseError>,
+                                                      Contextual<Error<BadDigit>>&&>);
+
+        auto digit = [](char c) -> Result<int, Error<BadDigit>> {
+            if (c < '0' || c > '9')
+                return BadDigit{c};
+            return c - '0';
+        };
+        int built = 0;
+        auto number = [&](std::string_view text) -> Result<int, Contextual<Error<BadDigit>>> {
+            int n = 0;
+            for (std::size_t i = 0; i < text.size(); ++i)
+                n = n * 10 + expect_ctx(digit(text[i]), [&] {
+                    ++built;
+                    return std::to_string(i);
+                });
+            return n;
+        };
+        auto coordinate = [&](std::string_view x) -> Result<int, Contextual<ParseError>> {
+            int v = expect_ctx(number(x), "x coordinate");
+            if (v > 100)
+                return OutOfRange{v};
+            return v;
+        };
+
+        CHECK(coordinate("42").value_unchecked() == 42);
+        CHECK(built == 0);
+
+        auto bad = coordinate("4z");
+        CHECK(built == 1);
+        const error_context& frames = bad.error_unchecked().context;
+        std::vector<std::string_view> seen(frames.begin(), frames.end());
+        CHECK((seen == std::vector<std::string_view>{"1", "x coordinate"}));
+        CHECK(match(bad,
+            [](int) { return ' '; },
+            [](BadDigit e) { return e.c; },
+            [](OutOfRange) { return ' '; }) == 'z');
+
+        auto far = coordinate("300");
+        CHECK(far.error_unchecked().context.empty());
+        CHECK(match(far, [](int) { return 0; }, [](BadDigit) { return 0; },
+                    [](OutOfRange e) { return e.value; }) == 300);
+
+        // with_context wraps a plain error, and only builds the frame on failure.
+        auto wrapped = with_context(digit('x'), [&] { ++built; return "digit"; });
+        static_assert(std::is_same_v<decltype(wrapped), Result<int, Contextual<Error<BadDigit>>>>);
+        CHECK(*wrapped.error_unchecked().context.begin() == "digit");
+        CHECK(with_context(digit('3'), [&] { ++built; return "digit"; }).value_unchecked() == 3);
+        CHECK(built == 2);
+
+        // Frames past the inline capacity are truncated, then counted.
+        error_context full;
+        const std::string longest(error_context::capacity * 2, 'f');
+        full.push("short");
+        full.push(longest);
+        full.push("dropped");
+        CHECK(full.size() == 2);
+        CHECK(full.dropped() == 1);
+        CHECK((*std::next(full.begin())).size() == error_context::capacity - 7);
+    }, passed, failed);
+
+    run_test("packed Result layouts", [](){
+        static_assert(sizeof(Result<PackedNode*, io_errc>) == sizeof(void*));
+        static_assert(sizeof(Result<std::uint32_t, overflow>) == 4);
+        static_assert(sizeof(Result<std::uint32_t, io_errc>) == 8);
+        static_assert(std::is_trivially_copyable_v<Result<PackedNode*, io_errc>>);
+
+        PackedNode node{5};
+        Result<PackedNode*, io_errc> ptr = &node;
+        CHECK(is_ok(ptr) && get<0>(ptr)->payload == 5);
+        ptr = io_errc::closed;
+        CHECK(is_err(ptr) && get<1>(ptr) == io_errc::closed);
+        CHECK(match(ptr, [](PackedNode*) { return 0; }, [](io_errc e) { return static_cast<int>(e); }) == 1);
+
+        constexpr Result<std::uint32_t, overflow> sum = 12u;
+        static_assert(sum.value_unchecked() == 12u);
+        constexpr Result<std::uint32_t, overflow> full = overflow{};
+        static_assert(is_err(full) && full.bits() == 0xffffffffu);
+        static_assert(niche_packs_as_value<0xfffffffeu>);
+#if !defined(NDEBUG)
+        static_assert(!niche_packs_as_value<0xffffffffu>);
+#endif
+
+        CHECK(get<0>(packed_twice(5)) == 3u);
+        CHECK(get<1>(packed_twice(1)) == io_errc::timeout);
+        static_assert(packed_result_traits<std::uint32_t, io_errc>::is_error(Result<std::uint32_t, io_errc>(io_errc::closed).bits()));
+
+        std::vector<Result<std::uint32_t, io_errc>> batch = {1u, io_errc::closed, 3u};
+        CHECK(count_errors(batch) == 1);
+        CHECK(get<0>(cppmatch::collect_results(batch | std::views::filter([](auto r) { return is_ok(r); }))).size() == 2);
+    }, passed, failed);
+
+#if defined(CPPMATCH_INSTRUMENT)
+    run_test("propagation counters", [](){
+        reset_propagation_counts();
+        for (int i = 0; i < 10; ++i) (void)instrumented_caller(i % 3);
+        CHECK(propagations_of("Throttled", propagation_kind::expect) == 3);
+        CHECK(propagations_of("Refused", propagation_kind::expect) == 3);
+
+        for (int i = 0; i < 4; ++i)
+            (void)match_e(instrumented_caller_e(1), [](int) { return 0; }, [](const auto&) { return 1; });
+        CHECK(propagations_of("Throttled", propagation_kind::expect_e) == 4);
+
+        // Counts from other threads, including exited ones, are aggregated.
+        std::thread worker([] {
+            for (int i = 0; i < 5; ++i) (void)instrumented_caller(2);
+        });
+        worker.join();
+        CHECK(propagations_of("Refused", propagation_kind::expect) == 8);
+
+        auto counts = propagation_counts();
+        CHECK(!counts.empty());
+        CHECK(std::string_view(counts.front().where.file_name()).ends_with("main.cpp"));
+
+        reset_propagation_counts();
+        CHECK(propagation_counts().empty());
+        (void)instrumented_caller(1);
+        CHECK(propagations_of("Throttled", propagation_kind::expect) == 1);
+    }, passed, failed);
+
+    run_test("propagation sites are shared across threads", [](){
+        reset_propagation_counts();
+        for (int t = 0; t < 50; ++t) {
+            std::thread worker([] {
+                (void)match_e(instrumented_caller_e(1), [](int) { return 0; },
+                              [](const auto&) { return 1; });
+            });
+            worker.join();
+        }
+        std::size_t rows = 0;
+        std::uint64_t total = 0;
+        for (const auto& c : propagation_counts())
+            if (c.kind == propagation_kind::expect_e && c.error_type.ends_with("Throttled")) {
+                ++rows;
+                total += c.count;
+            }
+        CHECK(rows == 1);
+        CHECK(total == 50);
+    }, passed, failed);
+
+    run_test("propagation rows are merged across template instantiations", [](){
+        reset_propagation_counts();
+        (void)instrumented_generic(1);
+        (void)instrumented_generic(1L);
+        (void)instrumented_generic(1.0);
+        std::size_t rows = 0;
+        for (const auto& c : propagation_counts())
+            if (c.kind == propagation_kind::expect && c.error_type.ends_with("Throttled")) {
+                ++rows;
+                CHECK(c.count == 3);
+            }
+        CHECK(rows == 1);
+        CHECK(dropped_propagation_counts() == 0);
+    }, passed, failed);
+#endif
+
+#if defined(CPPMATCH_TRACE)
+    run_test("propagation trace", [](){
+        CHECK(traced_top(3).value_unchecked() == 7);
+
+        auto r = traced_top(-1);
+        CHECK(is_err(r));
+        const propagation_trace& trace = r.error_unchecked().trace;
+        CHECK(trace.size() == 2);
+        CHECK(trace.dropped() == 0);
+        CHECK(trace[0].line() < trace[1].line());
+        CHECK(std::string_view(trace[0].function_name()).find("traced_middle") != std::string_view::npos);
+        CHECK(std::string_view(trace[1].function_name()).find("traced_top") != std::string_view::npos);
+
+        // Matching on the flattened error is unaffected by the trace.
+        CHECK(match(r, [](int) { return 0; }, [](Timeout) { return 1; }, [](io_errc) { return 2; }) == 1);
+
+        // An error constructed at the top has no frames.
+        Result<int, Error<Timeout, io_errc>> fresh = Timeout{};
+        CHECK(fresh.error_unchecked().trace.empty());
+
+        auto deep = traced_recursive(propagation_trace::capacity + 3);
+        CHECK(deep.error_unchecked().trace.size() == propagation_trace::capacity);
+        CHECK(deep.error_unchecked().trace.dropped() == 3);
+    }, passed, failed);
+#endif
+
+    run_test("co_await on Result", [](){
+        CHECK(coro_sum(2, 3).value_unchecked() == 5);
+        CHECK(match(coro_sum(-1, 3), [](int) { return 0; }, [](Negative) { return 1; }, [](Overflow) { return 2; }) == 1);
+        CHECK(match(coro_sum(600, 600), [](int) { return 0; }, [](Negative) { return 1; }, [](Overflow) { return 2; }) == 2);
+
+        // An lvalue is awaited without being consumed.
+        auto one = []() -> Result<std::string, Overflow> { co_return std::string(40, 'x'); };
+        auto twice = [&]() -> Result<std::size_t, Overflow> {
+            auto r = one();
+            std::size_t first = (co_await r).size();
+            co_return first + (co_await r).size();
+        };
+        CHECK(twice().value_unchecked() == 80);
+
+        // Deep recursion spills frames over several chunks of the frame stack and back.
+        CHECK(coro_depth(5000).value_unchecked() == 5000);
+        CHECK(coro_depth(10).value_unchecked() == 10);
+
+        auto throws = []() -> Result<int, Overflow> {
+            throw std::runtime_error("boom");
+            co_return 0;
+        };
+        bool caught = false;
+        try { (void)throws(); } catch (const std::runtime_error&) { caught = true; }
+        CHECK(caught);
+        CHECK(coro_sum(1, 1).value_unchecked() == 2);
+    }, passed, failed);
+
+    run_test("async tasks", [](){
+        CHECK(sync_wait(async_handler(1)).value_unchecked() == 30);
+        auto err = sync_wait(async_handler(-1));
+        CHECK(match(err, [](int) { return 0; }, [](NotFound e) { return e.id; }, [](Unavailable) { return 99; }) == -1);
+
+        std::vector<Task<Result<int, Error<NotFound>>>> lookups;
+        for (int i = 0; i < 4; ++i) lookups.push_back(async_lookup(i));
+        auto all = sync_wait(when_all_results(std::move(lookups)));
+        CHECK((all.value_unchecked() == std::vector<int>{0, 10, 20, 30}));
+
+        work_stealing_executor ex(4);
+        CHECK(sync_wait(ex, async_handler(2)).value_unchecked() == 50);
+
+        std::vector<Task<Result<int, Unavailable>>> empty;
+        CHECK(sync_wait(ex, when_all_results(std::move(empty))).value_unchecked().empty());
+
+        // The failing child cancels its siblings at their next co_await. On a
+        // single worker the children run in order, so exactly those before it finish.
+        work_stealing_executor serial(1);
+        std::atomic<int> finished{0};
+        std::vector<Task<Result<int, Unavailable>>> steps;
+        for (int i = 0; i < 64; ++i) steps.push_back(async_step(serial, i, finished));
+        auto failed = sync_wait(serial, when_all_results(std::move(steps)));
+        CHECK(is_err(failed));
+        CHECK(finished.load() == 3);
+
+        std::vector<Task<Result<int, Unavailable>>> racing;
+        for (int i = 0; i < 64; ++i) racing.push_back(async_step(ex, i, finished));
+        CHECK(is_err(sync_wait(ex, when_all_results(std::move(racing)))));
+
+        std::vector<Task<Result<int, Unavailable>>> fine;
+        for (int i = 4; i < 40; ++i) fine.push_back(async_step(ex, i, finished));
+        auto values = sync_wait(ex, when_all_results(std::move(fine))).value_unchecked();
+        CHECK(values.size() == 36 && values.front() == 4 && values.back() == 39);
+
+        auto throws = []() -> Task<Result<int, Unavailable>> {
+            throw std::runtime_error("io");
+            co_return 0;
+        };
+        bool caught = false;
+        try { (void)sync_wait(ex, throws()); } catch (const std::runtime_error&) { caught = true; }
+        CHECK(caught);
+    }, passed, failed);
+
+    run_test("Result layout and triviality", [](){
+        static_assert(std::is_trivially_copyable_v<Result<int, float>>);
+        static_assert(std::is_trivially_destructible_v<Result<int, float>>);
+        static_assert(sizeof(Result<int, char>) == 2 * sizeof(int));
+#if !defined(CPPMATCH_TRACE)
+        static_assert(sizeof(Result<double, Error<int, float>>) <= 2 * sizeof(double));
+#endif
+        static_assert(!std::is_trivially_copyable_v<Result<int, std::string>>);
+        static_assert(std::is_nothrow_move_constructible_v<Result<std::string, std::string>>);
+
+        constexpr Result<int, float> r = 7;
+        static_assert(r.value_unchecked() == 7);
+        CHECK(r.value_unchecked() == 7);
+    }, passed, failed);
+
+    run_test("noexcept propagation", [](){
+        struct Slow {
+            Slow() = default;
+            Slow(const Slow&) {}
+        };
+        using Small = Error<int, float>;
+        using Wide = Error<int, float, char>;
+        static_assert(std::is_trivially_copyable_v<Small>);
+        static_assert(std::is_trivially_destructible_v<Small>);
+        static_assert(std::is_nothrow_constructible_v<Small, float>);
+        static_assert(std::is_nothrow_constructible_v<Wide, const Small&>);
+        static_assert(std::is_nothrow_constructible_v<Wide, Small&&>);
+        static_assert(std::is_nothrow_constructible_v<Error<int, std::string, char>,
+                                                      Error<int, std::string>&&>);
+        static_assert(!std::is_nothrow_constructible_v<Error<Slow, char>, const Error<Slow>&>);
+        static_assert(std::is_nothrow_constructible_v<Result<int, Wide>, Small&&>);
+
+        Result<int, Small> r = 4;
+        auto ok = [](int v) noexcept { return v; };
+        auto err = [](auto) noexcept { return -1; };
+        static_assert(noexcept(default_expect(r, 0)));
+        static_assert(noexcept(default_expect(std::move(r), 0)));
+        static_assert(noexcept(match(r, ok, err)));
+        static_assert(noexcept(match(r | transform([](int v) noexcept { return v + 1; }), ok, err)));
+        static_assert(noexcept(map_error(r, [](auto) noexcept { return 'x'; })));
+        static_assert(!noexcept(match(r, [](int v) { return v; }, err)));
+        static_assert(!noexcept(match(r | transform([](int v) { return v + 1; }), ok, err)));
+        static_assert(!noexcept(default_expect(Result<Slow, int>(Slow{}), Slow{})));
+        CHECK(match(r | transform([](int v) noexcept { return v + 1; }), ok, err) == 5);
+        CHECK(match(map_error(r, [](auto) noexcept { return 'x'; }), ok, err) == 4);
+
+        // match returns by value, so a handler returning a reference is copied.
+        struct Big { std::string s; };
+        Result<Big, int> big = Big{"payload"};
+        auto big_ref = [](const Big& b) noexcept -> const std::string& { return b.s; };
+        auto int_ref = [](const int&) noexcept -> const std::string& {
+            static const std::string none;
+            return none;
+        };
+        static_assert(!noexcept(match(big, big_ref, int_ref)));
+        static_assert(!noexcept(match(std::tie(big, r), [&](const Big& b, auto) noexcept
+                                      -> const std::string& { return b.s; },
+                                      [&](auto, auto) noexcept -> const std::string& {
+                                          return int_ref(0);
+                                      })));
+        Result<int, char> small = 3;
+        static_assert(noexcept(match(small, [](const int& v) noexcept -> const int& { return v; },
+                                     [](const char&) noexcept -> const int& {
+                                         static const int none = 0;
+                                         return none;
+                                     })));
+        CHECK(match(big, big_ref, int_ref) == "payload");
+    }, passed, failed);
+
+    run_test("Result checked access", [](){
+        Result<int, std::string> r = std::string("oops");
+        CHECK(get<1>(r) == "oops");
+        CHECK(get<std::string>(r) == "oops");
+        CHECK(get_if<0>(&r) == nullptr);
+        CHECK(*get_if<1>(&r) == "oops");
+        bool thrown = false;
+        try {
+            (void) get<0>(r);
+        } catch (const std::bad_variant_access&) {
+            thrown = true;
+        }
+        CHECK(thrown);
+    }, passed, failed);
+
+    run_test("Result assignment switches alternatives", [](){
+        Result<std::string, std::string> r(std::in_place_index<0>, "value");
+        Result<std::string, std::string> e(std::in_place_index<1>, "error");
+        r = e;
+        CHECK(r.index() == 1);
+        CHECK(r.error_unchecked() == "error");
+        r = Result<std::string, std::string>(std::in_place_index<0>, "again");
+        CHECK(r.index() == 0);
+        CHECK(r.value_unchecked() == "again");
+        Result<int, std::string> n = std::string("oops");
+        n = 3;
+        CHECK(is_ok(n) && n.value_unchecked() == 3);
+
+        // A throwing construction of the new alternative leaves the old one in
+        // place: the std::string is moved aside and restored.
+        struct Fragile {
+            int v;
+            bool throws;
+            Fragile(int v, bool throws) : v(v), throws(throws) {}
+            Fragile(const Fragile& o) : v(o.v), throws(o.throws) { if (throws) throw 1; }
+            Fragile(Fragile&& o) : v(o.v), throws(o.throws) { if (throws) throw 2; }
+            Fragile& operator=(const Fragile&) = default;
+            Fragile& operator=(Fragile&&) = default;
+        };
+        Result<std::string, Fragile> kept = std::string("keep");
+        const Result<std::string, Fragile> bad(std::in_place_index<1>, 7, true);
+        try { kept = bad; } catch (int) {}
+        CHECK(is_ok(kept) && kept.value_unchecked() == "keep");
+        try { kept = Result<std::string, Fragile>(std::in_place_index<1>, 7, true); } catch (int) {}
+        CHECK(is_ok(kept) && kept.value_unchecked() == "keep");
+        kept = Result<std::string, Fragile>(std::in_place_index<1>, 8, false);
+        CHECK(is_err(kept) && kept.error_unchecked().v == 8);
+    }, passed, failed);
+
     std::print("{}Summary: Tests passed: {}, Tests failed: {}{}\n", YELLOW, passed, failed, RESET);
 
 }